@@ -0,0 +1,196 @@
+#include "SyntheticStudy.h"
+#include "ValueDecoding.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+    /** Deterministic pseudo random value in [0, 1) for a combination of keys (splitmix64) */
+    double randomValue(std::uint64_t seed, std::uint64_t first, std::uint64_t second)
+    {
+        auto value = seed * 0x9E3779B97F4A7C15ull + first * 0xBF58476D1CE4E5B9ull + second * 0x94D049BB133111EBull;
+
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        value = value ^ (value >> 31);
+
+        return static_cast<double>(value >> 11) / static_cast<double>(1ull << 53);
+    }
+
+    /** Buffered writer for one VTK file */
+    class FileWriter
+    {
+    public:
+        FileWriter(const std::string& filePath, bool binary) :
+            _stream(std::filesystem::u8path(filePath), std::ios::binary | std::ios::trunc),
+            _binary(binary),
+            _buffer()
+        {
+            if (!_stream)
+                throw std::runtime_error("Could not create " + filePath);
+
+            _buffer.reserve(bufferSize + 256);
+        }
+
+        ~FileWriter()
+        {
+            flush();
+        }
+
+        void text(const std::string& text)
+        {
+            _buffer += text;
+            flushIfFull();
+        }
+
+        /** Writes a value as text on its own line, or big endian in binary files */
+        template <typename Value>
+        void value(Value value, bool endOfLine = true)
+        {
+            static_assert(sizeof(Value) == 4, "Synthetic studies only hold float and int values");
+
+            if (_binary) {
+                char bytes[sizeof(Value)];
+
+                if (hostIsBigEndian())
+                    std::memcpy(bytes, &value, sizeof(Value));
+                else
+                    swapBytes32(&value, bytes, 1);
+
+                _buffer.append(bytes, sizeof(Value));
+            }
+            else {
+                char characters[32];
+                const auto length = std::is_integral<Value>::value ?
+                    std::snprintf(characters, sizeof(characters), "%d", static_cast<int>(value)) :
+                    std::snprintf(characters, sizeof(characters), "%.7g", static_cast<double>(value));
+
+                _buffer.append(characters, length);
+                _buffer += endOfLine ? '\n' : ' ';
+            }
+
+            flushIfFull();
+        }
+
+        /** Ends a section of binary values, which are followed by a line break */
+        void endBinary()
+        {
+            if (_binary)
+                _buffer += '\n';
+        }
+
+        void flush()
+        {
+            _stream.write(_buffer.data(), _buffer.size());
+            _buffer.clear();
+        }
+
+    private:
+        void flushIfFull()
+        {
+            if (_buffer.size() >= bufferSize)
+                flush();
+        }
+
+    private:
+        static constexpr std::size_t bufferSize = 1 << 20;
+
+        std::ofstream   _stream;
+        bool            _binary;
+        std::string     _buffer;
+    };
+}
+
+std::vector<std::string> writeSyntheticStudy(const std::string& directory, const SyntheticStudyOptions& options)
+{
+    if (options.pointsPerLine < 4 || options.timepoints < 1 || options.groups < 1)
+        throw std::runtime_error("A synthetic study needs at least four points per line, one timepoint and one group");
+
+    std::filesystem::create_directories(std::filesystem::u8path(directory));
+
+    // Consecutive timepoints share three points, so every timepoint advances a pathline by the remaining ones.
+    const auto stride = options.pointsPerLine - 3;
+    const auto numberOfPoints = options.numberOfLines * options.pointsPerLine;
+
+    std::vector<std::string> filePaths;
+
+    for (int group = 0; group < options.groups; group++) {
+        for (int selectionIndex = 0; selectionIndex < options.timepoints; selectionIndex++) {
+
+            // The file at the reset point holds the first timepoint, as in the original studies.
+            const auto timepoint = ((selectionIndex - options.resetPoint) % options.timepoints + options.timepoints) % options.timepoints;
+
+            char fileName[64];
+            std::snprintf(fileName, sizeof(fileName), "group%02d_t%02d.vtk", group, selectionIndex);
+
+            const auto filePath = (std::filesystem::u8path(directory) / fileName).u8string();
+
+            FileWriter writer(filePath, options.binary);
+
+            writer.text("# vtk DataFile Version 3.0\nSynthetic pathlines\n" + std::string(options.binary ? "BINARY" : "ASCII") + "\nDATASET POLYDATA\n");
+            writer.text("POINTS " + std::to_string(numberOfPoints) + " float\n");
+
+            for (std::size_t line = 0; line < options.numberOfLines; line++) {
+                const auto key      = static_cast<std::uint64_t>(group) << 40 | line;
+                const auto phase    = 6.28318 * randomValue(options.seed, key, 0);
+
+                double start[3], direction[3];
+
+                for (int axis = 0; axis < 3; axis++) {
+                    start[axis]     = 100.0 * randomValue(options.seed, key, 1 + axis) - 50.0;
+                    direction[axis] = 0.2 * randomValue(options.seed, key, 4 + axis) - 0.1;
+                }
+
+                for (std::size_t point = 0; point < options.pointsPerLine; point++) {
+                    const auto step = static_cast<double>(timepoint * stride + point);
+
+                    for (int axis = 0; axis < 3; axis++)
+                        writer.value(static_cast<float>(start[axis] + direction[axis] * step + std::sin(0.3 * step + phase + axis)), axis == 2);
+                }
+            }
+
+            writer.endBinary();
+            writer.text("LINES " + std::to_string(options.numberOfLines) + " " + std::to_string(options.numberOfLines * (options.pointsPerLine + 1)) + "\n");
+
+            for (std::size_t line = 0; line < options.numberOfLines; line++) {
+                writer.value(static_cast<int>(options.pointsPerLine), false);
+
+                for (std::size_t point = 0; point < options.pointsPerLine; point++)
+                    writer.value(static_cast<int>(line * options.pointsPerLine + point), point + 1 == options.pointsPerLine);
+            }
+
+            writer.endBinary();
+            writer.text("POINT_DATA " + std::to_string(numberOfPoints) + "\nSCALARS lineIndex float 1\nLOOKUP_TABLE default\n");
+
+            for (std::size_t line = 0; line < options.numberOfLines; line++)
+                for (std::size_t point = 0; point < options.pointsPerLine; point++)
+                    writer.value(static_cast<float>(line));
+
+            writer.endBinary();
+            writer.text("SCALARS speed float 1\nLOOKUP_TABLE default\n");
+
+            for (std::size_t line = 0; line < options.numberOfLines; line++)
+                for (std::size_t point = 0; point < options.pointsPerLine; point++)
+                    writer.value(static_cast<float>(2.0 * randomValue(options.seed, line, timepoint * stride + point)));
+
+            writer.endBinary();
+            writer.text("SCALARS ID int 1\nLOOKUP_TABLE default\n");
+
+            for (std::size_t line = 0; line < options.numberOfLines; line++)
+                for (std::size_t point = 0; point < options.pointsPerLine; point++)
+                    writer.value(static_cast<int>(line));
+
+            writer.endBinary();
+
+            filePaths.push_back(filePath);
+        }
+    }
+
+    return filePaths;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Synthetic pathline study
+// =============================================================================
+
+/** Shape of a synthetic pathline study */
+struct SyntheticStudyOptions
+{
+    std::size_t     numberOfLines = 10000;      /** Pathlines per group */
+    std::size_t     pointsPerLine = 8;          /** Points of every line segment in one timepoint file */
+    int             timepoints = 30;            /** Timepoint files per group */
+    int             groups = 1;                 /** Groups (flow components) */
+    int             resetPoint = 0;             /** Selection index of the file that holds the first timepoint */
+    bool            binary = false;             /** Write BINARY instead of ASCII legacy files */
+    std::uint32_t   seed = 1;
+};
+
+/**
+ * Writes a series of legacy VTK pathline files in the layout of the 4D flow studies: every file holds one
+ * segment per pathline whose first three points repeat the end of the previous timepoint, followed by the line
+ * index, speed and ID point data arrays. The points are computed on the fly, so studies far larger than memory
+ * can be generated.
+ * @param directory UTF-8 encoded path of the output directory, created when needed
+ * @param options Shape of the study
+ * @return Paths of the written files in selection order
+ */
+std::vector<std::string> writeSyntheticStudy(const std::string& directory, const SyntheticStudyOptions& options);
@@ -0,0 +1,380 @@
+#include "SyntheticStudy.h"
+#include "VTKStudyLoader.h"
+#include "ReducedPrecision.h"
+#include "LoadProfiler.h"
+#include "CompressedFile.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+
+// =============================================================================
+// Headless benchmark of the study loader
+// =============================================================================
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const std::array<const char*, 4> phaseNames = { "scan", "parse", "stitch", "derive" };
+
+    /** Memory field of /proc/self/status in bytes, zero where unavailable */
+    std::size_t readMemoryStatus(const char* field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+
+        while (std::getline(status, line))
+            if (line.compare(0, std::strlen(field), field) == 0)
+                return std::strtoull(line.c_str() + std::strlen(field), nullptr, 10) * 1024;
+
+        return 0;
+    }
+
+    /** Current resident set size */
+    std::size_t currentMemory()
+    {
+        return readMemoryStatus("VmRSS:");
+    }
+
+    /** Peak resident set size since the last resetPeakMemory() */
+    std::size_t peakMemory()
+    {
+        const auto peak = readMemoryStatus("VmHWM:");
+
+        if (peak > 0)
+            return peak;
+
+#ifndef _WIN32
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#else
+        return 0;
+#endif
+    }
+
+    /** Resets the peak resident set size (Linux 4.0 and later), otherwise peaks are process wide */
+    void resetPeakMemory()
+    {
+        std::ofstream clearReferences("/proc/self/clear_refs");
+
+        if (clearReferences)
+            clearReferences << "5";
+    }
+
+    /** Wall time and peak memory of the loader phases, attributed by the progress callbacks */
+    struct PhaseStatistics
+    {
+        std::array<double, 4>       seconds = {};
+        std::array<std::size_t, 4>  peakResidentMemory = {};
+        LoadPhase                   currentPhase = LoadPhase::Scan;
+        Clock::time_point           lastReport;
+
+        void start()
+        {
+            lastReport = Clock::now();
+            resetPeakMemory();
+        }
+
+        /** The time since the previous report was spent on the phase that reports */
+        void report(LoadPhase phase)
+        {
+            const auto now = Clock::now();
+            const auto index = static_cast<std::size_t>(phase);
+
+            seconds[index] += std::chrono::duration<double>(now - lastReport).count();
+            peakResidentMemory[index] = std::max(peakResidentMemory[index], peakMemory());
+
+            if (phase != currentPhase) {
+                currentPhase = phase;
+                resetPeakMemory();
+            }
+
+            lastReport = now;
+        }
+    };
+
+    struct InputStatistics
+    {
+        std::size_t     numberOfBytes = 0;
+        std::size_t     numberOfPoints = 0;
+    };
+
+    /** Size of the input files and number of input points, read outside of the timed runs */
+    InputStatistics inspectInput(const std::vector<std::string>& filePaths)
+    {
+        InputStatistics statistics;
+
+        for (const auto& filePath : filePaths) {
+            statistics.numberOfBytes += std::filesystem::file_size(std::filesystem::u8path(filePath));
+            statistics.numberOfPoints += VTKStudyLoader::readFile(filePath).points.size();
+        }
+
+        return statistics;
+    }
+
+    void printRow(const char* stage, double seconds, double megabytes, double points, std::size_t peak)
+    {
+        std::printf("%-8s %10.3f %12.1f %14.2f %14.1f\n", stage, seconds,
+            seconds > 0.0 ? megabytes / seconds : 0.0,
+            seconds > 0.0 ? points / seconds / 1.0e6 : 0.0,
+            peak / (1024.0 * 1024.0));
+    }
+
+    /** Converts the matrix of a loaded study to reduced precision, returns the number of bytes of the result */
+    std::size_t reducePrecision(const LoadedStudy& study, ValuePrecision precision)
+    {
+        if (precision == ValuePrecision::BFloat16) {
+            std::vector<std::uint16_t> values(study.data.size());
+            convertToBFloat16(study.data.data(), study.data.size(), values.data());
+
+            return values.size() * sizeof(std::uint16_t);
+        }
+
+        const auto scaling = computeInt16Scaling(study.data.data(), study.numPoints, study.numDimensions);
+
+        std::vector<std::int16_t> values(study.data.size());
+        convertToScaledInt16(study.data.data(), study.numPoints, study.numDimensions, scaling, values.data());
+
+        return values.size() * sizeof(std::int16_t);
+    }
+
+    int runBenchmark(const std::vector<std::string>& filePaths, int repetitions, ValuePrecision precision, std::size_t resampledLineSize, std::size_t memoryBudget, const std::string& scratchDirectory, const std::string& reportFilePath)
+    {
+        const auto input = inspectInput(filePaths);
+        const auto inputMegabytes = input.numberOfBytes / (1024.0 * 1024.0);
+
+        std::printf("%zu files, %.1f MB, %zu points\n", filePaths.size(), inputMegabytes, input.numberOfPoints);
+
+        for (int repetition = 0; repetition < repetitions; repetition++) {
+            PhaseStatistics phases;
+            LoadProfiler profiler;
+            VTKStudyLoader loader(filePaths);
+
+            loader.setProfiler(&profiler);
+            loader.setResampledLineSize(resampledLineSize);
+            loader.setMemoryBudget(memoryBudget, scratchDirectory);
+
+            loader.setProgressCallback([&phases](const LoadProgress& progress) {
+                phases.report(progress.phase);
+            });
+
+            loader.setWarningCallback([](const std::string& message) {
+                std::fprintf(stderr, "%s\n", message.c_str());
+            });
+
+            const auto baselineMemory = currentMemory();
+            const auto start = Clock::now();
+
+            phases.start();
+
+            const auto study = loader.load();
+
+            const auto totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            const auto outputPoints = static_cast<double>(study.numPoints) * std::max<std::size_t>(study.lineSize, 1);
+            const auto outputMegabytes = study.data.size() * sizeof(float) / (1024.0 * 1024.0);
+
+            std::printf("\nrun %d: %zu rows x %zu dimensions, baseline memory %.1f MB%s\n", repetition + 1, study.numPoints, study.numDimensions, baselineMemory / (1024.0 * 1024.0), study.data.isSpilled() ? ", matrix in a scratch file" : "");
+            std::printf("%-8s %10s %12s %14s %14s\n", "stage", "seconds", "MB/s", "Mpoints/s", "peak RSS MB");
+
+            // Throughput of reading stages is relative to the input, of the derive stage to the output.
+            for (std::size_t phaseIndex = 0; phaseIndex < phaseNames.size(); phaseIndex++) {
+                const auto isOutputStage = phaseIndex == static_cast<std::size_t>(LoadPhase::Derive);
+
+                printRow(phaseNames[phaseIndex], phases.seconds[phaseIndex],
+                    isOutputStage ? outputMegabytes : inputMegabytes,
+                    isOutputStage ? outputPoints : input.numberOfPoints,
+                    phases.peakResidentMemory[phaseIndex]);
+            }
+
+            printRow("total", totalSeconds, inputMegabytes, input.numberOfPoints, peakMemory());
+
+            // Throughput of the conversion is relative to the reduced output.
+            if (precision != ValuePrecision::Float32) {
+                const auto convertStart = Clock::now();
+                const auto convertedBytes = reducePrecision(study, precision);
+
+                printRow("convert", std::chrono::duration<double>(Clock::now() - convertStart).count(), convertedBytes / (1024.0 * 1024.0), outputPoints, peakMemory());
+            }
+
+            std::printf("\n%s", profiler.summary().c_str());
+
+            // The report of the last run replaces those of the earlier ones.
+            if (!reportFilePath.empty() && !profiler.writeJson(reportFilePath, "run " + std::to_string(repetition + 1)))
+                throw std::runtime_error("Could not write the report " + reportFilePath);
+        }
+
+        return 0;
+    }
+
+    void printUsage()
+    {
+        std::cout <<
+            "Usage:\n"
+            "  VTKLoaderBenchmark generate <directory> [options]   write a synthetic legacy VTK pathline study\n"
+            "  VTKLoaderBenchmark run <files or directory> [--repeat <n>] [--precision bf16|int16] [--resample <n>] [--memory-budget <MB>] [--scratch <directory>] [--report <file.json>]   load a study and report per stage timings\n"
+            "  VTKLoaderBenchmark [options]                         generate a study in a temporary directory and run it\n"
+            "\n"
+            "Generator options:\n"
+            "  --lines <n>        pathlines per group (default 10000)\n"
+            "  --points <n>       points per line segment and file (default 8, as the loader expects)\n"
+            "  --timepoints <n>   files per group (default 30)\n"
+            "  --groups <n>       groups (default 1)\n"
+            "  --reset <n>        selection index of the first timepoint (default 0)\n"
+            "  --binary           write BINARY instead of ASCII files\n";
+    }
+
+    /** Collects the VTK files of a directory, plain or compressed, sorted by name like a file dialog selection */
+    void addFiles(const std::string& argument, std::vector<std::string>& filePaths)
+    {
+        const auto path = std::filesystem::u8path(argument);
+
+        if (!std::filesystem::is_directory(path)) {
+            filePaths.push_back(argument);
+            return;
+        }
+
+        std::vector<std::string> directoryFiles;
+
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            const auto extension = std::filesystem::u8path(withoutCompressionExtension(entry.path().u8string())).extension().u8string();
+
+            if (entry.is_regular_file() && (extension == ".vtk" || extension == ".vtp" || extension == ".vtu"))
+                directoryFiles.push_back(entry.path().u8string());
+        }
+
+        std::sort(directoryFiles.begin(), directoryFiles.end());
+        filePaths.insert(filePaths.end(), directoryFiles.begin(), directoryFiles.end());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try {
+        std::vector<std::string> arguments(argv + 1, argv + argc);
+
+        std::string mode = "generate-and-run";
+
+        if (!arguments.empty() && (arguments.front() == "generate" || arguments.front() == "run")) {
+            mode = arguments.front();
+            arguments.erase(arguments.begin());
+        }
+
+        SyntheticStudyOptions options;
+        std::vector<std::string> positional;
+        int repetitions = 1;
+        std::size_t resampledLineSize = 0;
+        std::size_t memoryBudget = 0;
+        std::string scratchDirectory;
+        ValuePrecision precision = ValuePrecision::Float32;
+        std::string reportFilePath;
+
+        for (std::size_t index = 0; index < arguments.size(); index++) {
+            const auto& argument = arguments[index];
+            const auto hasValue = index + 1 < arguments.size();
+
+            if (argument == "--help" || argument == "-h") {
+                printUsage();
+                return 0;
+            }
+            else if (argument == "--binary") {
+                options.binary = true;
+            }
+            else if (argument == "--report" && hasValue) {
+                reportFilePath = arguments[++index];
+            }
+            else if (argument == "--scratch" && hasValue) {
+                scratchDirectory = arguments[++index];
+            }
+            else if (argument == "--precision" && hasValue) {
+                const auto& value = arguments[++index];
+
+                if (value == "bf16")
+                    precision = ValuePrecision::BFloat16;
+                else if (value == "int16")
+                    precision = ValuePrecision::ScaledInt16;
+                else {
+                    printUsage();
+                    return 1;
+                }
+            }
+            else if (argument.compare(0, 2, "--") == 0 && hasValue) {
+                const auto value = std::stoll(arguments[++index]);
+
+                if (argument == "--lines")              options.numberOfLines = static_cast<std::size_t>(value);
+                else if (argument == "--points")        options.pointsPerLine = static_cast<std::size_t>(value);
+                else if (argument == "--timepoints")    options.timepoints = static_cast<int>(value);
+                else if (argument == "--groups")        options.groups = static_cast<int>(value);
+                else if (argument == "--reset")         options.resetPoint = static_cast<int>(value);
+                else if (argument == "--repeat")        repetitions = static_cast<int>(value);
+                else if (argument == "--resample")      resampledLineSize = static_cast<std::size_t>(value);
+                else if (argument == "--memory-budget") memoryBudget = static_cast<std::size_t>(value) << 20;
+                else {
+                    printUsage();
+                    return 1;
+                }
+            }
+            else if (argument.compare(0, 2, "--") == 0) {
+                printUsage();
+                return 1;
+            }
+            else {
+                positional.push_back(argument);
+            }
+        }
+
+        if (mode == "generate") {
+            if (positional.size() != 1) {
+                printUsage();
+                return 1;
+            }
+
+            const auto start = Clock::now();
+            const auto filePaths = writeSyntheticStudy(positional.front(), options);
+
+            std::printf("wrote %zu files in %.3f s\n", filePaths.size(), std::chrono::duration<double>(Clock::now() - start).count());
+            return 0;
+        }
+
+        if (mode == "run") {
+            std::vector<std::string> filePaths;
+
+            for (const auto& argument : positional)
+                addFiles(argument, filePaths);
+
+            if (filePaths.empty()) {
+                printUsage();
+                return 1;
+            }
+
+            return runBenchmark(filePaths, repetitions, precision, resampledLineSize, memoryBudget, scratchDirectory, reportFilePath);
+        }
+
+        const auto directory = std::filesystem::temp_directory_path() / "VTKLoaderBenchmark";
+        const auto filePaths = writeSyntheticStudy(directory.u8string(), options);
+        const auto result = runBenchmark(filePaths, repetitions, precision, resampledLineSize, memoryBudget, scratchDirectory, reportFilePath);
+
+        std::filesystem::remove_all(directory);
+
+        return result;
+    }
+    catch (const std::exception& exception) {
+        std::cerr << "Error: " << exception.what() << std::endl;
+        return 1;
+    }
+}
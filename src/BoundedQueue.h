@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// =============================================================================
+// Bounded queue
+// =============================================================================
+
+/**
+ * Queue handing values from a producing thread to a consuming thread, holding at most a fixed number of them.
+ * The producer blocks while the queue is full and the consumer while it is empty. Closing the queue ends the
+ * hand over from either side: the producer stops when the consumer gives up, the consumer when the producer is done.
+ */
+template <typename Value>
+class BoundedQueue
+{
+public:
+
+    /**
+     * Constructor
+     * @param capacity Maximum number of values in the queue, at least one
+     */
+    explicit BoundedQueue(std::size_t capacity) :
+        _capacity(capacity > 0 ? capacity : 1),
+        _values(),
+        _isClosed(false),
+        _mutex(),
+        _notFull(),
+        _notEmpty()
+    {
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * Add a value, waiting while the queue is full.
+     * @param value Value to add
+     * @return False if the queue was closed, the value is then dropped
+     */
+    bool push(Value value)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notFull.wait(lock, [this]() { return _isClosed || _values.size() < _capacity; });
+
+        if (_isClosed)
+            return false;
+
+        _values.push_back(std::move(value));
+        _notEmpty.notify_one();
+
+        return true;
+    }
+
+    /**
+     * Take the oldest value, waiting while the queue is empty and open.
+     * @param value Receives the value
+     * @return False once the queue is closed and empty
+     */
+    bool pop(Value& value)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _notEmpty.wait(lock, [this]() { return _isClosed || !_values.empty(); });
+
+        if (_values.empty())
+            return false;
+
+        value = std::move(_values.front());
+        _values.pop_front();
+        _notFull.notify_one();
+
+        return true;
+    }
+
+    /** Refuse further values and wake both sides, values already in the queue can still be taken */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _isClosed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+    }
+
+private:
+    const std::size_t           _capacity;
+    std::deque<Value>           _values;
+    bool                        _isClosed;
+    std::mutex                  _mutex;
+    std::condition_variable     _notFull;
+    std::condition_variable     _notEmpty;
+};
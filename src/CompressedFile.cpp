@@ -0,0 +1,327 @@
+#include "CompressedFile.h"
+#include "BoundedQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef VTKLOADER_HAS_ZLIB
+    #include <zlib.h>
+#endif
+
+#ifdef VTKLOADER_HAS_ZSTD
+    #include <zstd.h>
+#endif
+
+namespace
+{
+    /** Number of compressed bytes read at a time */
+    const std::size_t inputChunkSize = std::size_t(64) << 10;
+
+    /** Number of decompressed bytes handed over at a time, smaller files use a single chunk of their own size */
+    const std::size_t maximumChunkSize = std::size_t(1) << 20;
+    const std::size_t minimumChunkSize = std::size_t(64) << 10;
+
+    /** Number of decompressed chunks the decompression thread may run ahead */
+    const std::size_t queueCapacity = 4;
+
+    /**
+     * Decompressed size recorded in the file, from the trailer of the last gzip member (modulo 4 GB) or the header
+     * of the first zstd frame. Only used to size the contents up front, zero if unknown.
+     */
+    std::size_t recordedSize(const std::string& filePath, FileCompression compression)
+    {
+        std::ifstream stream(std::filesystem::u8path(filePath), std::ios::binary);
+
+        unsigned char bytes[18] = {};
+
+        if (compression == FileCompression::Gzip) {
+            if (!stream.seekg(-4, std::ios::end) || !stream.read(reinterpret_cast<char*>(bytes), 4))
+                return 0;
+
+            return std::size_t(bytes[0]) | std::size_t(bytes[1]) << 8 | std::size_t(bytes[2]) << 16 | std::size_t(bytes[3]) << 24;
+        }
+
+#ifdef VTKLOADER_HAS_ZSTD
+        stream.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+
+        const auto contentSize = ZSTD_getFrameContentSize(bytes, static_cast<std::size_t>(stream.gcount()));
+
+        if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR)
+            return static_cast<std::size_t>(contentSize);
+#endif
+
+        return 0;
+    }
+
+    bool hasExtension(const std::string& filePath, const std::string& extension)
+    {
+        if (filePath.size() < extension.size())
+            return false;
+
+        return std::equal(extension.begin(), extension.end(), filePath.end() - extension.size(), [](char expected, char character) {
+            return expected == std::tolower(static_cast<unsigned char>(character));
+        });
+    }
+
+    /** Reads a compressed file in chunks */
+    class InputFile
+    {
+    public:
+        explicit InputFile(const std::string& filePath) :
+            _stream(std::filesystem::u8path(filePath), std::ios::binary),
+            _chunk(inputChunkSize)
+        {
+        }
+
+        bool isOpen() const { return static_cast<bool>(_stream); }
+
+        /** Reads the next chunk, returns the number of bytes read, zero at the end of the file */
+        std::size_t read()
+        {
+            _stream.read(_chunk.data(), static_cast<std::streamsize>(_chunk.size()));
+
+            if (_stream.bad())
+                throw std::runtime_error("Unable to read the compressed file");
+
+            return static_cast<std::size_t>(_stream.gcount());
+        }
+
+        char* data() { return _chunk.data(); }
+
+    private:
+        std::ifstream       _stream;
+        std::vector<char>   _chunk;
+    };
+
+    /** Fills chunks of decompressed data and hands them to the queue */
+    class OutputChunks
+    {
+    public:
+        OutputChunks(BoundedQueue<std::vector<char>>& queue, std::size_t chunkSize) :
+            _queue(queue),
+            _chunkSize(chunkSize),
+            _chunk(chunkSize)
+        {
+        }
+
+        char* data() { return _chunk.data(); }
+        std::size_t capacity() const { return _chunk.size(); }
+
+        /** Hands over the first size bytes of the chunk, returns false when the consumer stopped taking chunks */
+        bool flush(std::size_t size)
+        {
+            if (size == 0)
+                return true;
+
+            _chunk.resize(size);
+
+            if (!_queue.push(std::move(_chunk)))
+                return false;
+
+            _chunk = std::vector<char>(_chunkSize);
+
+            return true;
+        }
+
+    private:
+        BoundedQueue<std::vector<char>>&    _queue;
+        const std::size_t                   _chunkSize;
+        std::vector<char>                   _chunk;
+    };
+
+    void decompressGzip(InputFile& input, OutputChunks& output)
+    {
+#ifdef VTKLOADER_HAS_ZLIB
+        z_stream stream = {};
+
+        // Accept gzip headers only (16 + MAX_WBITS).
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+            throw std::runtime_error("Unable to initialize zlib");
+
+        struct StreamGuard
+        {
+            z_stream& stream;
+            ~StreamGuard() { inflateEnd(&stream); }
+        } guard{ stream };
+
+        bool isInsideMember = false;
+        std::size_t inputSize;
+
+        while ((inputSize = input.read()) > 0) {
+            stream.next_in  = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = static_cast<uInt>(inputSize);
+
+            while (stream.avail_in > 0) {
+                stream.next_out     = reinterpret_cast<Bytef*>(output.data());
+                stream.avail_out    = static_cast<uInt>(output.capacity());
+
+                const auto result = inflate(&stream, Z_NO_FLUSH);
+
+                if (result != Z_OK && result != Z_STREAM_END)
+                    throw std::runtime_error(std::string("Corrupt gzip data: ") + (stream.msg != nullptr ? stream.msg : "inflate failed"));
+
+                isInsideMember = result != Z_STREAM_END;
+
+                if (!output.flush(output.capacity() - stream.avail_out))
+                    return;
+
+                // A further member may follow the end of a member.
+                if (result == Z_STREAM_END && inflateReset(&stream) != Z_OK)
+                    throw std::runtime_error("Unable to reset zlib");
+            }
+        }
+
+        if (isInsideMember)
+            throw std::runtime_error("Truncated gzip data");
+#else
+        (void)input;
+        (void)output;
+
+        throw std::runtime_error("gzip compressed files require zlib, which was not available when the plugin was built");
+#endif
+    }
+
+    void decompressZstd(InputFile& input, OutputChunks& output)
+    {
+#ifdef VTKLOADER_HAS_ZSTD
+        auto* stream = ZSTD_createDStream();
+
+        if (stream == nullptr)
+            throw std::runtime_error("Unable to initialize zstd");
+
+        struct StreamGuard
+        {
+            ZSTD_DStream* stream;
+            ~StreamGuard() { ZSTD_freeDStream(stream); }
+        } guard{ stream };
+
+        ZSTD_initDStream(stream);
+
+        std::size_t result = 0;
+        std::size_t inputSize;
+
+        while ((inputSize = input.read()) > 0) {
+            ZSTD_inBuffer in = { input.data(), inputSize, 0 };
+
+            while (in.pos < in.size) {
+                ZSTD_outBuffer out = { output.data(), output.capacity(), 0 };
+
+                result = ZSTD_decompressStream(stream, &out, &in);
+
+                if (ZSTD_isError(result))
+                    throw std::runtime_error(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(result));
+
+                if (!output.flush(out.pos))
+                    return;
+            }
+        }
+
+        // Data left in the decoder is flushed by calls without input.
+        while (result > 0) {
+            ZSTD_inBuffer in = { nullptr, 0, 0 };
+            ZSTD_outBuffer out = { output.data(), output.capacity(), 0 };
+
+            result = ZSTD_decompressStream(stream, &out, &in);
+
+            if (ZSTD_isError(result))
+                throw std::runtime_error(std::string("Corrupt zstd data: ") + ZSTD_getErrorName(result));
+
+            if (out.pos == 0 && result > 0)
+                throw std::runtime_error("Truncated zstd data");
+
+            if (!output.flush(out.pos))
+                return;
+        }
+#else
+        (void)input;
+        (void)output;
+
+        throw std::runtime_error("zstd compressed files require zstd, which was not available when the plugin was built");
+#endif
+    }
+}
+
+FileCompression fileCompression(const std::string& filePath)
+{
+    if (hasExtension(filePath, ".gz"))
+        return FileCompression::Gzip;
+
+    if (hasExtension(filePath, ".zst"))
+        return FileCompression::Zstd;
+
+    return FileCompression::None;
+}
+
+std::string withoutCompressionExtension(const std::string& filePath)
+{
+    switch (fileCompression(filePath))
+    {
+        case FileCompression::Gzip: return filePath.substr(0, filePath.size() - 3);
+        case FileCompression::Zstd: return filePath.substr(0, filePath.size() - 4);
+        case FileCompression::None: break;
+    }
+
+    return filePath;
+}
+
+bool decompressFile(const std::string& filePath, std::vector<char>& contents)
+{
+    const auto compression = fileCompression(filePath);
+
+    InputFile input(filePath);
+
+    if (!input.isOpen())
+        return false;
+
+    const auto expectedSize = recordedSize(filePath, compression);
+    const auto chunkSize = std::clamp(expectedSize > 0 ? expectedSize : maximumChunkSize, minimumChunkSize, maximumChunkSize);
+
+    contents.clear();
+    contents.reserve(expectedSize);
+
+    BoundedQueue<std::vector<char>> queue(queueCapacity);
+    std::exception_ptr exception;
+
+    std::thread decompressor([&input, &queue, &exception, compression, chunkSize]() {
+        try {
+            OutputChunks output(queue, chunkSize);
+
+            if (compression == FileCompression::Zstd)
+                decompressZstd(input, output);
+            else
+                decompressGzip(input, output);
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+
+        queue.close();
+    });
+
+    // The decompression thread stops at its next chunk when the contents can not be assembled.
+    try {
+        std::vector<char> chunk;
+
+        while (queue.pop(chunk))
+            contents.insert(contents.end(), chunk.begin(), chunk.end());
+    }
+    catch (...) {
+        queue.close();
+        decompressor.join();
+        throw;
+    }
+
+    decompressor.join();
+
+    if (exception)
+        std::rethrow_exception(exception);
+
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Compressed files
+// =============================================================================
+
+/** Compression of a file, told by its extension */
+enum class FileCompression
+{
+    None,
+    Gzip,       /** .gz, needs zlib */
+    Zstd        /** .zst, needs zstd */
+};
+
+/** Returns the compression of a file from its extension (.gz or .zst, any case) */
+FileCompression fileCompression(const std::string& filePath);
+
+/** Returns the path without its compression extension, e.g. study/t00.vtk for study/t00.vtk.gz */
+std::string withoutCompressionExtension(const std::string& filePath);
+
+/**
+ * Decompress a gzip or zstd compressed file into memory, without writing temporary files.
+ * The file is read and decompressed on a thread of its own, which hands the decompressed data over in chunks
+ * through a bounded queue, so reading the compressed file overlaps with assembling its contents and at most a few
+ * chunks are in flight. Concatenated gzip members and zstd frames are decompressed one after the other.
+ * Throws std::runtime_error for corrupt or truncated data and for compressions the build does not support.
+ * @param filePath UTF-8 encoded path of the file
+ * @param contents Receives the decompressed contents
+ * @return False if the file could not be opened
+ */
+bool decompressFile(const std::string& filePath, std::vector<char>& contents);
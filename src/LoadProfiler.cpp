@@ -0,0 +1,249 @@
+#include "LoadProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #define PSAPI_VERSION 2
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+namespace
+{
+    /** Escapes a string for use inside a JSON string literal */
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+
+        for (const auto character : text) {
+            switch (character)
+            {
+                case '"':   escaped += "\\\""; break;
+                case '\\':  escaped += "\\\\"; break;
+                case '\n':  escaped += "\\n"; break;
+                case '\r':  escaped += "\\r"; break;
+                case '\t':  escaped += "\\t"; break;
+
+                default:
+                    if (static_cast<unsigned char>(character) < 0x20) {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(character));
+                        escaped += code;
+                    }
+                    else {
+                        escaped += character;
+                    }
+            }
+        }
+
+        return escaped;
+    }
+
+    double toMegabytes(std::size_t numberOfBytes)
+    {
+        return numberOfBytes / (1024.0 * 1024.0);
+    }
+}
+
+LoadProfiler::Scope::Scope(LoadProfiler* profiler, const char* stage, std::size_t numberOfBytes, std::size_t numberOfElements) :
+    _profiler(profiler),
+    _stage(stage),
+    _numberOfBytes(numberOfBytes),
+    _numberOfElements(numberOfElements),
+    _start()
+{
+    if (_profiler != nullptr)
+        _start = Clock::now();
+}
+
+LoadProfiler::Scope::~Scope()
+{
+    if (_profiler != nullptr)
+        _profiler->record(_stage, _start, Clock::now(), _numberOfBytes, _numberOfElements);
+}
+
+LoadProfiler::LoadProfiler() :
+    _created(Clock::now()),
+    _stages(),
+    _mutex()
+{
+}
+
+void LoadProfiler::record(const std::string& stage, Clock::time_point start, Clock::time_point end, std::size_t numberOfBytes, std::size_t numberOfElements)
+{
+    // Sampled outside of the lock, reading the process status is the expensive part of a measurement.
+    const auto peakMemory = peakResidentMemory();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto stageIterator = std::find_if(_stages.begin(), _stages.end(), [&stage](const Stage& candidate) {
+        return candidate.name == stage;
+    });
+
+    if (stageIterator == _stages.end()) {
+        Stage newStage;
+
+        newStage.name       = stage;
+        newStage.firstStart = start;
+        newStage.lastEnd    = end;
+
+        stageIterator = _stages.insert(_stages.end(), newStage);
+    }
+
+    auto& measurements = *stageIterator;
+
+    measurements.calls++;
+    measurements.seconds            += std::chrono::duration<double>(end - start).count();
+    measurements.numberOfBytes      += numberOfBytes;
+    measurements.numberOfElements   += numberOfElements;
+    measurements.peakResidentMemory = std::max(measurements.peakResidentMemory, peakMemory);
+    measurements.firstStart         = std::min(measurements.firstStart, start);
+    measurements.lastEnd            = std::max(measurements.lastEnd, end);
+    measurements.wallSeconds        = std::chrono::duration<double>(measurements.lastEnd - measurements.firstStart).count();
+}
+
+std::vector<LoadProfiler::Stage> LoadProfiler::stages() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _stages;
+}
+
+double LoadProfiler::totalSeconds() const
+{
+    return std::chrono::duration<double>(Clock::now() - _created).count();
+}
+
+std::string LoadProfiler::summary() const
+{
+    std::string text;
+    char line[256];
+
+    std::snprintf(line, sizeof(line), "%-14s %6s %10s %10s %10s %12s %12s\n", "stage", "calls", "wall s", "busy s", "MB/s", "Melements/s", "peak RSS MB");
+    text += line;
+
+    for (const auto& stage : stages()) {
+        const auto seconds = stage.wallSeconds;
+
+        std::snprintf(line, sizeof(line), "%-14s %6zu %10.3f %10.3f %10.1f %12.2f %12.1f\n", stage.name.c_str(), stage.calls, stage.wallSeconds, stage.seconds,
+            seconds > 0.0 ? toMegabytes(stage.numberOfBytes) / seconds : 0.0,
+            seconds > 0.0 ? stage.numberOfElements / seconds / 1.0e6 : 0.0,
+            toMegabytes(stage.peakResidentMemory));
+
+        text += line;
+    }
+
+    std::snprintf(line, sizeof(line), "%-14s %6s %10.3f\n", "total", "", totalSeconds());
+    text += line;
+
+    return text;
+}
+
+std::string LoadProfiler::toJson(const std::string& label) const
+{
+    std::string json = "{\n";
+    char value[512];
+
+    json += "  \"label\": \"" + escapeJson(label) + "\",\n";
+
+    std::snprintf(value, sizeof(value), "  \"totalSeconds\": %.6f,\n", totalSeconds());
+    json += value;
+
+    json += "  \"stages\": [";
+
+    const auto measuredStages = stages();
+
+    for (std::size_t stageIndex = 0; stageIndex < measuredStages.size(); stageIndex++) {
+        const auto& stage = measuredStages[stageIndex];
+
+        std::snprintf(value, sizeof(value),
+            "%s\n    { \"name\": \"%s\", \"calls\": %zu, \"wallSeconds\": %.6f, \"busySeconds\": %.6f, \"bytes\": %zu, \"elements\": %zu, \"peakResidentBytes\": %zu }",
+            stageIndex > 0 ? "," : "", escapeJson(stage.name).c_str(), stage.calls, stage.wallSeconds, stage.seconds, stage.numberOfBytes, stage.numberOfElements, stage.peakResidentMemory);
+
+        json += value;
+    }
+
+    json += measuredStages.empty() ? "]\n}\n" : "\n  ]\n}\n";
+
+    return json;
+}
+
+bool LoadProfiler::writeJson(const std::string& filePath, const std::string& label) const
+{
+    std::ofstream stream(std::filesystem::u8path(filePath), std::ios::binary | std::ios::trunc);
+
+    if (!stream)
+        return false;
+
+    const auto json = toJson(label);
+
+    stream.write(json.data(), json.size());
+
+    return static_cast<bool>(stream.flush());
+}
+
+bool LoadProfiler::writeJsonArray(const std::string& filePath, const std::vector<std::string>& reports)
+{
+    std::ofstream stream(std::filesystem::u8path(filePath), std::ios::binary | std::ios::trunc);
+
+    if (!stream)
+        return false;
+
+    std::string json = "[\n";
+
+    for (std::size_t index = 0; index < reports.size(); index++) {
+        json += reports[index];
+
+        // Every report ends with a line break, the separator goes before it.
+        if (index + 1 < reports.size())
+            json.insert(json.size() - 1, ",");
+    }
+
+    json += "]\n";
+
+    stream.write(json.data(), json.size());
+
+    return static_cast<bool>(stream.flush());
+}
+
+std::size_t LoadProfiler::peakResidentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+
+    return 0;
+#else
+    // The high water mark of /proc can be reset between measurements (see /proc/self/clear_refs), getrusage can not.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+
+    rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Load profiler
+// =============================================================================
+
+/**
+ * Collects the time, bytes, element counts and peak memory of the stages of an import.
+ *
+ * Stages are timed by Scope objects, which may run on any thread and nest. Per stage the profiler keeps the sum
+ * of the scope durations (busy time, which exceeds the wall time when a stage runs on several threads at once) and
+ * the wall time from the start of its first scope to the end of its last. The peak resident memory of the process
+ * is sampled when a scope ends. Stages are reported in the order in which they were first entered, as text for the
+ * log or as a JSON report.
+ */
+class LoadProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Times a stage from construction to destruction, does nothing without a profiler */
+    class Scope
+    {
+    public:
+
+        /**
+         * Constructor
+         * @param profiler Profiler receiving the measurement, may be nullptr
+         * @param stage Name of the stage
+         * @param numberOfBytes Number of bytes the stage reads or writes, if known up front
+         * @param numberOfElements Number of elements (points, values) the stage handles, if known up front
+         */
+        Scope(LoadProfiler* profiler, const char* stage, std::size_t numberOfBytes = 0, std::size_t numberOfElements = 0);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(std::size_t numberOfBytes) { _numberOfBytes += numberOfBytes; }
+        void addElements(std::size_t numberOfElements) { _numberOfElements += numberOfElements; }
+
+    private:
+        LoadProfiler*       _profiler;
+        const char*         _stage;
+        std::size_t         _numberOfBytes;
+        std::size_t         _numberOfElements;
+        Clock::time_point   _start;
+    };
+
+    /** Measurements of one stage */
+    struct Stage
+    {
+        std::string         name;
+        std::size_t         calls = 0;
+        double              seconds = 0.0;          /** Sum of the scope durations */
+        double              wallSeconds = 0.0;      /** From the start of the first scope to the end of the last */
+        std::size_t         numberOfBytes = 0;
+        std::size_t         numberOfElements = 0;
+        std::size_t         peakResidentMemory = 0; /** Largest peak resident memory sampled at the end of a scope, in bytes */
+        Clock::time_point   firstStart;
+        Clock::time_point   lastEnd;
+    };
+
+    LoadProfiler();
+
+    /**
+     * Add a measurement to a stage.
+     * @param stage Name of the stage
+     * @param start Start of the measurement
+     * @param end End of the measurement
+     * @param numberOfBytes Number of bytes read or written
+     * @param numberOfElements Number of elements handled
+     */
+    void record(const std::string& stage, Clock::time_point start, Clock::time_point end, std::size_t numberOfBytes, std::size_t numberOfElements);
+
+    /** Returns the stages in the order in which they were first entered */
+    std::vector<Stage> stages() const;
+
+    /** Wall time since the profiler was created */
+    double totalSeconds() const;
+
+    /** Returns one line per stage with its time, throughput and peak memory */
+    std::string summary() const;
+
+    /**
+     * Returns the measurements as a JSON object.
+     * @param label Free text identifying the import, e.g. the name of the study
+     */
+    std::string toJson(const std::string& label = std::string()) const;
+
+    /**
+     * Write the JSON report to a file, replacing it.
+     * @param filePath UTF-8 encoded path of the report
+     * @param label Free text identifying the import
+     * @return True if the report was written
+     */
+    bool writeJson(const std::string& filePath, const std::string& label = std::string()) const;
+
+    /**
+     * Write several JSON reports to a file as one JSON array, replacing it.
+     * @param filePath UTF-8 encoded path of the report
+     * @param reports JSON objects returned by toJson()
+     * @return True if the report was written
+     */
+    static bool writeJsonArray(const std::string& filePath, const std::vector<std::string>& reports);
+
+    /** Peak resident memory of the process in bytes (VmHWM on Linux, the maximum resident set elsewhere), zero where unavailable */
+    static std::size_t peakResidentMemory();
+
+private:
+    Clock::time_point   _created;
+    std::vector<Stage>  _stages;
+    mutable std::mutex  _mutex;
+};
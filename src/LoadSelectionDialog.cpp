@@ -0,0 +1,214 @@
+#include "LoadSelectionDialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <limits>
+
+LoadSelectionDialog::LoadSelectionDialog(int numberOfGroups, int numberOfTimepoints, bool isPathlineStudy, const LoadSelection& selection, ValuePrecision precision, std::size_t resampledLineSize, bool compactLayout, bool watchDirectory, QWidget* parent) :
+    QDialog(parent),
+    _groupList(new QListWidget(this)),
+    _firstTimepoint(new QSpinBox(this)),
+    _lastTimepoint(new QSpinBox(this)),
+    _lineStride(new QSpinBox(this)),
+    _sampleSize(new QSpinBox(this)),
+    _resampledLineSize(new QSpinBox(this)),
+    _minimumSpeed(new QDoubleSpinBox(this)),
+    _maskFilePath(new QLineEdit(this)),
+    _precision(new QComboBox(this)),
+    _compactLayout(new QCheckBox("Store index, time and group once per pathline", this)),
+    _watchDirectory(new QCheckBox("Append timepoints that arrive later", this))
+{
+    setWindowTitle("Import VTK study");
+
+    for (int group = 0; group < numberOfGroups; group++) {
+        auto* item = new QListWidgetItem(QString("Group %1").arg(group), _groupList);
+
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
+    }
+
+    const auto lastTimepoint = std::max(numberOfTimepoints, 1) - 1;
+
+    _firstTimepoint->setRange(0, lastTimepoint);
+    _firstTimepoint->setValue(std::min(selection.firstTimepoint, lastTimepoint));
+
+    _lastTimepoint->setRange(0, lastTimepoint);
+    _lastTimepoint->setValue(selection.lastTimepoint < 0 ? lastTimepoint : std::min(selection.lastTimepoint, lastTimepoint));
+
+    // The window can not be empty.
+    connect(_firstTimepoint, qOverload<int>(&QSpinBox::valueChanged), this, [this](int value) {
+        if (_lastTimepoint->value() < value)
+            _lastTimepoint->setValue(value);
+    });
+
+    connect(_lastTimepoint, qOverload<int>(&QSpinBox::valueChanged), this, [this](int value) {
+        if (_firstTimepoint->value() > value)
+            _firstTimepoint->setValue(value);
+    });
+
+    _lineStride->setRange(1, std::numeric_limits<int>::max());
+    _lineStride->setValue(static_cast<int>(std::max<std::size_t>(selection.lineStride, 1)));
+    _lineStride->setToolTip("Load every n-th pathline of each group");
+
+    _sampleSize->setRange(0, std::numeric_limits<int>::max());
+    _sampleSize->setValue(static_cast<int>(selection.sampleSize));
+    _sampleSize->setSpecialValueText("All");
+    _sampleSize->setToolTip("Load a random sample of this many pathlines per group");
+
+    _resampledLineSize->setRange(0, 100000);
+    _resampledLineSize->setValue(static_cast<int>(std::min<std::size_t>(resampledLineSize, 100000)));
+    _resampledLineSize->setSpecialValueText("As stitched");
+    _resampledLineSize->setToolTip("Resample every pathline to this many points, evenly spaced along the pathline");
+
+    _minimumSpeed->setRange(0.0, std::numeric_limits<float>::max());
+    _minimumSpeed->setDecimals(4);
+    _minimumSpeed->setValue(selection.minimumSpeed);
+    _minimumSpeed->setSpecialValueText("All voxels");
+    _minimumSpeed->setToolTip("Load only the voxels with at least this velocity magnitude");
+
+    _maskFilePath->setText(QString::fromStdString(selection.maskFilePath));
+    _maskFilePath->setPlaceholderText("All voxels");
+    _maskFilePath->setToolTip("Volume file whose first scalar array is nonzero for the voxels to load");
+
+    auto* browseButton = new QPushButton("Browse...", this);
+
+    connect(browseButton, &QPushButton::clicked, this, [this]() {
+        const auto filePath = QFileDialog::getOpenFileName(this, "Open mask file", _maskFilePath->text(), "VTK files (*.vtk *.vtu);;All files (*)");
+
+        if (!filePath.isEmpty())
+            _maskFilePath->setText(filePath);
+    });
+
+    auto* maskLayout = new QHBoxLayout();
+
+    maskLayout->addWidget(_maskFilePath);
+    maskLayout->addWidget(browseButton);
+
+    // Items are in the order of ValuePrecision.
+    _precision->addItem("32 bit float");
+    _precision->addItem("bfloat16 (half the memory)");
+    _precision->addItem("Scaled 16 bit integer (half the memory)");
+    _precision->setCurrentIndex(static_cast<int>(precision));
+
+    _compactLayout->setChecked(compactLayout);
+    _compactLayout->setToolTip("Keep only the position, speed and difference vector per point, the groups become clusters. Not available for resampled pathlines, whose points have different timepoints in every pathline");
+
+    // The compact layout keeps one timepoint per point position, resampled pathlines do not share them.
+    _compactLayout->setEnabled(_resampledLineSize->value() == 0);
+
+    connect(_resampledLineSize, qOverload<int>(&QSpinBox::valueChanged), this, [this](int value) {
+        _compactLayout->setEnabled(value == 0);
+    });
+
+    _watchDirectory->setChecked(watchDirectory);
+    _watchDirectory->setToolTip("Watch the directory of the study and append new timepoint files to the dataset. Keeps a copy of the dataset values, about twice the memory, and the float values of volume studies stored as scaled 16 bit integers");
+
+    auto* formLayout = new QFormLayout();
+
+    formLayout->addRow("Groups", _groupList);
+    formLayout->addRow("First timepoint", _firstTimepoint);
+    formLayout->addRow("Last timepoint", _lastTimepoint);
+
+    // Only the options that apply to the kind of study are shown.
+    if (isPathlineStudy) {
+        formLayout->addRow("Pathline stride", _lineStride);
+        formLayout->addRow("Pathline sample", _sampleSize);
+        formLayout->addRow("Points per pathline", _resampledLineSize);
+        formLayout->addRow("Layout", _compactLayout);
+
+        _minimumSpeed->hide();
+        _maskFilePath->hide();
+        browseButton->hide();
+    }
+    else {
+        formLayout->addRow("Minimum speed", _minimumSpeed);
+        formLayout->addRow("Mask", maskLayout);
+
+        _lineStride->hide();
+        _sampleSize->hide();
+        _resampledLineSize->hide();
+        _compactLayout->hide();
+    }
+
+    formLayout->addRow("Precision", _precision);
+    formLayout->addRow("Directory", _watchDirectory);
+
+    auto* buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    // At least one group has to be loaded.
+    connect(_groupList, &QListWidget::itemChanged, this, [this, buttonBox]() {
+        bool anyChecked = false;
+
+        for (int row = 0; row < _groupList->count(); row++)
+            anyChecked |= _groupList->item(row)->checkState() == Qt::Checked;
+
+        buttonBox->button(QDialogButtonBox::Ok)->setEnabled(anyChecked);
+    });
+
+    auto* layout = new QVBoxLayout(this);
+
+    layout->addLayout(formLayout);
+    layout->addWidget(buttonBox);
+}
+
+LoadSelection LoadSelectionDialog::selection() const
+{
+    LoadSelection selection;
+
+    // All groups are selected by leaving the list empty, which keeps the cache entry of a full import.
+    bool allChecked = true;
+
+    for (int row = 0; row < _groupList->count(); row++) {
+        if (_groupList->item(row)->checkState() == Qt::Checked)
+            selection.groups.push_back(row);
+        else
+            allChecked = false;
+    }
+
+    if (allChecked)
+        selection.groups.clear();
+
+    selection.firstTimepoint    = _firstTimepoint->value();
+    selection.lastTimepoint     = _lastTimepoint->value() == _lastTimepoint->maximum() ? -1 : _lastTimepoint->value();
+    selection.lineStride        = static_cast<std::size_t>(_lineStride->value());
+    selection.sampleSize        = static_cast<std::size_t>(_sampleSize->value());
+    selection.minimumSpeed      = static_cast<float>(_minimumSpeed->value());
+    selection.maskFilePath      = _maskFilePath->text().trimmed().toStdString();
+
+    return selection;
+}
+
+ValuePrecision LoadSelectionDialog::precision() const
+{
+    return static_cast<ValuePrecision>(_precision->currentIndex());
+}
+
+std::size_t LoadSelectionDialog::resampledLineSize() const
+{
+    return _resampledLineSize->isHidden() ? 0 : static_cast<std::size_t>(_resampledLineSize->value());
+}
+
+bool LoadSelectionDialog::compactLayout() const
+{
+    return _compactLayout->isChecked() && !_compactLayout->isHidden() && resampledLineSize() == 0;
+}
+
+bool LoadSelectionDialog::watchDirectory() const
+{
+    return _watchDirectory->isChecked();
+}
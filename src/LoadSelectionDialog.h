@@ -0,0 +1,69 @@
+#pragma once
+
+#include "VTKStudyLoader.h"
+#include "ReducedPrecision.h"
+
+#include <QDialog>
+
+class QCheckBox;
+class QComboBox;
+class QDoubleSpinBox;
+class QLineEdit;
+class QListWidget;
+class QSpinBox;
+
+// =============================================================================
+// Load selection dialog
+// =============================================================================
+
+/**
+ * Lets the user pick the part of a study to import: the groups, a window of timepoints and a stride or random
+ * sample of the pathlines of every group, or the mask and speed threshold of the voxels of a volume study, as well
+ * as the precision and layout in which the points are stored and whether timepoints that arrive later are appended.
+ */
+class LoadSelectionDialog : public QDialog
+{
+public:
+
+    /**
+     * Constructor
+     * @param numberOfGroups Number of groups in the study
+     * @param numberOfTimepoints Number of timepoints per group
+     * @param isPathlineStudy Whether the study holds pathlines, otherwise it holds volumes
+     * @param selection Selection shown initially, its groups are ignored and all groups are checked
+     * @param precision Precision shown initially
+     * @param resampledLineSize Number of points per resampled pathline shown initially, zero if not resampled
+     * @param compactLayout Whether the compact pathline layout is checked initially
+     * @param watchDirectory Whether watching the directory is checked initially
+     * @param parent Parent widget
+     */
+    LoadSelectionDialog(int numberOfGroups, int numberOfTimepoints, bool isPathlineStudy, const LoadSelection& selection, ValuePrecision precision, std::size_t resampledLineSize, bool compactLayout, bool watchDirectory, QWidget* parent = nullptr);
+
+    /** Returns the selection made in the dialog */
+    LoadSelection selection() const;
+
+    /** Returns the precision chosen in the dialog */
+    ValuePrecision precision() const;
+
+    /** Returns the number of points to resample every pathline to, zero keeps the stitched points */
+    std::size_t resampledLineSize() const;
+
+    /** Returns whether the index, time and group of pathlines are stored once per pathline instead of per point */
+    bool compactLayout() const;
+
+    /** Returns whether files that arrive in the directory of the study are appended to it */
+    bool watchDirectory() const;
+
+private:
+    QListWidget*    _groupList;
+    QSpinBox*       _firstTimepoint;
+    QSpinBox*       _lastTimepoint;
+    QSpinBox*       _lineStride;
+    QSpinBox*       _sampleSize;
+    QSpinBox*       _resampledLineSize;
+    QDoubleSpinBox* _minimumSpeed;
+    QLineEdit*      _maskFilePath;
+    QComboBox*      _precision;
+    QCheckBox*      _compactLayout;
+    QCheckBox*      _watchDirectory;
+};
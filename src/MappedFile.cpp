@@ -0,0 +1,232 @@
+#include "MappedFile.h"
+#include "CompressedFile.h"
+
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    // Points at a valid (empty) range for files of zero bytes, which cannot be mapped.
+    const char emptyFile[1] = { '\0' };
+}
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+    open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        swap(other);
+    }
+
+    return *this;
+}
+
+void MappedFile::swap(MappedFile& other) noexcept
+{
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_isOpen, other._isOpen);
+    std::swap(_contents, other._contents);
+    std::swap(_isDecompressed, other._isDecompressed);
+#ifdef _WIN32
+    std::swap(_fileHandle, other._fileHandle);
+    std::swap(_mappingHandle, other._mappingHandle);
+#endif
+}
+
+bool MappedFile::openCompressed(const std::string& filePath)
+{
+    if (!decompressFile(filePath, _contents))
+        return false;
+
+    _data = _contents.empty() ? emptyFile : _contents.data();
+    _size = _contents.size();
+    _isOpen = true;
+    _isDecompressed = true;
+
+    return true;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filePath)
+{
+    close();
+
+    if (fileCompression(filePath) != FileCompression::None)
+        return openCompressed(filePath);
+
+    // Paths are passed around as UTF-8, the wide API is needed for non-ASCII file names.
+    const int length = MultiByteToWideChar(CP_UTF8, 0, filePath.c_str(), -1, nullptr, 0);
+    std::wstring widePath(length, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, filePath.c_str(), -1, widePath.data(), length);
+
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    _fileHandle = file;
+    _size = static_cast<std::size_t>(fileSize.QuadPart);
+    _isOpen = true;
+
+    if (_size == 0) {
+        _data = emptyFile;
+        return true;
+    }
+
+    _mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mappingHandle == nullptr) {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const char*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::release(const char* begin, const char* end) const
+{
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    const auto pageSize = static_cast<std::uintptr_t>(systemInfo.dwPageSize);
+    const auto first    = (reinterpret_cast<std::uintptr_t>(begin) + pageSize - 1) / pageSize * pageSize;
+    const auto last     = reinterpret_cast<std::uintptr_t>(end) / pageSize * pageSize;
+
+    // Unlocking pages that are not locked removes them from the working set.
+    if (_data != emptyFile && !_isDecompressed && first < last)
+        VirtualUnlock(reinterpret_cast<void*>(first), last - first);
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr && _data != emptyFile && !_isDecompressed)
+        UnmapViewOfFile(_data);
+
+    if (_mappingHandle != nullptr)
+        CloseHandle(_mappingHandle);
+
+    if (_fileHandle != nullptr)
+        CloseHandle(_fileHandle);
+
+    _data = nullptr;
+    _size = 0;
+    _isOpen = false;
+    _isDecompressed = false;
+
+    std::vector<char>().swap(_contents);
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filePath)
+{
+    close();
+
+    if (fileCompression(filePath) != FileCompression::None)
+        return openCompressed(filePath);
+
+    const int file = ::open(filePath.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStatus;
+    if (fstat(file, &fileStatus) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    _size = static_cast<std::size_t>(fileStatus.st_size);
+
+    if (_size == 0) {
+        ::close(file);
+        _data = emptyFile;
+        _isOpen = true;
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps its own reference to the file.
+    ::close(file);
+
+    if (mapping == MAP_FAILED) {
+        _size = 0;
+        return false;
+    }
+
+    // The parsers read front to back.
+    madvise(mapping, _size, MADV_SEQUENTIAL);
+
+    _data = static_cast<const char*>(mapping);
+    _isOpen = true;
+
+    return true;
+}
+
+void MappedFile::release(const char* begin, const char* end) const
+{
+    static const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    // Only whole pages inside the range are released.
+    const auto first    = (reinterpret_cast<std::uintptr_t>(begin) + pageSize - 1) / pageSize * pageSize;
+    const auto last     = reinterpret_cast<std::uintptr_t>(end) / pageSize * pageSize;
+
+    // The mapping is read only, so dropped pages are simply read again from the page cache when needed.
+    if (_data != emptyFile && !_isDecompressed && first < last)
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+}
+
+void MappedFile::close()
+{
+    if (_data != nullptr && _data != emptyFile && !_isDecompressed)
+        munmap(const_cast<char*>(_data), _size);
+
+    _data = nullptr;
+    _size = 0;
+    _isOpen = false;
+    _isDecompressed = false;
+
+    std::vector<char>().swap(_contents);
+}
+
+#endif
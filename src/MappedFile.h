@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Memory mapped file
+// =============================================================================
+
+/**
+ * Read-only memory mapping of a file on disk.
+ * The parsers walk the mapped bytes in place, so a file is never copied into an intermediate string.
+ * The mapping is released when the object is destroyed, the object can be moved but not copied.
+ * Files compressed with gzip (.gz) or zstd (.zst) are decompressed into memory instead of being mapped (see
+ * decompressFile()), so every reader accepts them; their contents stay resident and release() leaves them alone.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Map the file at the given path, any previous mapping is released first.
+     * Throws std::runtime_error if a compressed file can not be decompressed.
+     * @param filePath UTF-8 encoded path of the file
+     * @return True if the file could be opened and mapped
+     */
+    bool open(const std::string& filePath);
+
+    /** Release the mapping */
+    void close();
+
+    /**
+     * Tell the operating system that a range of the mapping has been consumed, so its pages no longer count
+     * against the resident memory of the process. The range stays readable, pages are mapped in again on access.
+     * @param begin Start of the range
+     * @param end End of the range
+     */
+    void release(const char* begin, const char* end) const;
+
+    bool isOpen() const { return _isOpen; }
+    const char* data() const { return _data; }
+    const char* end() const { return _data + _size; }
+    std::size_t size() const { return _size; }
+
+private:
+    void swap(MappedFile& other) noexcept;
+
+    /** Decompresses a compressed file into _contents */
+    bool openCompressed(const std::string& filePath);
+
+private:
+    const char* _data = nullptr;
+    std::size_t _size = 0;
+    bool _isOpen = false;
+    std::vector<char> _contents;        /** Decompressed contents of a compressed file */
+    bool _isDecompressed = false;
+
+#ifdef _WIN32
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#endif
+};
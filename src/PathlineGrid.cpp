@@ -0,0 +1,446 @@
+#include "PathlineGrid.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    /** Largest number of cells along an axis */
+    constexpr std::uint32_t maximumResolution = 256;
+
+    /** Leads the serialized index */
+    struct GridHeader
+    {
+        char            magic[4];
+        std::uint32_t   version;
+        float           origin[3];
+        float           cellSize[3];
+        std::uint32_t   resolution[3];
+        std::uint32_t   reserved;
+        std::uint64_t   numberOfLines;
+        std::uint64_t   numberOfEntries;        /** Number of rows listed over all cells */
+    };
+
+    const char gridMagic[4] = { 'V', 'T', 'K', 'G' };
+
+    constexpr std::uint32_t gridVersion = 1;
+
+    /** Bounds and summed box extents of a block of rows */
+    struct BlockBounds
+    {
+        std::array<float, 3>    minimum = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        std::array<float, 3>    maximum = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+        std::array<double, 3>   extents = { 0.0, 0.0, 0.0 };
+    };
+}
+
+template <typename Function>
+void PathlineGrid::forEachCell(const std::array<float, 6>& bounds, Function&& function) const
+{
+    const std::array<std::uint32_t, 3> first    = { cellCoordinate(bounds[0], 0), cellCoordinate(bounds[1], 1), cellCoordinate(bounds[2], 2) };
+    const std::array<std::uint32_t, 3> last     = { cellCoordinate(bounds[3], 0), cellCoordinate(bounds[4], 1), cellCoordinate(bounds[5], 2) };
+
+    for (auto z = first[2]; z <= last[2]; z++)
+        for (auto y = first[1]; y <= last[1]; y++)
+            for (auto x = first[0]; x <= last[0]; x++)
+                function(x + _resolution[0] * (y + static_cast<std::size_t>(_resolution[1]) * z));
+}
+
+PathlineGrid PathlineGrid::build(const float* data, std::size_t numRows, std::size_t numDimensions, std::size_t lineSize)
+{
+    if (numRows > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Too many pathlines to be indexed");
+
+    PathlineGrid grid;
+
+    grid._lineBounds.resize(numRows);
+    grid._seeds.resize(numRows);
+
+    const auto numColumns = lineSize > 0 ? numDimensions / lineSize : 0;
+
+    // The bounding boxes touch the whole matrix, they are computed in blocks of rows, in parallel.
+    const std::size_t blockSize = 4096;
+    const auto numberOfBlocks = (numRows + blockSize - 1) / blockSize;
+
+    std::vector<BlockBounds> blockBounds(numberOfBlocks);
+
+    ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+        auto& bounds = blockBounds[blockIndex];
+
+        const auto firstRow = blockIndex * blockSize;
+        const auto endRow   = std::min(firstRow + blockSize, numRows);
+
+        for (auto row = firstRow; row < endRow; row++) {
+            const auto* point = data + row * numDimensions;
+
+            std::array<float, 6> lineBounds = { point[0], point[1], point[2], point[0], point[1], point[2] };
+
+            for (std::size_t pointIndex = 1; pointIndex < lineSize; pointIndex++) {
+                point += numColumns;
+
+                for (std::size_t axis = 0; axis < 3; axis++) {
+                    lineBounds[axis]        = std::min(lineBounds[axis], point[axis]);
+                    lineBounds[axis + 3]    = std::max(lineBounds[axis + 3], point[axis]);
+                }
+            }
+
+            const auto* seed = data + row * numDimensions;
+
+            grid._seeds[row]        = { seed[0], seed[1], seed[2] };
+            grid._lineBounds[row]   = lineBounds;
+
+            for (std::size_t axis = 0; axis < 3; axis++) {
+                bounds.minimum[axis] = std::min(bounds.minimum[axis], lineBounds[axis]);
+                bounds.maximum[axis] = std::max(bounds.maximum[axis], lineBounds[axis + 3]);
+                bounds.extents[axis] += lineBounds[axis + 3] - lineBounds[axis];
+            }
+        }
+    });
+
+    BlockBounds studyBounds;
+
+    for (const auto& bounds : blockBounds) {
+        for (std::size_t axis = 0; axis < 3; axis++) {
+            studyBounds.minimum[axis] = std::min(studyBounds.minimum[axis], bounds.minimum[axis]);
+            studyBounds.maximum[axis] = std::max(studyBounds.maximum[axis], bounds.maximum[axis]);
+            studyBounds.extents[axis] += bounds.extents[axis];
+        }
+    }
+
+    // Cells about as large as the mean box, so a row lands in a few cells, with at most about one cell per row.
+    std::size_t numberOfCells = 1;
+
+    for (std::size_t axis = 0; axis < 3; axis++) {
+        const auto extent       = numRows > 0 ? static_cast<double>(studyBounds.maximum[axis]) - studyBounds.minimum[axis] : 0.0;
+        const auto meanExtent   = numRows > 0 ? studyBounds.extents[axis] / numRows : 0.0;
+
+        grid._origin[axis]      = numRows > 0 ? studyBounds.minimum[axis] : 0.0f;
+        grid._resolution[axis]  = meanExtent > 0.0 ? static_cast<std::uint32_t>(std::clamp(std::ceil(extent / meanExtent), 1.0, double(maximumResolution))) : (extent > 0.0 ? maximumResolution : 1);
+
+        numberOfCells *= grid._resolution[axis];
+    }
+
+    while (numberOfCells > std::max<std::size_t>(numRows, 1)) {
+        auto& resolution = *std::max_element(grid._resolution.begin(), grid._resolution.end());
+
+        numberOfCells   = numberOfCells / resolution * ((resolution + 1) / 2);
+        resolution      = (resolution + 1) / 2;
+    }
+
+    for (std::size_t axis = 0; axis < 3; axis++) {
+        const auto extent = numRows > 0 ? studyBounds.maximum[axis] - studyBounds.minimum[axis] : 0.0f;
+
+        grid._cellSize[axis] = extent > 0.0f ? extent / grid._resolution[axis] : 1.0f;
+    }
+
+    // Rows are listed per cell in two passes, counting and filling, which keeps them in ascending order.
+    grid._cellOffsets.assign(numberOfCells + 1, 0);
+
+    for (const auto& lineBounds : grid._lineBounds)
+        grid.forEachCell(lineBounds, [&grid](std::size_t cell) { grid._cellOffsets[cell + 1]++; });
+
+    for (std::size_t cell = 0; cell < numberOfCells; cell++) {
+        if (static_cast<std::uint64_t>(grid._cellOffsets[cell]) + grid._cellOffsets[cell + 1] > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error("The pathlines span too many grid cells to be indexed");
+
+        grid._cellOffsets[cell + 1] += grid._cellOffsets[cell];
+    }
+
+    grid._cellLines.resize(grid._cellOffsets.back());
+
+    std::vector<std::uint32_t> cellEnds(grid._cellOffsets.begin(), grid._cellOffsets.end() - 1);
+
+    for (std::size_t row = 0; row < numRows; row++)
+        grid.forEachCell(grid._lineBounds[row], [&grid, &cellEnds, row](std::size_t cell) { grid._cellLines[cellEnds[cell]++] = static_cast<std::uint32_t>(row); });
+
+    return grid;
+}
+
+void PathlineGrid::extend(const float* data, std::size_t numDimensions, std::size_t lineSize, std::size_t firstPoint)
+{
+    const auto numRows      = _seeds.size();
+    const auto numColumns   = lineSize > 0 ? numDimensions / lineSize : 0;
+
+    if (firstPoint >= lineSize || numRows == 0)
+        return;
+
+    // Rows are extended in blocks, in parallel; every block lists the cells its rows grew into, as (cell, row) pairs.
+    const std::size_t blockSize = 4096;
+    const auto numberOfBlocks = (numRows + blockSize - 1) / blockSize;
+
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> blockEntries(numberOfBlocks);
+
+    ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+        auto& entries = blockEntries[blockIndex];
+
+        const auto firstRow = blockIndex * blockSize;
+        const auto endRow   = std::min(firstRow + blockSize, numRows);
+
+        for (auto row = firstRow; row < endRow; row++) {
+            const auto previousBounds = _lineBounds[row];
+
+            auto& lineBounds = _lineBounds[row];
+
+            for (auto pointIndex = firstPoint; pointIndex < lineSize; pointIndex++) {
+                const auto* point = data + row * numDimensions + pointIndex * numColumns;
+
+                for (std::size_t axis = 0; axis < 3; axis++) {
+                    lineBounds[axis]        = std::min(lineBounds[axis], point[axis]);
+                    lineBounds[axis + 3]    = std::max(lineBounds[axis + 3], point[axis]);
+                }
+            }
+
+            if (lineBounds == previousBounds)
+                continue;
+
+            // The cells of the previous box already list the row.
+            const std::array<std::uint32_t, 3> first    = { cellCoordinate(previousBounds[0], 0), cellCoordinate(previousBounds[1], 1), cellCoordinate(previousBounds[2], 2) };
+            const std::array<std::uint32_t, 3> last     = { cellCoordinate(previousBounds[3], 0), cellCoordinate(previousBounds[4], 1), cellCoordinate(previousBounds[5], 2) };
+
+            forEachCell(lineBounds, [&](std::size_t cell) {
+                const auto x = cell % _resolution[0];
+                const auto y = cell / _resolution[0] % _resolution[1];
+                const auto z = cell / _resolution[0] / _resolution[1];
+
+                if (x < first[0] || x > last[0] || y < first[1] || y > last[1] || z < first[2] || z > last[2])
+                    entries.emplace_back(static_cast<std::uint32_t>(cell), static_cast<std::uint32_t>(row));
+            });
+        }
+    });
+
+    const auto numberOfCells = _cellOffsets.size() - 1;
+
+    std::vector<std::uint32_t> addedLines(numberOfCells + 1, 0);
+
+    for (const auto& entries : blockEntries)
+        for (const auto& entry : entries)
+            addedLines[entry.first + 1]++;
+
+    if (std::all_of(addedLines.begin(), addedLines.end(), [](std::uint32_t count) { return count == 0; }))
+        return;
+
+    // The lists of the cells are merged with the added rows, which come in ascending order as the blocks do.
+    std::vector<std::uint32_t> cellOffsets(numberOfCells + 1, 0);
+
+    for (std::size_t cell = 0; cell < numberOfCells; cell++) {
+        const auto numberOfLines = static_cast<std::uint64_t>(_cellOffsets[cell + 1] - _cellOffsets[cell]) + addedLines[cell + 1];
+
+        if (cellOffsets[cell] + numberOfLines > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error("The pathlines span too many grid cells to be indexed");
+
+        cellOffsets[cell + 1] = static_cast<std::uint32_t>(cellOffsets[cell] + numberOfLines);
+    }
+
+    std::partial_sum(addedLines.begin(), addedLines.end(), addedLines.begin());
+
+    std::vector<std::uint32_t> added(addedLines.back());
+    std::vector<std::uint32_t> addedEnds(addedLines.begin(), addedLines.end() - 1);
+
+    for (const auto& entries : blockEntries)
+        for (const auto& entry : entries)
+            added[addedEnds[entry.first]++] = entry.second;
+
+    std::vector<std::uint32_t> cellLines(cellOffsets.back());
+
+    ThreadPool::global().parallelFor(numberOfCells, [&](std::size_t cell) {
+        std::merge(_cellLines.begin() + _cellOffsets[cell], _cellLines.begin() + _cellOffsets[cell + 1], added.begin() + addedLines[cell], added.begin() + addedLines[cell + 1], cellLines.begin() + cellOffsets[cell]);
+    });
+
+    _cellOffsets    = std::move(cellOffsets);
+    _cellLines      = std::move(cellLines);
+}
+
+std::uint32_t PathlineGrid::cellCoordinate(float value, std::size_t axis) const
+{
+    const auto cell = std::floor((value - _origin[axis]) / _cellSize[axis]);
+
+    if (!(cell > 0.0f))
+        return 0;
+
+    return static_cast<std::uint32_t>(std::min(cell, static_cast<float>(_resolution[axis] - 1)));
+}
+
+template <typename Function>
+void PathlineGrid::forEachCandidate(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum, Function&& function) const
+{
+    if (empty())
+        return;
+
+    for (std::size_t axis = 0; axis < 3; axis++)
+        if (maximum[axis] < minimum[axis])
+            return;
+
+    const std::array<std::uint32_t, 3> first    = { cellCoordinate(minimum[0], 0), cellCoordinate(minimum[1], 1), cellCoordinate(minimum[2], 2) };
+    const std::array<std::uint32_t, 3> last     = { cellCoordinate(maximum[0], 0), cellCoordinate(maximum[1], 1), cellCoordinate(maximum[2], 2) };
+
+    for (auto z = first[2]; z <= last[2]; z++) {
+        for (auto y = first[1]; y <= last[1]; y++) {
+            for (auto x = first[0]; x <= last[0]; x++) {
+                const auto cell = x + _resolution[0] * (y + static_cast<std::size_t>(_resolution[1]) * z);
+
+                for (auto entry = _cellOffsets[cell]; entry < _cellOffsets[cell + 1]; entry++)
+                    function(_cellLines[entry], std::array<std::uint32_t, 3>({ x, y, z }));
+            }
+        }
+    }
+}
+
+std::vector<std::uint32_t> PathlineGrid::linesInBox(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum) const
+{
+    std::vector<std::uint32_t> lines;
+
+    forEachCandidate(minimum, maximum, [this, &minimum, &maximum, &lines](std::uint32_t row, const std::array<std::uint32_t, 3>& cell) {
+        const auto& bounds = _lineBounds[row];
+
+        for (std::size_t axis = 0; axis < 3; axis++)
+            if (bounds[axis] > maximum[axis] || bounds[axis + 3] < minimum[axis])
+                return;
+
+        // A row is listed in every cell of its box, it is reported from the cell of the lower corner of the overlap.
+        for (std::size_t axis = 0; axis < 3; axis++)
+            if (cellCoordinate(std::max(bounds[axis], minimum[axis]), axis) != cell[axis])
+                return;
+
+        lines.push_back(row);
+    });
+
+    return lines;
+}
+
+std::vector<std::uint32_t> PathlineGrid::seedsInBox(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum) const
+{
+    std::vector<std::uint32_t> lines;
+
+    forEachCandidate(minimum, maximum, [this, &minimum, &maximum, &lines](std::uint32_t row, const std::array<std::uint32_t, 3>& cell) {
+        const auto& seed = _seeds[row];
+
+        for (std::size_t axis = 0; axis < 3; axis++)
+            if (seed[axis] < minimum[axis] || seed[axis] > maximum[axis] || cellCoordinate(seed[axis], axis) != cell[axis])
+                return;
+
+        lines.push_back(row);
+    });
+
+    return lines;
+}
+
+std::vector<char> PathlineGrid::serialize() const
+{
+    GridHeader header = {};
+
+    std::memcpy(header.magic, gridMagic, sizeof(gridMagic));
+
+    header.version          = gridVersion;
+    header.numberOfLines    = _seeds.size();
+    header.numberOfEntries  = _cellLines.size();
+
+    for (std::size_t axis = 0; axis < 3; axis++) {
+        header.origin[axis]     = _origin[axis];
+        header.cellSize[axis]   = _cellSize[axis];
+        header.resolution[axis] = _resolution[axis];
+    }
+
+    const auto boundsSize   = _lineBounds.size() * sizeof(_lineBounds.front());
+    const auto seedsSize    = _seeds.size() * sizeof(_seeds.front());
+    const auto offsetsSize  = _cellOffsets.size() * sizeof(std::uint32_t);
+    const auto linesSize    = _cellLines.size() * sizeof(std::uint32_t);
+
+    std::vector<char> bytes(sizeof(header) + boundsSize + seedsSize + offsetsSize + linesSize);
+
+    auto* destination = bytes.data();
+
+    std::memcpy(destination, &header, sizeof(header));
+    destination += sizeof(header);
+
+    if (boundsSize > 0)
+        std::memcpy(destination, _lineBounds.data(), boundsSize);
+
+    destination += boundsSize;
+
+    if (seedsSize > 0)
+        std::memcpy(destination, _seeds.data(), seedsSize);
+
+    destination += seedsSize;
+
+    std::memcpy(destination, _cellOffsets.data(), offsetsSize);
+    destination += offsetsSize;
+
+    if (linesSize > 0)
+        std::memcpy(destination, _cellLines.data(), linesSize);
+
+    return bytes;
+}
+
+bool PathlineGrid::deserialize(const char* bytes, std::size_t numberOfBytes, PathlineGrid& grid)
+{
+    GridHeader header;
+
+    if (numberOfBytes < sizeof(header))
+        return false;
+
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (std::memcmp(header.magic, gridMagic, sizeof(gridMagic)) != 0 || header.version != gridVersion)
+        return false;
+
+    std::size_t numberOfCells = 1;
+
+    for (std::size_t axis = 0; axis < 3; axis++) {
+        if (header.resolution[axis] == 0 || header.resolution[axis] > maximumResolution || !(header.cellSize[axis] > 0.0f))
+            return false;
+
+        numberOfCells *= header.resolution[axis];
+    }
+
+    const auto boundsSize   = header.numberOfLines * sizeof(std::array<float, 6>);
+    const auto seedsSize    = header.numberOfLines * sizeof(std::array<float, 3>);
+    const auto offsetsSize  = (numberOfCells + 1) * sizeof(std::uint32_t);
+    const auto linesSize    = header.numberOfEntries * sizeof(std::uint32_t);
+
+    if (header.numberOfLines > numberOfBytes || header.numberOfEntries > numberOfBytes || numberOfBytes != sizeof(header) + boundsSize + seedsSize + offsetsSize + linesSize)
+        return false;
+
+    PathlineGrid readGrid;
+
+    for (std::size_t axis = 0; axis < 3; axis++) {
+        readGrid._origin[axis]      = header.origin[axis];
+        readGrid._cellSize[axis]    = header.cellSize[axis];
+        readGrid._resolution[axis]  = header.resolution[axis];
+    }
+
+    readGrid._lineBounds.resize(header.numberOfLines);
+    readGrid._seeds.resize(header.numberOfLines);
+    readGrid._cellOffsets.resize(numberOfCells + 1);
+    readGrid._cellLines.resize(header.numberOfEntries);
+
+    const auto* source = bytes + sizeof(header);
+
+    std::memcpy(readGrid._lineBounds.data(), source, boundsSize);
+    source += boundsSize;
+
+    std::memcpy(readGrid._seeds.data(), source, seedsSize);
+    source += seedsSize;
+
+    std::memcpy(readGrid._cellOffsets.data(), source, offsetsSize);
+    source += offsetsSize;
+
+    std::memcpy(readGrid._cellLines.data(), source, linesSize);
+
+    // Offsets and rows index the arrays, so they are checked before the grid is used.
+    if (readGrid._cellOffsets.front() != 0 || readGrid._cellOffsets.back() != header.numberOfEntries || !std::is_sorted(readGrid._cellOffsets.begin(), readGrid._cellOffsets.end()))
+        return false;
+
+    for (const auto row : readGrid._cellLines)
+        if (row >= header.numberOfLines)
+            return false;
+
+    grid = std::move(readGrid);
+
+    return true;
+}
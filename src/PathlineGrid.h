@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// =============================================================================
+// Pathline grid
+// =============================================================================
+
+/**
+ * Spatial index of the rows of a pathline study, for selecting pathlines by region without scanning the matrix.
+ *
+ * Every row has the bounding box of its point positions and its seed, the position of its first point. A uniform
+ * grid over the bounding boxes lists per cell the rows whose box overlaps the cell, in compressed row form (an
+ * offset per cell into one array of rows). The cell size follows the mean box size, so a row lands in a few cells.
+ * Queries only visit the cells that overlap the region and report every row once, in ascending order per cell.
+ *
+ * The index travels with a dataset as a byte array (see serialize()), all values are stored in native byte order.
+ */
+class PathlineGrid
+{
+public:
+
+    /**
+     * Build the index of pathline rows, in parallel over blocks of rows.
+     * @param data Row major matrix, every row holds lineSize points whose first three columns are the position
+     * @param numRows Number of rows
+     * @param numDimensions Number of values per row, a multiple of lineSize
+     * @param lineSize Number of points per row
+     * @return Index of the rows
+     */
+    static PathlineGrid build(const float* data, std::size_t numRows, std::size_t numDimensions, std::size_t lineSize);
+
+    /**
+     * Extend the index by points appended to its rows, without visiting the points it already covers. The boxes of
+     * the rows grow by the new points and rows are added to the cells their boxes grew into; the grid itself is kept,
+     * points beyond it are counted to its border cells. In parallel over blocks of rows.
+     * @param data Row major matrix with the rows of the index, every row holds lineSize points whose first three columns are the position
+     * @param numDimensions Number of values per row, a multiple of lineSize
+     * @param lineSize Number of points per row
+     * @param firstPoint First point of every row that is not covered by the index yet
+     */
+    void extend(const float* data, std::size_t numDimensions, std::size_t lineSize, std::size_t firstPoint);
+
+    /**
+     * Rows whose bounding box overlaps a box.
+     * @param minimum Lower corner of the box
+     * @param maximum Upper corner of the box
+     * @return Rows, each once
+     */
+    std::vector<std::uint32_t> linesInBox(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum) const;
+
+    /**
+     * Rows whose seed lies inside a box.
+     * @param minimum Lower corner of the box
+     * @param maximum Upper corner of the box
+     * @return Rows, each once
+     */
+    std::vector<std::uint32_t> seedsInBox(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum) const;
+
+    /** Returns the index as bytes: a header followed by the bounds, seeds, cell offsets and cell rows */
+    std::vector<char> serialize() const;
+
+    /**
+     * Read an index written by serialize().
+     * @param bytes First byte
+     * @param numberOfBytes Number of bytes
+     * @param grid Receives the index
+     * @return False if the bytes do not hold a valid index
+     */
+    static bool deserialize(const char* bytes, std::size_t numberOfBytes, PathlineGrid& grid);
+
+    bool empty() const { return _seeds.empty(); }
+    std::size_t numberOfLines() const { return _seeds.size(); }
+
+    const std::array<float, 3>& origin() const { return _origin; }
+    const std::array<float, 3>& cellSize() const { return _cellSize; }
+    const std::array<std::uint32_t, 3>& resolution() const { return _resolution; }
+
+    /** Lower and upper corner of the bounding box of every row */
+    const std::vector<std::array<float, 6>>& lineBounds() const { return _lineBounds; }
+
+    /** Position of the first point of every row */
+    const std::vector<std::array<float, 3>>& seeds() const { return _seeds; }
+
+private:
+    /** Returns the cell of a coordinate along an axis, clamped to the grid */
+    std::uint32_t cellCoordinate(float value, std::size_t axis) const;
+
+    /** Call a function with the index of every cell that overlaps a box */
+    template <typename Function>
+    void forEachCell(const std::array<float, 6>& bounds, Function&& function) const;
+
+    /**
+     * Call a function for every row listed in the cells that overlap a box.
+     * @param minimum Lower corner of the box
+     * @param maximum Upper corner of the box
+     * @param function Called with the row and the cell coordinates
+     */
+    template <typename Function>
+    void forEachCandidate(const std::array<float, 3>& minimum, const std::array<float, 3>& maximum, Function&& function) const;
+
+private:
+    std::array<float, 3>                _origin = { 0.0f, 0.0f, 0.0f };
+    std::array<float, 3>                _cellSize = { 1.0f, 1.0f, 1.0f };
+    std::array<std::uint32_t, 3>        _resolution = { 0, 0, 0 };
+    std::vector<std::array<float, 6>>   _lineBounds;    /** Lower and upper corner of every row */
+    std::vector<std::array<float, 3>>   _seeds;         /** First point of every row */
+    std::vector<std::uint32_t>          _cellOffsets;   /** Index of the first row of every cell in _cellLines, one more than there are cells */
+    std::vector<std::uint32_t>          _cellLines;     /** Rows per cell, in ascending order */
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// =============================================================================
+// Pathline index
+// =============================================================================
+
+/**
+ * Flat hash index from pathline ID to row.
+ * Open addressing with linear probing over a single power of two sized array, so a lookup touches one or two
+ * cache lines and building the index allocates once. The capacity is sized up front from the number of lines.
+ */
+class PathlineIndex
+{
+public:
+
+    /** Returned by find() for unknown IDs */
+    static constexpr std::size_t notFound = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * Empty the index and size it for a number of lines.
+     * @param numberOfLines Number of IDs that will be inserted
+     */
+    void reset(std::size_t numberOfLines)
+    {
+        std::size_t capacity = 16;
+
+        // Keep the load factor at or below one half.
+        while (capacity < 2 * numberOfLines)
+            capacity *= 2;
+
+        _slots.assign(capacity, Slot());
+        _mask = capacity - 1;
+        _size = 0;
+    }
+
+    /**
+     * Add an ID.
+     * @param id Pathline ID
+     * @param row Row of the pathline
+     * @return False if the ID was already in the index, which is left unchanged
+     */
+    bool insert(int id, std::size_t row)
+    {
+        for (auto slotIndex = hash(id) & _mask; ; slotIndex = (slotIndex + 1) & _mask) {
+            auto& slot = _slots[slotIndex];
+
+            if (slot.row == emptyRow) {
+                slot.id     = id;
+                slot.row    = static_cast<std::uint32_t>(row);
+
+                _size++;
+                return true;
+            }
+
+            if (slot.id == id)
+                return false;
+        }
+    }
+
+    /** Returns the row of an ID, or notFound */
+    std::size_t find(int id) const
+    {
+        for (auto slotIndex = hash(id) & _mask; ; slotIndex = (slotIndex + 1) & _mask) {
+            const auto& slot = _slots[slotIndex];
+
+            if (slot.row == emptyRow)
+                return notFound;
+
+            if (slot.id == id)
+                return slot.row;
+        }
+    }
+
+    /** Number of IDs in the index */
+    std::size_t size() const { return _size; }
+
+private:
+
+    /** Fibonacci hashing spreads consecutive IDs, the common case, over the whole table */
+    static std::size_t hash(int id)
+    {
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    static constexpr std::uint32_t emptyRow = std::numeric_limits<std::uint32_t>::max();
+
+    struct Slot
+    {
+        int             id = 0;
+        std::uint32_t   row = emptyRow;
+    };
+
+    std::vector<Slot>   _slots;
+    std::size_t         _mask = 0;
+    std::size_t         _size = 0;
+};
@@ -0,0 +1,180 @@
+#include "PathlineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define VTKLOADER_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define VTKLOADER_NEON
+#endif
+
+void gatherColumns(const float* points, std::size_t numColumns, std::size_t firstColumn, std::size_t count, float* x, float* y, float* z)
+{
+    const auto* point = points + firstColumn;
+
+    for (std::size_t index = 0; index < count; index++, point += numColumns) {
+        x[index] = point[0];
+        y[index] = point[1];
+        z[index] = point[2];
+    }
+}
+
+void scatterColumns(const float* x, const float* y, const float* z, std::size_t count, std::size_t numColumns, std::size_t firstColumn, float* points)
+{
+    auto* point = points + firstColumn;
+
+    for (std::size_t index = 0; index < count; index++, point += numColumns) {
+        point[0] = x[index];
+        point[1] = y[index];
+        point[2] = z[index];
+    }
+}
+
+void scatterColumn(const float* values, std::size_t count, std::size_t numColumns, std::size_t column, float* points)
+{
+    for (std::size_t index = 0; index < count; index++)
+        points[index * numColumns + column] = values[index];
+}
+
+void computeForwardDifferences(const float* values, std::size_t count, float* differences)
+{
+    if (count == 0)
+        return;
+
+    std::size_t index = 0;
+
+    // Each step reads one value past the block, so the vectorized loops stop before the last value.
+#if defined(__AVX2__)
+    for (; index + 8 < count; index += 8)
+        _mm256_storeu_ps(differences + index, _mm256_sub_ps(_mm256_loadu_ps(values + index + 1), _mm256_loadu_ps(values + index)));
+#elif defined(VTKLOADER_SSE2)
+    for (; index + 4 < count; index += 4)
+        _mm_storeu_ps(differences + index, _mm_sub_ps(_mm_loadu_ps(values + index + 1), _mm_loadu_ps(values + index)));
+#elif defined(VTKLOADER_NEON)
+    for (; index + 4 < count; index += 4)
+        vst1q_f32(differences + index, vsubq_f32(vld1q_f32(values + index + 1), vld1q_f32(values + index)));
+#endif
+
+    for (; index + 1 < count; index++)
+        differences[index] = values[index + 1] - values[index];
+
+    differences[count - 1] = count > 1 ? differences[count - 2] : 0.0f;
+}
+
+void computeMagnitudes(const float* x, const float* y, const float* z, std::size_t count, float* magnitudes)
+{
+    std::size_t index = 0;
+
+#if defined(__AVX2__)
+    for (; index + 8 <= count; index += 8) {
+        const auto vx = _mm256_loadu_ps(x + index);
+        const auto vy = _mm256_loadu_ps(y + index);
+        const auto vz = _mm256_loadu_ps(z + index);
+
+        const auto squared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+
+        _mm256_storeu_ps(magnitudes + index, _mm256_sqrt_ps(squared));
+    }
+#elif defined(VTKLOADER_SSE2)
+    for (; index + 4 <= count; index += 4) {
+        const auto vx = _mm_loadu_ps(x + index);
+        const auto vy = _mm_loadu_ps(y + index);
+        const auto vz = _mm_loadu_ps(z + index);
+
+        const auto squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+
+        _mm_storeu_ps(magnitudes + index, _mm_sqrt_ps(squared));
+    }
+#elif defined(VTKLOADER_NEON) && defined(__aarch64__)
+    for (; index + 4 <= count; index += 4) {
+        const auto vx = vld1q_f32(x + index);
+        const auto vy = vld1q_f32(y + index);
+        const auto vz = vld1q_f32(z + index);
+
+        const auto squared = vaddq_f32(vaddq_f32(vmulq_f32(vx, vx), vmulq_f32(vy, vy)), vmulq_f32(vz, vz));
+
+        vst1q_f32(magnitudes + index, vsqrtq_f32(squared));
+    }
+#endif
+
+    // Separate products and sums, so the tail rounds like the vectorized loops.
+    for (; index < count; index++) {
+        const float xx = x[index] * x[index];
+        const float yy = y[index] * y[index];
+        const float zz = z[index] * z[index];
+
+        magnitudes[index] = std::sqrt((xx + yy) + zz);
+    }
+}
+
+void repeatPoint(float* points, std::size_t numColumns, std::size_t source, std::size_t begin, std::size_t end)
+{
+    if (begin >= end)
+        return;
+
+    std::memcpy(points + begin * numColumns, points + source * numColumns, numColumns * sizeof(float));
+
+    // Double the filled part of the range with every copy.
+    for (auto filled = begin + 1; filled < end; ) {
+        const auto numberOfPoints = std::min(filled - begin, end - filled);
+
+        std::memcpy(points + filled * numColumns, points + begin * numColumns, numberOfPoints * numColumns * sizeof(float));
+
+        filled += numberOfPoints;
+    }
+}
+
+void resampleByArcLength(const float* points, std::size_t numColumns, std::size_t count, std::size_t numberOfSamples, double* arcLengths, float* samples)
+{
+    arcLengths[0] = 0.0;
+
+    for (std::size_t index = 1; index < count; index++) {
+        const auto* previous = points + (index - 1) * numColumns;
+        const auto* point = points + index * numColumns;
+
+        const double dx = point[0] - previous[0];
+        const double dy = point[1] - previous[1];
+        const double dz = point[2] - previous[2];
+
+        arcLengths[index] = arcLengths[index - 1] + std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+
+    const auto length = arcLengths[count - 1];
+
+    // The samples advance monotonically, so the segment holding each one is found by walking along the line.
+    std::size_t segment = 0;
+
+    for (std::size_t sample = 0; sample < numberOfSamples; sample++) {
+        auto* destination = samples + sample * numColumns;
+
+        if (length <= 0.0 || count == 1) {
+            std::memcpy(destination, points, numColumns * sizeof(float));
+            continue;
+        }
+
+        if (sample + 1 == numberOfSamples) {
+            std::memcpy(destination, points + (count - 1) * numColumns, numColumns * sizeof(float));
+            continue;
+        }
+
+        const auto target = length * sample / (numberOfSamples - 1);
+
+        while (segment + 2 < count && arcLengths[segment + 1] <= target)
+            segment++;
+
+        const auto segmentLength = arcLengths[segment + 1] - arcLengths[segment];
+        const auto fraction = segmentLength > 0.0 ? static_cast<float>((target - arcLengths[segment]) / segmentLength) : 0.0f;
+
+        const auto* from = points + segment * numColumns;
+        const auto* to = from + numColumns;
+
+        for (std::size_t column = 0; column < numColumns; column++)
+            destination[column] = from[column] + fraction * (to[column] - from[column]);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+
+// =============================================================================
+// Pathline kernels
+// =============================================================================
+
+/**
+ * Bulk kernels of the derivation stage. Pathline rows store their points interleaved (one run of columns per
+ * point), the kernels work on a structure of arrays view of one column per array, into which the columns are
+ * gathered first. The arithmetic kernels use AVX2, SSE2 or NEON depending on the target (see VTKLOADER_USE_AVX2)
+ * and a scalar loop elsewhere, with results identical to the scalar loop.
+ */
+
+/**
+ * Copy three consecutive columns of interleaved points to contiguous arrays, in a single pass over the points.
+ * @param points First value of the first point
+ * @param numColumns Number of values per point
+ * @param firstColumn First of the columns to copy
+ * @param count Number of points
+ * @param x, y, z Receive count values of the first, second and third column
+ */
+void gatherColumns(const float* points, std::size_t numColumns, std::size_t firstColumn, std::size_t count, float* x, float* y, float* z);
+
+/**
+ * Copy three contiguous arrays into consecutive columns of interleaved points, in a single pass over the points.
+ * @param x, y, z Count values of the first, second and third column
+ * @param count Number of points
+ * @param numColumns Number of values per point
+ * @param firstColumn First of the columns to write
+ * @param points First value of the first point
+ */
+void scatterColumns(const float* x, const float* y, const float* z, std::size_t count, std::size_t numColumns, std::size_t firstColumn, float* points);
+
+/**
+ * Copy a contiguous array into one column of interleaved points.
+ * @param values Count values
+ * @param count Number of points
+ * @param numColumns Number of values per point
+ * @param column Column to write
+ * @param points First value of the first point
+ */
+void scatterColumn(const float* values, std::size_t count, std::size_t numColumns, std::size_t column, float* points);
+
+/**
+ * Forward differences of a series, the last value reuses the difference towards it (zero for a single value).
+ * @param values Count values
+ * @param count Number of values
+ * @param differences Receives count differences, may not overlap with values
+ */
+void computeForwardDifferences(const float* values, std::size_t count, float* differences);
+
+/**
+ * Euclidean length of vectors given by their components.
+ * @param x, y, z Count components each
+ * @param count Number of vectors
+ * @param magnitudes Receives count lengths
+ */
+void computeMagnitudes(const float* x, const float* y, const float* z, std::size_t count, float* magnitudes);
+
+/**
+ * Fill a range of interleaved points with copies of one point.
+ * @param points First value of the first point
+ * @param numColumns Number of values per point
+ * @param source Index of the point to copy, outside of the range
+ * @param begin First point of the range
+ * @param end End of the range
+ */
+void repeatPoint(float* points, std::size_t numColumns, std::size_t source, std::size_t begin, std::size_t end);
+
+/**
+ * Resample a polyline of interleaved points to points evenly spaced by the length along its positions, interpolating
+ * every column linearly between the two points around each sample. Columns that are constant along the line stay
+ * exact. A line without length repeats its first point.
+ * @param points First value of the first point, the first three columns hold the position
+ * @param numColumns Number of values per point
+ * @param count Number of points, at least one
+ * @param numberOfSamples Number of points to produce, at least one; the first and last equal those of the line
+ * @param arcLengths Receives count cumulative lengths, scratch space
+ * @param samples Receives numberOfSamples interleaved points, may not overlap with points
+ */
+void resampleByArcLength(const float* points, std::size_t numColumns, std::size_t count, std::size_t numberOfSamples, double* arcLengths, float* samples);
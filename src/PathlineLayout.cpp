@@ -0,0 +1,147 @@
+#include "PathlineLayout.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+const std::array<const char*, 7> compactColumnNames = { "x", "y", "z", "speed", "x'", "y'", "z'" };
+
+namespace
+{
+    /** Columns of a point as loaded by VTKStudyLoader */
+    const std::array<const char*, 10> fullColumnNames = { "x", "y", "z", "speed", "index", "time", "group", "x'", "y'", "z'" };
+
+    /** Position of the index, time, group and difference vector columns of a loaded point */
+    const std::size_t indexColumn       = 4;
+    const std::size_t timeColumn        = 5;
+    const std::size_t groupColumn       = 6;
+    const std::size_t differenceColumn  = 7;
+
+    std::vector<std::string> dimensionNames(std::size_t lineSize, const char* const* columnNames, std::size_t numColumns)
+    {
+        std::vector<std::string> names;
+        names.reserve(lineSize * numColumns);
+
+        for (std::size_t pointIndex = 0; pointIndex < lineSize; pointIndex++)
+            for (std::size_t column = 0; column < numColumns; column++)
+                names.push_back(columnNames[column] + std::to_string(pointIndex));
+
+        return names;
+    }
+}
+
+PathlineMetadata readPathlineMetadata(const LoadedStudy& study)
+{
+    const auto lineSize = study.lineSize;
+
+    if (!study.isPathlines || study.numDimensions != lineSize * fullColumnNames.size())
+        throw std::runtime_error("Only pathline studies in the loaded layout can be compacted");
+
+    PathlineMetadata metadata;
+
+    metadata.lineIndices.resize(study.numPoints);
+    metadata.groups.resize(study.numPoints);
+    metadata.firstTimepoints.resize(study.numPoints);
+    metadata.lastTimepoints.resize(study.numPoints);
+    metadata.pointTimepoints.resize(lineSize);
+
+    for (std::size_t pointIndex = 0; pointIndex < lineSize && study.numPoints > 0; pointIndex++)
+        metadata.pointTimepoints[pointIndex] = study.data[pointIndex * fullColumnNames.size() + timeColumn];
+
+    for (std::size_t row = 0; row < study.numPoints; row++) {
+        const auto* source = study.data.data() + row * study.numDimensions;
+
+        metadata.lineIndices[row]       = source[indexColumn];
+        metadata.groups[row]            = static_cast<int>(source[groupColumn]);
+        metadata.firstTimepoints[row]   = source[timeColumn];
+        metadata.lastTimepoints[row]    = source[(lineSize - 1) * fullColumnNames.size() + timeColumn];
+    }
+
+    return metadata;
+}
+
+void copyCompactPoints(const LoadedStudy& study, std::size_t firstPoint, float* destination)
+{
+    const auto lineSize = study.lineSize;
+
+    if (!study.isPathlines || study.numDimensions != lineSize * fullColumnNames.size())
+        throw std::runtime_error("Only pathline studies in the loaded layout can be compacted");
+
+    for (std::size_t row = 0; row < study.numPoints; row++) {
+        const auto* source = study.data.data() + row * study.numDimensions;
+
+        for (auto pointIndex = firstPoint; pointIndex < lineSize; pointIndex++) {
+            const auto* point = source + pointIndex * fullColumnNames.size();
+
+            std::memcpy(destination, point, indexColumn * sizeof(float));
+            std::memcpy(destination + indexColumn, point + differenceColumn, 3 * sizeof(float));
+
+            destination += compactColumnNames.size();
+        }
+    }
+}
+
+std::vector<std::string> compactDimensionNames(std::size_t lineSize)
+{
+    return dimensionNames(lineSize, compactColumnNames.data(), compactColumnNames.size());
+}
+
+std::vector<std::string> loadedDimensionNames(std::size_t lineSize)
+{
+    return dimensionNames(lineSize, fullColumnNames.data(), fullColumnNames.size());
+}
+
+void keepLastPoints(LoadedStudy& study, std::size_t numberOfPoints)
+{
+    const auto lineSize = study.lineSize;
+
+    if (!study.isPathlines || study.numDimensions != lineSize * fullColumnNames.size())
+        throw std::runtime_error("Only pathline studies in the loaded layout can be cut");
+
+    if (numberOfPoints >= lineSize)
+        return;
+
+    const auto numDimensions = numberOfPoints * fullColumnNames.size();
+
+    // Every row moves towards the front of the matrix, so moving the rows front to back never overwrites a row that
+    // has yet to move.
+    for (std::size_t row = 0; row < study.numPoints; row++)
+        std::memmove(study.data.data() + row * numDimensions, study.data.data() + row * study.numDimensions + (lineSize - numberOfPoints) * fullColumnNames.size(), numDimensions * sizeof(float));
+
+    study.lineSize      = numberOfPoints;
+    study.numDimensions = numDimensions;
+    study.data.resize(study.numPoints * numDimensions);
+    study.data.shrink_to_fit();
+    study.dimensionNames = loadedDimensionNames(numberOfPoints);
+}
+
+PathlineMetadata compactPathlines(LoadedStudy& study)
+{
+    const auto lineSize = study.lineSize;
+
+    auto metadata = readPathlineMetadata(study);
+
+    const auto numDimensions = lineSize * compactColumnNames.size();
+
+    // Every point moves towards the front of the matrix, so moving the points front to back never overwrites a
+    // point that has yet to move.
+    for (std::size_t row = 0; row < study.numPoints; row++) {
+        const auto* source = study.data.data() + row * study.numDimensions;
+        auto* destination = study.data.data() + row * numDimensions;
+
+        for (std::size_t pointIndex = 0; pointIndex < lineSize; pointIndex++) {
+            const auto* point = source + pointIndex * fullColumnNames.size();
+            auto* compactPoint = destination + pointIndex * compactColumnNames.size();
+
+            std::memmove(compactPoint, point, indexColumn * sizeof(float));
+            std::memmove(compactPoint + indexColumn, point + differenceColumn, 3 * sizeof(float));
+        }
+    }
+
+    study.numDimensions = numDimensions;
+    study.data.resize(study.numPoints * numDimensions);
+    study.data.shrink_to_fit();
+    study.dimensionNames = compactDimensionNames(lineSize);
+
+    return metadata;
+}
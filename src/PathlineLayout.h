@@ -0,0 +1,67 @@
+#pragma once
+
+#include "VTKStudyLoader.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Compact pathline layout
+// =============================================================================
+
+/**
+ * Values of a pathline study that are constant along its pathlines, moved out of the rows by compactPathlines().
+ * The index and group columns hold the same value at every point of a row, and the time column follows the same
+ * sequence in every row, so the compact layout keeps them once per row and once per study.
+ */
+struct PathlineMetadata
+{
+    std::vector<float>  lineIndices;        /** Line index of every row */
+    std::vector<int>    groups;             /** Group of every row */
+    std::vector<float>  firstTimepoints;    /** Timepoint of the first point of every row */
+    std::vector<float>  lastTimepoints;     /** Timepoint of the last point of every row */
+    std::vector<float>  pointTimepoints;    /** Timepoint of every point position of the rows, as in the first row */
+};
+
+/** Columns of a point in the compact layout: position, speed and difference vector */
+extern const std::array<const char*, 7> compactColumnNames;
+
+/**
+ * Read the index, time and group columns of a pathline study per row, leaving the study as it is.
+ * @param study Pathline study in the layout of VTKStudyLoader
+ * @return Per row and per point position values of the index, time and group columns
+ */
+PathlineMetadata readPathlineMetadata(const LoadedStudy& study);
+
+/**
+ * Copy points of every row of a pathline study in the compact layout, leaving the study as it is.
+ * @param study Pathline study in the layout of VTKStudyLoader
+ * @param firstPoint First point of every row to copy, the points from there to the end of the row are copied
+ * @param destination Receives a row of (lineSize - firstPoint) compact points for every row of the study
+ */
+void copyCompactPoints(const LoadedStudy& study, std::size_t firstPoint, float* destination);
+
+/** Returns the dimension names of pathline rows of lineSize points in the compact layout */
+std::vector<std::string> compactDimensionNames(std::size_t lineSize);
+
+/** Returns the dimension names of pathline rows of lineSize points in the layout of VTKStudyLoader */
+std::vector<std::string> loadedDimensionNames(std::size_t lineSize);
+
+/**
+ * Drop all but the last points of every pathline of a study, in place. The spatial index is kept as it is, so it
+ * still covers the dropped points. VTKStudyLoader::append() continues a study from the last point of its pathlines.
+ * @param study Pathline study in the layout of VTKStudyLoader, of at most numberOfPoints points per pathline on return
+ * @param numberOfPoints Number of points to keep at the end of every pathline
+ */
+void keepLastPoints(LoadedStudy& study, std::size_t numberOfPoints);
+
+/**
+ * Drop the index, time and group columns from the rows of a pathline study, in place, and return them per row.
+ * The rows shrink from 10 to 7 values per point. Points that repeat the point before a gap in a pathline lose the
+ * timepoint they repeated, the compact layout gives every point the timepoint of its position.
+ * @param study Pathline study in the layout of VTKStudyLoader, compacted on return
+ * @return Per row and per point position values of the dropped columns
+ */
+PathlineMetadata compactPathlines(LoadedStudy& study);
@@ -0,0 +1,149 @@
+#include "ReducedPrecision.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+    /** Number of values or rows converted per task */
+    const std::size_t blockSize = 1 << 16;
+
+    /** Largest magnitude of a scaled value, symmetric so zero maps to the middle of the range */
+    const float int16Limit = 32767.0f;
+
+    std::size_t numberOfBlocks(std::size_t count, std::size_t size)
+    {
+        return (count + size - 1) / size;
+    }
+}
+
+void convertToBFloat16(const float* values, std::size_t count, std::uint16_t* destination)
+{
+    ThreadPool::global().parallelFor(numberOfBlocks(count, blockSize), [values, count, destination](std::size_t block) {
+        const auto end = std::min(count, (block + 1) * blockSize);
+
+        for (auto index = block * blockSize; index < end; index++)
+            destination[index] = toBFloat16(values[index]);
+    });
+}
+
+DimensionRanges computeDimensionRanges(const float* values, std::size_t numPoints, std::size_t numDimensions, std::size_t rowStride)
+{
+    DimensionRanges ranges;
+
+    ranges.minima.assign(numDimensions, std::numeric_limits<float>::max());
+    ranges.maxima.assign(numDimensions, std::numeric_limits<float>::lowest());
+    ranges.integral.assign(numDimensions, 1);
+
+    std::mutex mutex;
+
+    // Rows are scanned in blocks, each of which reduces into its own range before merging.
+    const auto rowsPerBlock = std::max<std::size_t>(1, blockSize / std::max<std::size_t>(numDimensions, 1));
+
+    ThreadPool::global().parallelFor(numberOfBlocks(numPoints, rowsPerBlock), [&](std::size_t block) {
+        std::vector<float> blockMinima(numDimensions, std::numeric_limits<float>::max());
+        std::vector<float> blockMaxima(numDimensions, std::numeric_limits<float>::lowest());
+        std::vector<std::uint8_t> blockIntegral(numDimensions, 1);
+
+        const auto end = std::min(numPoints, (block + 1) * rowsPerBlock);
+
+        for (auto row = block * rowsPerBlock; row < end; row++) {
+            const auto* rowValues = values + row * rowStride;
+
+            for (std::size_t dimension = 0; dimension < numDimensions; dimension++) {
+                const auto value = rowValues[dimension];
+
+                // NaN is stored as the middle of the range.
+                if (value != value)
+                    continue;
+
+                blockMinima[dimension] = std::min(blockMinima[dimension], value);
+                blockMaxima[dimension] = std::max(blockMaxima[dimension], value);
+
+                if (value != std::nearbyint(value))
+                    blockIntegral[dimension] = 0;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (std::size_t dimension = 0; dimension < numDimensions; dimension++) {
+            ranges.minima[dimension] = std::min(ranges.minima[dimension], blockMinima[dimension]);
+            ranges.maxima[dimension] = std::max(ranges.maxima[dimension], blockMaxima[dimension]);
+            ranges.integral[dimension] &= blockIntegral[dimension];
+        }
+    });
+
+    return ranges;
+}
+
+void mergeDimensionRanges(DimensionRanges& ranges, std::size_t firstDimension, const DimensionRanges& more)
+{
+    const auto numDimensions = firstDimension + more.minima.size();
+
+    ranges.minima.resize(std::max(ranges.minima.size(), numDimensions), std::numeric_limits<float>::max());
+    ranges.maxima.resize(std::max(ranges.maxima.size(), numDimensions), std::numeric_limits<float>::lowest());
+    ranges.integral.resize(std::max(ranges.integral.size(), numDimensions), 1);
+
+    for (std::size_t dimension = firstDimension; dimension < numDimensions; dimension++) {
+        ranges.minima[dimension] = std::min(ranges.minima[dimension], more.minima[dimension - firstDimension]);
+        ranges.maxima[dimension] = std::max(ranges.maxima[dimension], more.maxima[dimension - firstDimension]);
+        ranges.integral[dimension] &= more.integral[dimension - firstDimension];
+    }
+}
+
+DimensionScaling computeInt16Scaling(const DimensionRanges& ranges)
+{
+    const auto numDimensions = ranges.minima.size();
+
+    DimensionScaling scaling;
+
+    scaling.scales.resize(numDimensions, 1.0f);
+    scaling.offsets.resize(numDimensions, 0.0f);
+
+    for (std::size_t dimension = 0; dimension < numDimensions; dimension++) {
+        const auto minimum = ranges.minima[dimension];
+        const auto maximum = ranges.maxima[dimension];
+
+        // Dimensions without values, and small integers, are stored as they are.
+        if (minimum > maximum || (ranges.integral[dimension] && minimum >= -int16Limit && maximum <= int16Limit))
+            continue;
+
+        scaling.offsets[dimension] = 0.5f * minimum + 0.5f * maximum;
+
+        if (maximum > minimum)
+            scaling.scales[dimension] = (0.5f * maximum - 0.5f * minimum) / int16Limit;
+    }
+
+    return scaling;
+}
+
+DimensionScaling computeInt16Scaling(const float* values, std::size_t numPoints, std::size_t numDimensions)
+{
+    return computeInt16Scaling(computeDimensionRanges(values, numPoints, numDimensions, numDimensions));
+}
+
+void convertToScaledInt16(const float* values, std::size_t numPoints, std::size_t numDimensions, const DimensionScaling& scaling, std::int16_t* destination)
+{
+    std::vector<float> inverseScales(numDimensions);
+
+    for (std::size_t dimension = 0; dimension < numDimensions; dimension++)
+        inverseScales[dimension] = 1.0f / scaling.scales[dimension];
+
+    const auto rowsPerBlock = std::max<std::size_t>(1, blockSize / std::max<std::size_t>(numDimensions, 1));
+
+    ThreadPool::global().parallelFor(numberOfBlocks(numPoints, rowsPerBlock), [&](std::size_t block) {
+        const auto end = std::min(numPoints, (block + 1) * rowsPerBlock);
+
+        for (auto row = block * rowsPerBlock; row < end; row++) {
+            const auto* rowValues = values + row * numDimensions;
+            auto* rowDestination = destination + row * numDimensions;
+
+            for (std::size_t dimension = 0; dimension < numDimensions; dimension++)
+                rowDestination[dimension] = toScaledInt16(rowValues[dimension], scaling.offsets[dimension], inverseScales[dimension]);
+        }
+    });
+}
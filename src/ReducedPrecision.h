@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// =============================================================================
+// Reduced precision storage
+// =============================================================================
+
+/** Element type in which a loaded study is stored */
+enum class ValuePrecision
+{
+    Float32,        /** Values as loaded */
+    BFloat16,       /** The upper half of every float, rounded to nearest even: eight bits of mantissa, full range */
+    ScaledInt16     /** Per dimension offset and scale mapped onto 16 bit integers */
+};
+
+/**
+ * Mapping of scaled 16 bit integers back to values: value = offsets[dimension] + scales[dimension] * stored.
+ * Dimensions holding only integers from -32767 to 32767, as the time and group columns usually do, are stored
+ * exactly with scale one and offset zero. Other dimensions, e.g. the index column of studies with more pathlines,
+ * are scaled and lose precision.
+ */
+struct DimensionScaling
+{
+    std::vector<float>  scales;
+    std::vector<float>  offsets;
+};
+
+/** Range of the values of every dimension of a matrix, from which its DimensionScaling follows */
+struct DimensionRanges
+{
+    std::vector<float>          minima;
+    std::vector<float>          maxima;
+    std::vector<std::uint8_t>   integral;   /** Nonzero for dimensions holding only integers */
+};
+
+/** Returns the bfloat16 bit pattern of a value, rounded to nearest even; NaN stays NaN */
+inline std::uint16_t toBFloat16(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+        return static_cast<std::uint16_t>((bits >> 16) | 0x0040u);
+
+    bits += 0x7FFFu + ((bits >> 16) & 1u);
+
+    return static_cast<std::uint16_t>(bits >> 16);
+}
+
+/** Returns the value of a bfloat16 bit pattern */
+inline float fromBFloat16(std::uint16_t bits)
+{
+    const std::uint32_t widened = static_cast<std::uint32_t>(bits) << 16;
+
+    float value;
+    std::memcpy(&value, &widened, sizeof(value));
+
+    return value;
+}
+
+/**
+ * Convert values to bfloat16 bit patterns, in parallel on the shared thread pool.
+ * @param values Values to convert
+ * @param count Number of values
+ * @param destination Receives count bit patterns
+ */
+void convertToBFloat16(const float* values, std::size_t count, std::uint16_t* destination);
+
+/** Returns the scaled 16 bit integer of a value, given the offset and the inverse scale of its dimension */
+inline std::int16_t toScaledInt16(float value, float offset, float inverseScale)
+{
+    const auto scaled = (value - offset) * inverseScale;
+
+    // NaN compares false and lands on zero, the middle of the range.
+    return static_cast<std::int16_t>(std::nearbyint(std::clamp(scaled == scaled ? scaled : 0.0f, -32767.0f, 32767.0f)));
+}
+
+/**
+ * Determine the range of every dimension of part of a row major matrix, in parallel on the shared thread pool.
+ * @param values First value of the part
+ * @param numPoints Number of rows of the part
+ * @param numDimensions Number of columns of the part
+ * @param rowStride Number of values from one row of the matrix to the next
+ * @return Range of every column of the part, NaN is left out
+ */
+DimensionRanges computeDimensionRanges(const float* values, std::size_t numPoints, std::size_t numDimensions, std::size_t rowStride);
+
+/**
+ * Widen the ranges of some dimensions to include the ranges of the same dimensions elsewhere in the matrix.
+ * @param ranges Ranges to widen
+ * @param firstDimension Dimension of the first range of more
+ * @param more Ranges of the dimensions from firstDimension on
+ */
+void mergeDimensionRanges(DimensionRanges& ranges, std::size_t firstDimension, const DimensionRanges& more);
+
+/**
+ * Determine the per dimension mapping onto 16 bit integers that spans the range of every dimension.
+ * @param ranges Range of every dimension, see computeDimensionRanges()
+ * @return Offset and scale of every dimension
+ */
+DimensionScaling computeInt16Scaling(const DimensionRanges& ranges);
+
+/**
+ * Determine the per dimension mapping of a row major matrix onto 16 bit integers, spanning the range of every dimension.
+ * @param values Row major matrix
+ * @param numPoints Number of rows
+ * @param numDimensions Number of columns
+ * @return Offset and scale of every dimension
+ */
+DimensionScaling computeInt16Scaling(const float* values, std::size_t numPoints, std::size_t numDimensions);
+
+/**
+ * Convert a row major matrix to scaled 16 bit integers, in parallel on the shared thread pool.
+ * @param values Row major matrix
+ * @param numPoints Number of rows
+ * @param numDimensions Number of columns
+ * @param scaling Mapping of every dimension, see computeInt16Scaling()
+ * @param destination Receives numPoints * numDimensions integers
+ */
+void convertToScaledInt16(const float* values, std::size_t numPoints, std::size_t numDimensions, const DimensionScaling& scaling, std::int16_t* destination);
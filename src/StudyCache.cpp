@@ -0,0 +1,426 @@
+#include "StudyCache.h"
+#include "MappedFile.h"
+#include "ValueDecoding.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <system_error>
+#include <thread>
+
+namespace
+{
+    const char magic[8] = { 'V', 'T', 'K', 'S', 'T', 'U', 'D', 'Y' };
+
+    /** Fixed size header at the start of a cache file, all offsets are relative to the start of the file */
+    struct CacheHeader
+    {
+        char            magic[8];
+        std::uint32_t   version;
+        std::uint32_t   isPathlines;
+        std::uint64_t   numPoints;
+        std::uint64_t   numDimensions;
+        std::uint64_t   lineSize;
+        std::uint64_t   keyOffset;
+        std::uint64_t   keySize;
+        std::uint64_t   namesOffset;
+        std::uint64_t   namesSize;
+        std::uint64_t   dataOffset;
+        std::int32_t    volumeDimensions[3];
+        std::uint32_t   numberOfFiles;          /** Number of study files in the key, the lines after the first */
+        std::uint64_t   voxelIndicesOffset;
+        std::uint64_t   numVoxelIndices;
+    };
+
+    const std::uint64_t dataAlignment = 64;
+
+    /** 64 bit FNV-1a hash, names the cache file of a key */
+    std::uint64_t hashKey(const std::string& key)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+
+        for (const auto character : key) {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    /** Age after which a temporary file is taken to be left behind by an interrupted writer */
+    const auto abandonedTemporaryAge = std::chrono::hours(1);
+
+    /** Suffix of the temporary file of a write, unique among the processes and threads writing to the cache directory */
+    std::string temporarySuffix()
+    {
+        static std::atomic<std::uint64_t> numberOfWrites(0);
+
+        std::random_device randomDevice;
+
+        // The random device may be deterministic on some platforms, the thread, time and write count still differ.
+        const auto suffix = (static_cast<std::uint64_t>(randomDevice()) << 32 ^ randomDevice())
+            ^ std::hash<std::thread::id>()(std::this_thread::get_id())
+            ^ static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) * 1099511628211ull
+            ^ numberOfWrites++;
+
+        char text[24];
+        std::snprintf(text, sizeof(text), ".%016llx.tmp", static_cast<unsigned long long>(suffix));
+
+        return text;
+    }
+
+    std::filesystem::path toPath(const std::string& utf8Path)
+    {
+        return std::filesystem::u8path(utf8Path);
+    }
+
+    /** Line of the key of a study file: its absolute path, size and modification time, empty if it can not be inspected */
+    std::string fileKey(const std::filesystem::path& filePath)
+    {
+        std::error_code error;
+
+        const auto path = std::filesystem::absolute(filePath, error);
+
+        if (error)
+            return std::string();
+
+        const auto fileSize = std::filesystem::file_size(path, error);
+
+        if (error)
+            return std::string();
+
+        const auto modificationTime = std::filesystem::last_write_time(path, error);
+
+        if (error)
+            return std::string();
+
+        return path.u8string() + "|" + std::to_string(fileSize) + "|" + std::to_string(modificationTime.time_since_epoch().count());
+    }
+
+    /**
+     * Whether a cache file can still be read: it is of this format and none of its study files changed. Study files
+     * that can not be reached, e.g. on a drive that is not mounted, may come back unchanged and do not count.
+     */
+    bool isCurrentEntry(const std::filesystem::path& entryPath)
+    {
+        MappedFile file;
+
+        if (!file.open(entryPath.u8string()) || file.size() < sizeof(CacheHeader))
+            return false;
+
+        CacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != StudyCache::formatVersion)
+            return false;
+
+        if (header.keyOffset > file.size() || header.keySize > file.size() - header.keyOffset)
+            return false;
+
+        const std::string key(file.data() + header.keyOffset, header.keySize);
+
+        // The first line of the key holds the format, every next one a study file, the selection follows them.
+        auto lineEnd = key.find('\n');
+
+        for (std::uint32_t fileIndex = 0; fileIndex < header.numberOfFiles; fileIndex++) {
+            if (lineEnd == std::string::npos)
+                return false;
+
+            const auto lineStart = lineEnd + 1;
+
+            lineEnd = key.find('\n', lineStart);
+
+            if (lineEnd == std::string::npos)
+                return false;
+
+            const auto line = key.substr(lineStart, lineEnd - lineStart);
+
+            // The path may hold separators itself, the size and modification time never do.
+            const auto timeSeparator = line.rfind('|');
+
+            if (timeSeparator == std::string::npos || timeSeparator == 0)
+                return false;
+
+            const auto sizeSeparator = line.rfind('|', timeSeparator - 1);
+
+            if (sizeSeparator == std::string::npos || sizeSeparator == 0)
+                return false;
+
+            const auto currentLine = fileKey(toPath(line.substr(0, sizeSeparator)));
+
+            if (!currentLine.empty() && currentLine != line)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+StudyCache::StudyCache(const std::string& cacheDirectory, const std::vector<std::string>& filePaths, const std::string& selection) :
+    _key(),
+    _numberOfFiles(filePaths.size()),
+    _cacheFilePath()
+{
+    // The byte order and float layout are part of the key, so a cache directory may be shared between machines.
+    _key = "v" + std::to_string(formatVersion) + (hostIsBigEndian() ? " be" : " le") + "\n";
+
+    for (const auto& filePath : filePaths) {
+        const auto line = fileKey(toPath(filePath));
+
+        if (line.empty())
+            return;
+
+        _key += line + "\n";
+    }
+
+    _key += selection;
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.vtkcache", static_cast<unsigned long long>(hashKey(_key)));
+
+    _cacheFilePath = (toPath(cacheDirectory) / fileName).u8string();
+}
+
+bool StudyCache::read(LoadedStudy& study) const
+{
+    if (_cacheFilePath.empty())
+        return false;
+
+    MappedFile file;
+
+    if (!file.open(_cacheFilePath) || file.size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion)
+        return false;
+
+    const auto dataSize = header.numPoints * header.numDimensions * sizeof(float);
+
+    const auto inFile = [&file](std::uint64_t offset, std::uint64_t size) {
+        return offset <= file.size() && size <= file.size() - offset;
+    };
+
+    const auto voxelIndicesSize = header.numVoxelIndices * sizeof(std::uint32_t);
+
+    if (!inFile(header.keyOffset, header.keySize) || !inFile(header.namesOffset, header.namesSize) || !inFile(header.dataOffset, dataSize) || !inFile(header.voxelIndicesOffset, voxelIndicesSize))
+        return false;
+
+    if (header.keySize != _key.size() || std::memcmp(file.data() + header.keyOffset, _key.data(), _key.size()) != 0)
+        return false;
+
+    LoadedStudy cachedStudy;
+
+    cachedStudy.isPathlines     = header.isPathlines != 0;
+    cachedStudy.numPoints       = header.numPoints;
+    cachedStudy.numDimensions   = header.numDimensions;
+    cachedStudy.lineSize        = header.lineSize;
+
+    std::copy(std::begin(header.volumeDimensions), std::end(header.volumeDimensions), cachedStudy.volumeDimensions.begin());
+
+    // Dimension names.
+    const auto* names       = file.data() + header.namesOffset;
+    const auto* namesEnd    = names + header.namesSize;
+
+    cachedStudy.dimensionNames.reserve(header.numDimensions);
+
+    while (names < namesEnd) {
+        std::uint32_t nameSize;
+
+        if (namesEnd - names < static_cast<std::ptrdiff_t>(sizeof(nameSize)))
+            return false;
+
+        std::memcpy(&nameSize, names, sizeof(nameSize));
+        names += sizeof(nameSize);
+
+        if (static_cast<std::size_t>(namesEnd - names) < nameSize)
+            return false;
+
+        cachedStudy.dimensionNames.emplace_back(names, nameSize);
+        names += nameSize;
+    }
+
+    if (cachedStudy.dimensionNames.size() != cachedStudy.numDimensions)
+        return false;
+
+    // The matrix is copied out of the mapping in one go, its layout already matches the dataset. The matrix of the
+    // study is reused, so its memory budget applies.
+    cachedStudy.data = std::move(study.data);
+    cachedStudy.data.resize(header.numPoints * header.numDimensions);
+    std::memcpy(cachedStudy.data.data(), file.data() + header.dataOffset, dataSize);
+
+    cachedStudy.voxelIndices.resize(header.numVoxelIndices);
+    std::memcpy(cachedStudy.voxelIndices.data(), file.data() + header.voxelIndicesOffset, voxelIndicesSize);
+
+    study = std::move(cachedStudy);
+
+    // The modification time of an entry is the time it was last used, see prune().
+    std::error_code error;
+    std::filesystem::last_write_time(toPath(_cacheFilePath), std::filesystem::file_time_type::clock::now(), error);
+
+    return true;
+}
+
+bool StudyCache::write(const LoadedStudy& study) const
+{
+    if (_cacheFilePath.empty())
+        return false;
+
+    std::error_code error;
+
+    const auto cacheFilePath = toPath(_cacheFilePath);
+
+    std::filesystem::create_directories(cacheFilePath.parent_path(), error);
+
+    if (error)
+        return false;
+
+    std::string names;
+
+    for (const auto& dimensionName : study.dimensionNames) {
+        const auto nameSize = static_cast<std::uint32_t>(dimensionName.size());
+
+        names.append(reinterpret_cast<const char*>(&nameSize), sizeof(nameSize));
+        names.append(dimensionName);
+    }
+
+    CacheHeader header = {};
+
+    std::memcpy(header.magic, magic, sizeof(magic));
+
+    header.version          = formatVersion;
+    header.isPathlines      = study.isPathlines ? 1 : 0;
+    header.numPoints        = study.numPoints;
+    header.numDimensions    = study.numDimensions;
+    header.lineSize         = study.lineSize;
+    header.keyOffset        = sizeof(CacheHeader);
+    header.keySize          = _key.size();
+    header.namesOffset      = header.keyOffset + header.keySize;
+    header.namesSize        = names.size();
+    header.dataOffset       = (header.namesOffset + header.namesSize + dataAlignment - 1) / dataAlignment * dataAlignment;
+    header.voxelIndicesOffset   = header.dataOffset + study.data.size() * sizeof(float);
+    header.numVoxelIndices      = study.voxelIndices.size();
+    header.numberOfFiles        = static_cast<std::uint32_t>(_numberOfFiles);
+
+    std::copy(study.volumeDimensions.begin(), study.volumeDimensions.end(), std::begin(header.volumeDimensions));
+
+    // Write to a temporary file first, so readers never see a partially written entry. Every writer has its own,
+    // processes or threads storing the same study at once each rename a complete file.
+    auto temporaryFilePath = cacheFilePath;
+    temporaryFilePath += temporarySuffix();
+
+    {
+        std::ofstream stream(temporaryFilePath, std::ios::binary | std::ios::trunc);
+
+        if (!stream)
+            return false;
+
+        const std::string padding(header.dataOffset - header.namesOffset - header.namesSize, '\0');
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(_key.data(), _key.size());
+        stream.write(names.data(), names.size());
+        stream.write(padding.data(), padding.size());
+        stream.write(reinterpret_cast<const char*>(study.data.data()), study.data.size() * sizeof(float));
+        stream.write(reinterpret_cast<const char*>(study.voxelIndices.data()), study.voxelIndices.size() * sizeof(std::uint32_t));
+
+        if (!stream.flush()) {
+            stream.close();
+            std::filesystem::remove(temporaryFilePath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryFilePath, cacheFilePath, error);
+
+    if (error) {
+        std::filesystem::remove(temporaryFilePath, error);
+        return false;
+    }
+
+    return true;
+}
+
+void StudyCache::prune(std::uint64_t sizeLimit) const
+{
+    if (_cacheFilePath.empty())
+        return;
+
+    struct CacheEntry
+    {
+        std::filesystem::path               path;
+        std::uint64_t                       size;
+        std::filesystem::file_time_type     lastUse;
+    };
+
+    const auto cacheFilePath = toPath(_cacheFilePath);
+
+    std::error_code error;
+
+    auto totalSize = static_cast<std::uint64_t>(std::filesystem::file_size(cacheFilePath, error));
+
+    if (error)
+        totalSize = 0;
+
+    std::vector<CacheEntry> entries;
+
+    // Entries that can not be read again go first, whatever the size of the cache. Other processes may remove or
+    // replace entries meanwhile, entries that can not be inspected are left alone.
+    for (std::filesystem::directory_iterator iterator(cacheFilePath.parent_path(), error), end; !error && iterator != end; iterator.increment(error)) {
+        const auto& path = iterator->path();
+
+        std::error_code entryError;
+
+        // Temporary files of writers that were interrupted are never renamed, those of running writers are young.
+        if (path.extension() == ".tmp" && path.filename().u8string().find(".vtkcache.") != std::string::npos) {
+            const auto modificationTime = std::filesystem::last_write_time(path, entryError);
+
+            if (!entryError && std::filesystem::file_time_type::clock::now() - modificationTime > abandonedTemporaryAge)
+                std::filesystem::remove(path, entryError);
+
+            continue;
+        }
+
+        if (path.extension() != ".vtkcache" || path.filename() == cacheFilePath.filename())
+            continue;
+
+        if (!isCurrentEntry(path)) {
+            std::filesystem::remove(path, entryError);
+            continue;
+        }
+
+        const auto size     = std::filesystem::file_size(path, entryError);
+        const auto lastUse  = std::filesystem::last_write_time(path, entryError);
+
+        if (entryError)
+            continue;
+
+        entries.push_back({ path, static_cast<std::uint64_t>(size), lastUse });
+        totalSize += size;
+    }
+
+    if (sizeLimit == 0)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& left, const CacheEntry& right) {
+        return left.lastUse < right.lastUse;
+    });
+
+    for (const auto& entry : entries) {
+        if (totalSize <= sizeLimit)
+            break;
+
+        std::error_code entryError;
+
+        if (std::filesystem::remove(entry.path, entryError))
+            totalSize -= entry.size;
+    }
+}
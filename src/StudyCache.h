@@ -0,0 +1,79 @@
+#pragma once
+
+#include "VTKStudyLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Study cache
+// =============================================================================
+
+/**
+ * On-disk cache of loaded studies, so a repeated import of an unchanged study skips parsing and stitching.
+ *
+ * A study is identified by the paths, sizes and modification times of its files and by the part of it that
+ * was loaded; editing, replacing or reordering any file, or selecting another part, yields a different key. Each study is stored in its own file in the cache directory:
+ *
+ *   header      magic, format version, matrix shape, line size and the offsets of the sections below
+ *   key         the full key text, compared on read to rule out hash collisions
+ *   names       the dimension names, each as a 32 bit length followed by its UTF-8 bytes
+ *   data        the row major float matrix, aligned to 64 bytes, in host byte order
+ *   voxels      the voxel index of every row of a masked volume study as 32 bit integers, empty otherwise
+ *
+ * Reading maps the cache file and copies the matrix out in one pass. Files are written to a temporary name
+ * unique to the writer and renamed, so an interrupted write never leaves a truncated entry behind and writers
+ * storing the same study at once do not collide. A cache that cannot be read or
+ * written is treated as a miss; the cache never makes a load fail.
+ *
+ * The cache is bounded: prune() removes the entries whose study files changed, which can never be read
+ * again, and then the least recently used entries until the rest fits the size limit. Reading an entry marks it as
+ * used by updating its modification time.
+ */
+class StudyCache
+{
+public:
+
+    /**
+     * Constructor
+     * @param cacheDirectory UTF-8 encoded path of the directory holding the cache files, created when needed
+     * @param filePaths UTF-8 encoded paths of all files of the study, in selection order
+     * @param selection Key of the part of the study that was loaded, see LoadSelection::key()
+     */
+    StudyCache(const std::string& cacheDirectory, const std::vector<std::string>& filePaths, const std::string& selection = std::string());
+
+    /**
+     * Read the study from the cache.
+     * @param study Study to fill
+     * @return True if the cache held an up to date copy of the study
+     */
+    bool read(LoadedStudy& study) const;
+
+    /**
+     * Store a loaded study in the cache, replacing any previous entry.
+     * @param study Loaded study
+     * @return True if the cache file was written
+     */
+    bool write(const LoadedStudy& study) const;
+
+    /**
+     * Remove the entries of studies whose files changed, then the least recently used entries until all entries
+     * fit the size limit. Entries whose files can not be reached are left to the size limit. The entry of this study
+     * is kept.
+     * @param sizeLimit Number of bytes all entries may take together, zero for no limit
+     */
+    void prune(std::uint64_t sizeLimit) const;
+
+    /** Path of the cache file of the study, empty if the files of the study could not be inspected */
+    const std::string& cacheFilePath() const { return _cacheFilePath; }
+
+    /** Version of the cache file layout, entries of other versions are ignored */
+    static constexpr std::uint32_t formatVersion = 3;
+
+private:
+    std::string     _key;               /** Paths, sizes and modification times of the study files, and the selection */
+    std::size_t     _numberOfFiles;     /** Number of study files in the key */
+    std::string     _cacheFilePath;
+};
@@ -0,0 +1,196 @@
+#include "StudyManifest.h"
+#include "CompressedFile.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "VTKXMLReader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace
+{
+    /** Number of failures listed in an error message before the rest are counted */
+    const std::size_t maximumListedFailures = 5;
+
+    /** Joins the failures into one message, listing the first few */
+    std::string failureMessage(const std::string& heading, const std::vector<std::string>& failures)
+    {
+        auto message = heading;
+
+        for (std::size_t index = 0; index < failures.size() && index < maximumListedFailures; index++)
+            message += "\n" + failures[index];
+
+        if (failures.size() > maximumListedFailures)
+            message += "\n(" + std::to_string(failures.size() - maximumListedFailures) + " more)";
+
+        return message;
+    }
+}
+
+StudyManifest StudyManifest::scan(const std::vector<std::string>& filePaths, const std::function<void(const VTKFileManifest&)>& fileScanned)
+{
+    if (filePaths.empty())
+        throw std::runtime_error("The study has no files");
+
+    StudyManifest manifest;
+
+    manifest.timepointsPerGroup = groupSize(filePaths);
+    manifest.numberOfGroups     = static_cast<int>(filePaths.size()) / manifest.timepointsPerGroup;
+
+    manifest.files.resize(filePaths.size());
+
+    std::vector<std::string> errors(filePaths.size());
+
+    ThreadPool::global().parallelFor(filePaths.size(), [&filePaths, &manifest, &errors, &fileScanned](std::size_t fileIndex) {
+        const auto& filePath = filePaths[fileIndex];
+        auto& file = manifest.files[fileIndex];
+
+        // Compressed files are decompressed in full, which their parsers do anyway; only the first one tells the kind of study.
+        if (fileIndex > 0 && fileCompression(filePath) != FileCompression::None) {
+            file.filePath       = filePath;
+            file.isXML          = VTKXMLReader::isXMLFile(filePath);
+            file.isCompressed   = true;
+        }
+        else {
+            try {
+                file = scanFile(filePath);
+            }
+            catch (const std::exception& exception) {
+                errors[fileIndex] = exception.what();
+            }
+        }
+
+        if (fileScanned)
+            fileScanned(file);
+    });
+
+    std::vector<std::string> failures;
+
+    for (const auto& error : errors)
+        if (!error.empty())
+            failures.push_back(error);
+
+    if (!failures.empty())
+        throw std::runtime_error(failureMessage(std::to_string(failures.size()) + " of " + std::to_string(filePaths.size()) + " files of the study can not be read:", failures));
+
+    // Every file has to be of the same kind as the first, volumes also of the same grid.
+    const auto& first = manifest.files.front();
+
+    manifest.isPathlines = first.numberOfLines > 0;
+
+    for (const auto& file : manifest.files) {
+        if (!file.isScanned)
+            continue;
+
+        if ((file.numberOfLines > 0) != manifest.isPathlines)
+            failures.push_back(file.filePath + (manifest.isPathlines ? " has no line cells, unlike " : " has line cells, unlike ") + first.filePath);
+        else if (file.isXML == first.isXML && file.datasetType != first.datasetType)
+            failures.push_back(file.filePath + " holds a " + file.datasetType + " dataset, " + first.filePath + " a " + first.datasetType + " dataset");
+        else if (!manifest.isPathlines && file.dimensions != first.dimensions)
+            failures.push_back(file.filePath + " has other grid dimensions than " + first.filePath);
+    }
+
+    if (!failures.empty())
+        throw std::runtime_error(failureMessage("The files do not form one study:", failures));
+
+    return manifest;
+}
+
+VTKFileManifest StudyManifest::scanFile(const std::string& filePath)
+{
+    VTKFileManifest manifest;
+
+    if (VTKXMLReader::isXMLFile(filePath)) {
+        manifest = VTKXMLReader().readManifest(filePath);
+        manifest.isXML = true;
+    }
+    else {
+        MappedFile file(filePath);
+
+        if (!file.isOpen())
+            throw std::runtime_error("Could not open " + filePath);
+
+        auto& layout = manifest.layout;
+
+        layout = VTKLegacyReader().locate(file, filePath);
+
+        manifest.hasLayout      = true;
+        manifest.contentSize    = file.size();
+        manifest.binary         = layout.binary;
+        manifest.datasetType    = layout.datasetType;
+        manifest.dimensions     = layout.dimensions;
+        manifest.numberOfPoints = layout.points.count / 3;
+        manifest.numberOfLines  = layout.numberOfLines;
+
+        // Structured points have no positions, but a point per voxel.
+        if (layout.points.position != nullptr)
+            manifest.pointsOffset = layout.points.offset;
+        else
+            manifest.numberOfPoints = static_cast<std::size_t>(layout.dimensions[0]) * layout.dimensions[1] * layout.dimensions[2];
+
+        for (const auto& array : layout.pointData)
+            manifest.pointArrays.push_back({ array.name, array.type, array.count, array.offset });
+
+        // The positions point into the mapping that is closed here, VTKLegacyReader::attach() restores them.
+        layout.points.position  = nullptr;
+        layout.cells.position   = nullptr;
+
+        for (auto& array : layout.pointData)
+            array.position = nullptr;
+    }
+
+    manifest.filePath       = filePath;
+    manifest.isCompressed   = fileCompression(filePath) != FileCompression::None;
+    manifest.isScanned      = true;
+
+    std::error_code error;
+
+    const auto fileSize = std::filesystem::file_size(std::filesystem::u8path(filePath), error);
+
+    if (!error)
+        manifest.fileSize = static_cast<std::size_t>(fileSize);
+
+    return manifest;
+}
+
+std::string StudyManifest::groupName(const std::string& filePath)
+{
+    const auto path = std::filesystem::u8path(withoutCompressionExtension(filePath));
+
+    auto name = (path.parent_path() / path.stem()).u8string();
+
+    while (!name.empty() && name.back() >= '0' && name.back() <= '9')
+        name.pop_back();
+
+    return name;
+}
+
+int StudyManifest::groupSize(const std::vector<std::string>& filePaths)
+{
+    const auto numberOfFiles = static_cast<int>(filePaths.size());
+
+    // Runs of files with the same group name, of equal length, are the groups.
+    std::vector<int> runLengths;
+
+    for (int fileIndex = 0; fileIndex < numberOfFiles; fileIndex++) {
+        if (fileIndex == 0 || groupName(filePaths[fileIndex]) != groupName(filePaths[fileIndex - 1]))
+            runLengths.push_back(0);
+
+        runLengths.back()++;
+    }
+
+    const auto isUniform = std::all_of(runLengths.begin(), runLengths.end(), [&runLengths](int runLength) {
+        return runLength == runLengths.front();
+    });
+
+    if (runLengths.size() > 1 && isUniform && runLengths.front() > 1)
+        return runLengths.front();
+
+    // The 4D flow dataset of the thesis "Stochastic Neighbor Embedding for interactive visualization of flow patterns
+    // in 4D flow MRI" by Mitchell de Boer consists of pathlines subdivided into flow components of 30 timepoints each.
+    if (numberOfFiles > 0 && numberOfFiles % defaultTimepointsPerGroup == 0)
+        return defaultTimepointsPerGroup;
+
+    return std::max(numberOfFiles, 1);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "VTKLegacyReader.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/** Point data array of a file, as declared in its header */
+struct VTKArrayManifest
+{
+    std::string     name;
+    std::string     type;                           /** Type name as written in the file, e.g. float or Float32 */
+    std::size_t     count = 0;                      /** Number of values */
+    std::size_t     offset = std::string::npos;     /** Bytes from the start of the file to the values, npos if they can not be sought to */
+};
+
+/** Header and section directory of one file of a study */
+struct VTKFileManifest
+{
+    std::string                     filePath;
+    std::size_t                     fileSize = 0;               /** Bytes on disk */
+    bool                            isXML = false;
+    bool                            isCompressed = false;
+    bool                            isScanned = false;          /** False for compressed files that were left for the parsers, only their name is known */
+    bool                            binary = false;             /** Legacy BINARY files, XML files with binary or appended arrays */
+    std::string                     datasetType;                /** e.g. POLYDATA, STRUCTURED_POINTS or PolyData */
+    std::size_t                     numberOfPoints = 0;         /** Number of points, of voxels for structured points */
+    std::size_t                     numberOfLines = 0;          /** Number of line cells */
+    std::array<int, 3>              dimensions = {};            /** Grid dimensions of structured datasets */
+    std::size_t                     pointsOffset = std::string::npos;   /** Bytes from the start of the file to the point positions, npos if unknown */
+    std::vector<VTKArrayManifest>   pointArrays;                /** Point data arrays, in file order */
+    bool                            hasLayout = false;          /** Whether layout holds the located sections of a legacy file */
+    VTKLegacyLayout                 layout;                     /** Sections of a legacy file by offset, see VTKLegacyReader::attach() */
+    std::size_t                     contentSize = 0;            /** Bytes of the scanned contents, decompressed if the file is compressed */
+};
+
+// =============================================================================
+// Study manifest
+// =============================================================================
+
+/**
+ * Header and section directory of every file of a study, read before any values are.
+ *
+ * Every file is scanned in parallel: its format, dataset type, point, line cell and array counts and the byte offsets
+ * of its sections. Binary legacy files are walked by skipping their sections by size, ASCII legacy files by skipping
+ * their values as text, XML files up to their appended data. Compressed files are only scanned when they lead the
+ * study, the others would have to be decompressed twice. The files are checked against each other, so a broken or
+ * mismatching series fails before the first value is converted, and the located sections are handed to the
+ * pathline streams, which then seek straight to them.
+ *
+ * The groups of a study follow from the file names: runs of files whose names only differ in their trailing number
+ * are the timepoints of one group. Names that do not tell groups apart are split into groups of
+ * defaultTimepointsPerGroup files when their number allows it, and make a single group otherwise.
+ */
+struct StudyManifest
+{
+    std::vector<VTKFileManifest>    files;                  /** One entry per file, in the order of the file paths */
+    int                             numberOfGroups = 0;
+    int                             timepointsPerGroup = 0;
+    bool                            isPathlines = false;    /** Whether the files hold line cells, or volumes otherwise */
+
+    /** Number of timepoints per group of studies whose file names do not tell their groups apart */
+    static constexpr int defaultTimepointsPerGroup = 30;
+
+    /**
+     * Scan the files of a study in parallel and check them against each other. Throws std::runtime_error naming the
+     * files that can not be read or do not match the rest of the study.
+     * @param filePaths UTF-8 encoded paths of the files, grouped by flow component and in time order
+     * @param fileScanned Called from the scanning threads after every file, may throw to stop the scan
+     * @return Manifest of the study
+     */
+    static StudyManifest scan(const std::vector<std::string>& filePaths, const std::function<void(const VTKFileManifest&)>& fileScanned = nullptr);
+
+    /**
+     * Scan the header and section directory of a single file. Throws std::runtime_error if it is not a valid VTK file.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Manifest of the file
+     */
+    static VTKFileManifest scanFile(const std::string& filePath);
+
+    /**
+     * Returns the name of the group of a file: its path without extensions and trailing number. Files with the same
+     * group name are timepoints of one group.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Group name
+     */
+    static std::string groupName(const std::string& filePath);
+
+    /**
+     * Returns the number of timepoints per group told by the file names alone, without reading the files.
+     * @param filePaths Paths of the files, grouped by flow component and in time order
+     * @return Number of files per group, a divisor of the number of files
+     */
+    static int groupSize(const std::vector<std::string>& filePaths);
+};
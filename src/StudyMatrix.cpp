@@ -0,0 +1,307 @@
+#include "StudyMatrix.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    /** Returns the directory for scratch files, the temporary directory when none is set */
+    std::filesystem::path scratchDirectoryPath(const std::string& scratchDirectory)
+    {
+        return scratchDirectory.empty() ? std::filesystem::temp_directory_path() : std::filesystem::u8path(scratchDirectory);
+    }
+}
+
+StudyMatrix::StudyMatrix(std::vector<float>&& values) :
+    _values(std::move(values))
+{
+}
+
+StudyMatrix::~StudyMatrix()
+{
+    closeScratch();
+}
+
+StudyMatrix::StudyMatrix(StudyMatrix&& other) noexcept
+{
+    swap(other);
+}
+
+StudyMatrix& StudyMatrix::operator=(StudyMatrix&& other) noexcept
+{
+    if (this != &other) {
+        closeScratch();
+        std::vector<float>().swap(_values);
+
+        swap(other);
+    }
+
+    return *this;
+}
+
+void StudyMatrix::swap(StudyMatrix& other) noexcept
+{
+    std::swap(_values, other._values);
+    std::swap(_mapping, other._mapping);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+    std::swap(_memoryBudget, other._memoryBudget);
+    std::swap(_scratchDirectory, other._scratchDirectory);
+#ifdef _WIN32
+    std::swap(_fileHandle, other._fileHandle);
+    std::swap(_mappingHandle, other._mappingHandle);
+#else
+    std::swap(_file, other._file);
+#endif
+}
+
+void StudyMatrix::setMemoryBudget(std::size_t memoryBudget, const std::string& scratchDirectory)
+{
+    _memoryBudget       = memoryBudget;
+    _scratchDirectory   = scratchDirectory;
+}
+
+void StudyMatrix::resize(std::size_t size)
+{
+    // Values up to the capacity of the scratch file may hold earlier contents, the file is zero past it.
+    auto writtenSize = _capacity;
+
+    if (!isSpilled()) {
+        if (size * sizeof(float) <= _memoryBudget) {
+            _values.resize(size);
+            return;
+        }
+
+        spill(size);
+
+        writtenSize = _size;
+    }
+
+    // Grow the scratch file geometrically, values past the old size are zero like those of a vector.
+    if (size > _capacity)
+        remap(std::max(size, _capacity + _capacity / 2));
+
+    if (size > _size && writtenSize > _size)
+        std::fill(_mapping + _size, _mapping + std::min(size, writtenSize), 0.0f);
+
+    _size = size;
+}
+
+void StudyMatrix::shrink_to_fit()
+{
+    if (!isSpilled())
+        _values.shrink_to_fit();
+    else if (_size > 0 && _size < _capacity)
+        remap(_size);
+}
+
+std::vector<float> StudyMatrix::takeValues()
+{
+    std::vector<float> values;
+
+    if (!isSpilled()) {
+        values.swap(_values);
+        return values;
+    }
+
+    values.assign(_mapping, _mapping + _size);
+
+    closeScratch();
+
+    return values;
+}
+
+void StudyMatrix::spill(std::size_t capacity)
+{
+    const auto directory = scratchDirectoryPath(_scratchDirectory);
+
+#ifdef _WIN32
+    wchar_t scratchFilePath[MAX_PATH];
+
+    if (GetTempFileNameW(directory.wstring().c_str(), L"vtk", 0, scratchFilePath) == 0)
+        throw std::runtime_error("Unable to create a scratch file in " + directory.u8string());
+
+    // The file is deleted once its last handle is closed, also when the process ends abnormally.
+    HANDLE file = CreateFileW(scratchFilePath, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        DeleteFileW(scratchFilePath);
+        throw std::runtime_error("Unable to create a scratch file in " + directory.u8string());
+    }
+
+    _fileHandle = file;
+#else
+    auto scratchFilePath = (directory / "vtkloader-XXXXXX").string();
+
+    _file = mkstemp(scratchFilePath.data());
+
+    if (_file < 0)
+        throw std::runtime_error("Unable to create a scratch file in " + directory.u8string());
+
+    // Unlinked right away, the file lives as long as its descriptor and mapping, also when the process ends abnormally.
+    unlink(scratchFilePath.c_str());
+#endif
+
+    std::vector<float> values;
+
+    values.swap(_values);
+
+    try {
+        remap(capacity);
+    }
+    catch (...) {
+        _values.swap(values);
+        closeScratch();
+        throw;
+    }
+
+    // Written once, front to back.
+    if (!values.empty())
+        std::memcpy(_mapping, values.data(), values.size() * sizeof(float));
+
+    _size = values.size();
+}
+
+#ifdef _WIN32
+
+void StudyMatrix::remap(std::size_t capacity)
+{
+    if (_mapping != nullptr)
+        UnmapViewOfFile(_mapping);
+
+    if (_mappingHandle != nullptr)
+        CloseHandle(_mappingHandle);
+
+    _mapping        = nullptr;
+    _mappingHandle  = nullptr;
+    _capacity       = 0;
+
+    LARGE_INTEGER fileSize;
+
+    fileSize.QuadPart = static_cast<LONGLONG>(std::max<std::size_t>(capacity, 1) * sizeof(float));
+
+    // Shrinking needs the file to be cut, growing is done by mapping it with the new size.
+    if (!SetFilePointerEx(_fileHandle, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(_fileHandle))
+        throw std::runtime_error("Unable to resize a scratch file");
+
+    _mappingHandle = CreateFileMappingW(_fileHandle, nullptr, PAGE_READWRITE, static_cast<DWORD>(fileSize.QuadPart >> 32), static_cast<DWORD>(fileSize.QuadPart & 0xffffffff), nullptr);
+
+    if (_mappingHandle == nullptr)
+        throw std::runtime_error("Unable to map a scratch file");
+
+    _mapping = static_cast<float*>(MapViewOfFile(_mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+
+    if (_mapping == nullptr)
+        throw std::runtime_error("Unable to map a scratch file");
+
+    _capacity = capacity;
+}
+
+void StudyMatrix::release(std::size_t begin, std::size_t end) const
+{
+    if (!isSpilled())
+        return;
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    const auto pageSize = static_cast<std::uintptr_t>(systemInfo.dwPageSize);
+    const auto first    = (reinterpret_cast<std::uintptr_t>(_mapping + begin) + pageSize - 1) / pageSize * pageSize;
+    const auto last     = reinterpret_cast<std::uintptr_t>(_mapping + std::min(end, _size)) / pageSize * pageSize;
+
+    // Unlocking pages that are not locked removes them from the working set, once they have been written back.
+    if (first < last) {
+        FlushViewOfFile(reinterpret_cast<void*>(first), last - first);
+        VirtualUnlock(reinterpret_cast<void*>(first), last - first);
+    }
+}
+
+void StudyMatrix::closeScratch()
+{
+    if (_mapping != nullptr)
+        UnmapViewOfFile(_mapping);
+
+    if (_mappingHandle != nullptr)
+        CloseHandle(_mappingHandle);
+
+    if (_fileHandle != nullptr)
+        CloseHandle(_fileHandle);
+
+    _mapping        = nullptr;
+    _mappingHandle  = nullptr;
+    _fileHandle     = nullptr;
+    _size           = 0;
+    _capacity       = 0;
+}
+
+#else
+
+void StudyMatrix::remap(std::size_t capacity)
+{
+    if (_mapping != nullptr)
+        munmap(_mapping, std::max<std::size_t>(_capacity, 1) * sizeof(float));
+
+    _mapping    = nullptr;
+    _capacity   = 0;
+
+    // Values keep their place in the file, so mapping it again with the new size keeps them.
+    const auto numberOfBytes = std::max<std::size_t>(capacity, 1) * sizeof(float);
+
+    if (ftruncate(_file, static_cast<off_t>(numberOfBytes)) != 0)
+        throw std::runtime_error("Unable to resize a scratch file");
+
+    void* mapping = mmap(nullptr, numberOfBytes, PROT_READ | PROT_WRITE, MAP_SHARED, _file, 0);
+
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Unable to map a scratch file");
+
+    _mapping    = static_cast<float*>(mapping);
+    _capacity   = capacity;
+}
+
+void StudyMatrix::release(std::size_t begin, std::size_t end) const
+{
+    static const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+
+    if (!isSpilled())
+        return;
+
+    // Only whole pages inside the range are released.
+    const auto first    = (reinterpret_cast<std::uintptr_t>(_mapping + begin) + pageSize - 1) / pageSize * pageSize;
+    const auto last     = reinterpret_cast<std::uintptr_t>(_mapping + std::min(end, _size)) / pageSize * pageSize;
+
+    // The mapping is shared with the file, dropped pages keep their values and are read again when needed.
+    if (first < last)
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+}
+
+void StudyMatrix::closeScratch()
+{
+    if (_mapping != nullptr)
+        munmap(_mapping, std::max<std::size_t>(_capacity, 1) * sizeof(float));
+
+    if (_file >= 0)
+        ::close(_file);
+
+    _mapping    = nullptr;
+    _file       = -1;
+    _size       = 0;
+    _capacity   = 0;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Study matrix
+// =============================================================================
+
+/**
+ * Row major data matrix of a study that moves to a memory mapped scratch file once it outgrows its memory budget.
+ *
+ * Within the budget the values live in a std::vector, which takeValues() hands over without copying. Beyond it they
+ * are written through a shared mapping of a scratch file that is deleted with the matrix, so the operating system
+ * writes them back to disk under memory pressure instead of swapping, and ranges that are complete can be dropped
+ * from the resident memory with release(). The interface mirrors the parts of std::vector the loader uses; like
+ * std::vector, new values are zero. The matrix can be moved but not copied.
+ */
+class StudyMatrix
+{
+public:
+    StudyMatrix() = default;
+    explicit StudyMatrix(std::vector<float>&& values);
+    ~StudyMatrix();
+
+    StudyMatrix(StudyMatrix&& other) noexcept;
+    StudyMatrix& operator=(StudyMatrix&& other) noexcept;
+
+    StudyMatrix(const StudyMatrix&) = delete;
+    StudyMatrix& operator=(const StudyMatrix&) = delete;
+
+    /**
+     * Set the largest size the matrix keeps in memory, it takes effect when the matrix grows.
+     * @param memoryBudget Number of bytes, the matrix moves to a scratch file when it grows larger
+     * @param scratchDirectory UTF-8 encoded path of the directory of the scratch file, the temporary directory when empty
+     */
+    void setMemoryBudget(std::size_t memoryBudget, const std::string& scratchDirectory = std::string());
+
+    /**
+     * Change the number of values, keeping the existing ones. Throws std::runtime_error if the scratch file can not
+     * be created or grown.
+     * @param size Number of values
+     */
+    void resize(std::size_t size);
+
+    /** Return memory (or scratch space) beyond the current size */
+    void shrink_to_fit();
+
+    /**
+     * Tell the operating system that a range of a spilled matrix is complete for now, its pages are written back to
+     * the scratch file and no longer count against the resident memory. The values stay accessible. Does nothing for
+     * a matrix in memory.
+     * @param begin Index of the first value of the range
+     * @param end Index after the last value of the range
+     */
+    void release(std::size_t begin, std::size_t end) const;
+
+    /** Returns the values as a vector, without copying when the matrix is in memory, and leaves the matrix empty */
+    std::vector<float> takeValues();
+
+    /** Whether the values live in a scratch file */
+    bool isSpilled() const { return _mapping != nullptr; }
+
+    float* data() { return isSpilled() ? _mapping : _values.data(); }
+    const float* data() const { return isSpilled() ? _mapping : _values.data(); }
+    std::size_t size() const { return isSpilled() ? _size : _values.size(); }
+    bool empty() const { return size() == 0; }
+
+    float* begin() { return data(); }
+    float* end() { return data() + size(); }
+    const float* begin() const { return data(); }
+    const float* end() const { return data() + size(); }
+
+    float& operator[](std::size_t index) { return data()[index]; }
+    const float& operator[](std::size_t index) const { return data()[index]; }
+
+private:
+    void swap(StudyMatrix& other) noexcept;
+
+    /** Moves the values to a new scratch file with room for capacity values */
+    void spill(std::size_t capacity);
+
+    /** Resizes the scratch file to capacity values and maps it again */
+    void remap(std::size_t capacity);
+
+    /** Unmaps and deletes the scratch file */
+    void closeScratch();
+
+private:
+    std::vector<float>  _values;                                                /** Values of a matrix in memory */
+    float*              _mapping = nullptr;                                     /** Values of a spilled matrix */
+    std::size_t         _size = 0;                                              /** Number of values of a spilled matrix */
+    std::size_t         _capacity = 0;                                          /** Number of values the scratch file holds */
+    std::size_t         _memoryBudget = std::numeric_limits<std::size_t>::max();
+    std::string         _scratchDirectory;
+
+#ifdef _WIN32
+    void* _fileHandle = nullptr;
+    void* _mappingHandle = nullptr;
+#else
+    int _file = -1;
+#endif
+};
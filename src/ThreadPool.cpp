@@ -0,0 +1,71 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t numberOfThreads) :
+    _workers(),
+    _tasks(),
+    _mutex(),
+    _taskAvailable(),
+    _stopping(false)
+{
+    if (numberOfThreads == 0)
+        numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    _workers.reserve(numberOfThreads);
+
+    for (std::size_t threadIndex = 0; threadIndex < numberOfThreads; threadIndex++)
+        _workers.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+
+    _taskAvailable.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    // Intentionally never destroyed: joining workers from static destruction can hang while a plugin library is unloaded.
+    static auto* pool = new ThreadPool();
+    return *pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+
+    _taskAvailable.notify_one();
+}
+
+void ThreadPool::run()
+{
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            _taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+            // Remaining tasks are finished before the pool shuts down.
+            if (_tasks.empty())
+                return;
+
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+
+        task();
+    }
+}
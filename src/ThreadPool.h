@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================================================================
+// Thread pool
+// =============================================================================
+
+/**
+ * Fixed size pool of worker threads.
+ * Work is either queued as independent tasks or distributed with parallelFor, in which the calling thread
+ * takes part. Because the caller always makes progress itself, parallelFor may be nested inside pool tasks
+ * without deadlocking when all workers are busy.
+ */
+class ThreadPool
+{
+public:
+
+    /**
+     * Constructor
+     * @param numberOfThreads Number of worker threads, zero selects the number of hardware threads
+     */
+    explicit ThreadPool(std::size_t numberOfThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Pool shared by all loaders of the process */
+    static ThreadPool& global();
+
+    /** Number of worker threads */
+    std::size_t size() const { return _workers.size(); }
+
+    /** Queue a task for execution on one of the workers */
+    void enqueue(std::function<void()> task);
+
+    /**
+     * Call the function for every index in [0, count), distributed over the workers and the calling thread.
+     * Returns when all indices have been processed. If a call throws, the remaining indices are skipped
+     * and the first exception is rethrown on the calling thread.
+     * @param count Number of indices
+     * @param function Function taking the index as std::size_t
+     */
+    template <typename Function>
+    void parallelFor(std::size_t count, Function&& function)
+    {
+        if (count == 0)
+            return;
+
+        struct State
+        {
+            std::atomic<std::size_t>    next = { 0 };
+            std::atomic<bool>           failed = { false };
+            std::size_t                 completed = 0;
+            std::exception_ptr          exception;
+            std::mutex                  mutex;
+            std::condition_variable     finished;
+        };
+
+        auto state = std::make_shared<State>();
+        auto* callable = &function;
+
+        // Claims indices until none are left, the function is only touched while the caller is still waiting.
+        auto work = [state, callable, count]() {
+            std::size_t index;
+
+            while ((index = state->next.fetch_add(1)) < count) {
+                if (!state->failed) {
+                    try {
+                        (*callable)(index);
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+
+                        if (!state->exception)
+                            state->exception = std::current_exception();
+
+                        state->failed = true;
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+
+                if (++state->completed == count)
+                    state->finished.notify_all();
+            }
+        };
+
+        const auto numberOfHelpers = std::min(size(), count - 1);
+
+        for (std::size_t helperIndex = 0; helperIndex < numberOfHelpers; helperIndex++)
+            enqueue(work);
+
+        work();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+
+        state->finished.wait(lock, [&state, count]() { return state->completed == count; });
+
+        if (state->exception)
+            std::rethrow_exception(state->exception);
+    }
+
+private:
+    void run();
+
+private:
+    std::vector<std::thread>            _workers;
+    std::deque<std::function<void()>>   _tasks;
+    std::mutex                          _mutex;
+    std::condition_variable             _taskAvailable;
+    bool                                _stopping;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Parsed VTK file contents
+// =============================================================================
+
+/**
+ * Attribute array of a VTK file (SCALARS, VECTORS or FIELD array).
+ * Integer typed arrays are kept as integers so identifiers survive exactly, floating point arrays are stored as float.
+ */
+struct VTKDataArray
+{
+    std::string         name;
+    std::string         type;                   /** VTK data type as written in the file, e.g. "float" or "int" */
+    int                 numComponents = 1;
+    bool                isInteger = false;
+    std::vector<float>  values;                 /** Values of floating point arrays */
+    std::vector<int>    integers;               /** Values of integer arrays */
+
+    std::size_t size() const { return isInteger ? integers.size() : values.size(); }
+
+    /** Returns the value at the given index as float, integers convert exactly like std::stof on their text would */
+    float valueAt(std::size_t index) const { return isInteger ? static_cast<float>(integers[index]) : values[index]; }
+
+    /** Returns the value at the given index as integer */
+    int integerAt(std::size_t index) const { return isInteger ? integers[index] : static_cast<int>(values[index]); }
+};
+
+/**
+ * Contents of a single VTK file.
+ * Only the parts used by the loader are kept: points, line cells, the structured grid description and the attribute arrays.
+ * Line cells are stored in compressed row form, an offset per cell into one array of point indices, so the cells of
+ * a file take two allocations however many there are.
+ */
+struct VTKData
+{
+    std::string                         title;
+    std::string                         datasetType;                /** e.g. POLYDATA or STRUCTURED_POINTS */
+    bool                                binary = false;             /** Whether the file was stored as BINARY */
+
+    std::array<int, 3>                  dimensions = { 0, 0, 0 };   /** Grid dimensions of structured datasets */
+    std::array<float, 3>                origin = { 0, 0, 0 };
+    std::array<float, 3>                spacing = { 1, 1, 1 };
+
+    std::vector<std::array<float, 3>>   points;
+    std::vector<std::size_t>            lineOffsets;                /** Start of every line cell in lineConnectivity and the end of the last, empty without line cells */
+    std::vector<int>                    lineConnectivity;           /** Point indices of all line cells, back to back */
+
+    std::vector<VTKDataArray>           pointData;                  /** Point attribute arrays in file order */
+    std::vector<VTKDataArray>           cellData;                   /** Cell attribute arrays in file order */
+
+    /** Number of line cells */
+    std::size_t numberOfLines() const { return lineOffsets.empty() ? 0 : lineOffsets.size() - 1; }
+
+    /** Number of points of a line cell */
+    std::size_t lineSize(std::size_t line) const { return lineOffsets[line + 1] - lineOffsets[line]; }
+
+    /**
+     * Append a line cell.
+     * @param pointIndices First point index of the cell
+     * @param size Number of points of the cell
+     * @param pointOffset Added to every point index
+     */
+    void appendLine(const int* pointIndices, std::size_t size, int pointOffset = 0)
+    {
+        if (lineOffsets.empty())
+            lineOffsets.push_back(lineConnectivity.size());
+
+        for (std::size_t index = 0; index < size; index++)
+            lineConnectivity.push_back(pointIndices[index] + pointOffset);
+
+        lineOffsets.push_back(lineConnectivity.size());
+    }
+
+    /** Returns the first point data array with the given number of components, or nullptr */
+    const VTKDataArray* findPointData(int numComponents, std::size_t occurrence = 0) const
+    {
+        for (const auto& array : pointData) {
+            if (array.numComponents != numComponents)
+                continue;
+
+            if (occurrence == 0)
+                return &array;
+
+            occurrence--;
+        }
+
+        return nullptr;
+    }
+};
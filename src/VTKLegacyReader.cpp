@@ -0,0 +1,738 @@
+#include "VTKLegacyReader.h"
+
+#include "MappedFile.h"
+#include "ValueDecoding.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    bool isIntegerType(std::string_view type)
+    {
+        return type != "float" && type != "double";
+    }
+
+    /** Splits a line into whitespace separated tokens without copying */
+    std::vector<std::string_view> lineTokens(std::string_view line)
+    {
+        VTKScanner scanner(line.data(), line.data() + line.size());
+
+        std::vector<std::string_view> tokens;
+        while (!scanner.atEnd())
+            tokens.push_back(scanner.nextToken());
+
+        return tokens;
+    }
+}
+
+VTKData VTKLegacyReader::read(const std::string& filePath)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    return parse(file.data(), file.end(), filePath);
+}
+
+VTKData VTKLegacyReader::parse(const char* begin, const char* end, const std::string& fileName)
+{
+    _scanner = VTKScanner(begin, end);
+    _fileName = fileName;
+
+    VTKData data;
+
+    _pointData = &data.pointData;
+
+    readHeader(data);
+
+    // Attribute arrays that follow POINT_DATA or CELL_DATA belong to that section.
+    std::vector<VTKDataArray>* attributes = nullptr;
+    std::size_t attributeCount = 0;
+
+    while (!_scanner.atEnd()) {
+        const auto keyword = _scanner.nextToken();
+
+        if (keyword == "DATASET") {
+            data.datasetType = std::string(_scanner.nextToken());
+        }
+        else if (keyword == "POINTS") {
+            readPoints(data);
+        }
+        else if (keyword == "LINES") {
+            readLines(data);
+        }
+        else if (keyword == "VERTICES" || keyword == "POLYGONS" || keyword == "TRIANGLE_STRIPS" || keyword == "CELLS") {
+            readCells();
+        }
+        else if (keyword == "CELL_TYPES") {
+            const auto count = readCount();
+            beginBinaryData();
+            skipValues("int", static_cast<std::size_t>(count));
+        }
+        else if (keyword == "DIMENSIONS") {
+            for (auto& dimension : data.dimensions)
+                dimension = readCount();
+        }
+        else if (keyword == "ORIGIN") {
+            readVector(data.origin);
+        }
+        else if (keyword == "SPACING" || keyword == "ASPECT_RATIO") {
+            readVector(data.spacing);
+        }
+        else if (keyword == "X_COORDINATES" || keyword == "Y_COORDINATES" || keyword == "Z_COORDINATES") {
+            const auto count = readCount();
+            const auto type = _scanner.nextToken();
+            beginBinaryData();
+            skipValues(type, static_cast<std::size_t>(count));
+        }
+        else if (keyword == "POINT_DATA") {
+            attributes = &data.pointData;
+            attributeCount = static_cast<std::size_t>(readCount());
+        }
+        else if (keyword == "CELL_DATA") {
+            attributes = &data.cellData;
+            attributeCount = static_cast<std::size_t>(readCount());
+        }
+        else if (keyword == "SCALARS" || keyword == "VECTORS" || keyword == "NORMALS" || keyword == "TENSORS" || keyword == "TEXTURE_COORDINATES" || keyword == "COLOR_SCALARS") {
+            if (attributes == nullptr)
+                fail(std::string(keyword) + " outside of POINT_DATA or CELL_DATA");
+
+            // Re-read the keyword as part of the attribute declaration.
+            _scanner.seek(keyword.data());
+            readAttributes(*attributes, attributeCount);
+        }
+        else if (keyword == "LOOKUP_TABLE") {
+            // Stand-alone color table: name, size and four components per entry, stored as bytes in binary files.
+            _scanner.nextToken();
+            const auto count = readCount();
+            beginBinaryData();
+            skipValues(_binary ? "unsigned_char" : "float", 4 * static_cast<std::size_t>(count));
+        }
+        else if (keyword == "FIELD") {
+            readFieldData(attributes);
+        }
+        else if (keyword == "METADATA") {
+            // Information block, terminated by an empty line.
+            _scanner.skipLine();
+            while (!_scanner.atEnd() && !_scanner.nextLine().empty());
+        }
+        else {
+            fail("unknown keyword " + std::string(keyword));
+        }
+    }
+
+    return data;
+}
+
+std::size_t VTKLegacyReader::readNumberOfLines(const std::string& filePath)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    _scanner = VTKScanner(file.data(), file.end());
+    _fileName = filePath;
+
+    VTKData header;
+
+    readHeader(header);
+
+    while (!_scanner.atEnd()) {
+        const auto keyword = _scanner.nextToken();
+
+        if (keyword == "LINES") {
+            const auto count = static_cast<std::size_t>(readCount());
+            readCount();
+
+            // Version 5.1 files declare the number of offsets, one more than the number of lines.
+            if (_scanner.peekToken() == "OFFSETS")
+                return count > 0 ? count - 1 : 0;
+
+            return count;
+        }
+
+        if (keyword == "DATASET") {
+            _scanner.nextToken();
+        }
+        else if (keyword == "POINTS") {
+            const auto count = static_cast<std::size_t>(readCount());
+            const auto type = _scanner.nextToken();
+
+            if (_binary) {
+                beginBinaryData();
+                skipValues(type, 3 * count);
+            }
+            else {
+                skipToKeywordLine();
+            }
+        }
+        else if (keyword == "VERTICES" && _scanner.peekToken() != "OFFSETS") {
+            readCount();
+
+            const auto size = static_cast<std::size_t>(readCount());
+
+            if (_binary) {
+                beginBinaryData();
+                skipValues("int", size);
+            }
+            else {
+                skipToKeywordLine();
+            }
+        }
+        else {
+            // Anything else before the lines is rare enough to simply parse the whole file.
+            return parse(file.data(), file.end(), filePath).numberOfLines();
+        }
+    }
+
+    return 0;
+}
+
+std::vector<std::array<float, 3>> VTKLegacyReader::readLeadingPoints(const std::string& filePath, std::size_t count)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    _scanner = VTKScanner(file.data(), file.end());
+    _fileName = filePath;
+
+    VTKData header;
+
+    readHeader(header);
+
+    while (!_scanner.atEnd()) {
+        const auto keyword = _scanner.nextToken();
+
+        if (keyword == "DATASET") {
+            _scanner.nextToken();
+        }
+        else if (keyword == "POINTS") {
+            const auto numberOfPoints = static_cast<std::size_t>(readCount());
+            const auto type = std::string(_scanner.nextToken());
+
+            std::vector<std::array<float, 3>> points(std::min(count, numberOfPoints));
+
+            beginBinaryData();
+            readValues(type, points.empty() ? nullptr : points.front().data(), 3 * points.size(), "POINTS");
+
+            return points;
+        }
+        else {
+            // Points that do not lead the file are rare enough to simply parse the whole file.
+            break;
+        }
+    }
+
+    auto points = parse(file.data(), file.end(), filePath).points;
+
+    points.resize(std::min(count, points.size()));
+
+    return points;
+}
+
+VTKLegacyLayout VTKLegacyReader::locate(const MappedFile& file, const std::string& fileName)
+{
+    VTKLegacyLayout layout;
+
+    _layout = &layout;
+    _file   = &file;
+
+    try {
+        const auto data = parse(file.data(), file.end(), fileName);
+
+        layout.datasetType  = data.datasetType;
+        layout.dimensions   = data.dimensions;
+    }
+    catch (...) {
+        _layout = nullptr;
+        _file   = nullptr;
+        throw;
+    }
+
+    layout.binary = _binary;
+
+    _layout = nullptr;
+    _file   = nullptr;
+
+    return layout;
+}
+
+void VTKLegacyReader::attach(VTKLegacyLayout& layout, const MappedFile& file)
+{
+    // Sections that were not found have no offset, the header always precedes the first value.
+    const auto attachLocation = [&file](VTKValueLocation& location) {
+        location.position = location.offset > 0 ? file.data() + location.offset : nullptr;
+    };
+
+    attachLocation(layout.points);
+    attachLocation(layout.cells);
+
+    for (auto& location : layout.pointData)
+        attachLocation(location);
+}
+
+void VTKLegacyReader::readHeader(VTKData& data)
+{
+    const auto version = _scanner.nextLine();
+
+    if (version.rfind("# vtk", 0) != 0)
+        fail("missing \"# vtk DataFile\" header");
+
+    data.title = std::string(_scanner.nextLine());
+
+    const auto format = _scanner.nextToken();
+
+    if (format != "ASCII" && format != "BINARY")
+        fail("unknown file format " + std::string(format));
+
+    _binary = format == "BINARY";
+    data.binary = _binary;
+}
+
+void VTKLegacyReader::readPoints(VTKData& data)
+{
+    const auto count = static_cast<std::size_t>(readCount());
+
+    // Values are always read as float.
+    const auto type = _scanner.nextToken();
+
+    static_assert(sizeof(std::array<float, 3>) == 3 * sizeof(float), "Points must be tightly packed");
+
+    beginBinaryData();
+
+    if (_layout != nullptr) {
+        if (_layout->points.position != nullptr)
+            _layout->streamable = false;
+
+        _layout->points = skipLocated(type, 3 * count, false);
+        return;
+    }
+
+    data.points.resize(count);
+
+    readValues(type, data.points.empty() ? nullptr : data.points.front().data(), 3 * count, "POINTS");
+}
+
+void VTKLegacyReader::readLines(VTKData& data)
+{
+    const auto numberOfLines = static_cast<std::size_t>(readCount());
+    const auto size = static_cast<std::size_t>(readCount());
+
+    if (_layout != nullptr) {
+        locateLines(numberOfLines, size);
+        return;
+    }
+
+    // Files written as version 5.1 store lines as offsets and connectivity arrays.
+    if (_scanner.peekToken() == "OFFSETS") {
+        _scanner.nextToken();
+
+        const auto offsetsType = _scanner.nextToken();
+
+        std::vector<int> offsets(numberOfLines);
+
+        beginBinaryData();
+        readValues(offsetsType, offsets.data(), offsets.size(), "LINES offsets");
+
+        if (_scanner.nextToken() != "CONNECTIVITY")
+            fail("missing CONNECTIVITY in LINES");
+
+        const auto connectivityType = _scanner.nextToken();
+
+        // The connectivity is read in place, after that of earlier LINES sections.
+        const auto firstIndex = data.lineConnectivity.size();
+
+        data.lineConnectivity.resize(firstIndex + size);
+
+        beginBinaryData();
+        readValues(connectivityType, data.lineConnectivity.data() + firstIndex, size, "LINES connectivity");
+
+        if (!offsets.empty() && offsets.front() != 0)
+            fail("invalid LINES offsets");
+
+        if (data.lineOffsets.empty() && !offsets.empty())
+            data.lineOffsets.push_back(firstIndex);
+
+        data.lineOffsets.reserve(data.lineOffsets.size() + offsets.size());
+
+        for (std::size_t lineIndex = 0; lineIndex + 1 < offsets.size(); lineIndex++) {
+            if (offsets[lineIndex] > offsets[lineIndex + 1] || static_cast<std::size_t>(offsets[lineIndex + 1]) > size)
+                fail("invalid LINES offsets");
+
+            data.lineOffsets.push_back(firstIndex + static_cast<std::size_t>(offsets[lineIndex + 1]));
+        }
+
+        // Indices past the last offset belong to no cell.
+        if (!offsets.empty())
+            data.lineConnectivity.resize(firstIndex + static_cast<std::size_t>(offsets.back()));
+
+        return;
+    }
+
+    // Each cell is stored as its point count followed by the point indices.
+    std::vector<int> cells(size);
+
+    beginBinaryData();
+    readValues("int", cells.data(), cells.size(), "LINES");
+
+    data.lineOffsets.reserve(data.lineOffsets.size() + numberOfLines + 1);
+    data.lineConnectivity.reserve(data.lineConnectivity.size() + (size > numberOfLines ? size - numberOfLines : 0));
+
+    std::size_t position = 0;
+
+    for (std::size_t lineIndex = 0; lineIndex < numberOfLines; lineIndex++) {
+        if (position >= cells.size() || cells[position] < 0 || position + 1 + static_cast<std::size_t>(cells[position]) > cells.size())
+            fail("invalid LINES cell size");
+
+        const auto cellSize = static_cast<std::size_t>(cells[position]);
+
+        data.appendLine(cells.data() + position + 1, cellSize);
+
+        position += 1 + cellSize;
+    }
+}
+
+void VTKLegacyReader::locateLines(std::size_t numberOfCells, std::size_t size)
+{
+    // Only a single LINES section can be read in blocks.
+    if (_layout->cells.position != nullptr)
+        _layout->streamable = false;
+
+    bool isFirstSegment = true;
+
+    const auto summarize = [this, &isFirstSegment](std::size_t segmentSize) {
+        if (isFirstSegment) {
+            _layout->firstSegmentSize   = segmentSize;
+            _layout->uniformSegmentSize = segmentSize;
+            isFirstSegment              = false;
+        }
+        else if (segmentSize != _layout->uniformSegmentSize) {
+            _layout->uniformSegmentSize = 0;
+        }
+    };
+
+    const char* sectionBegin = nullptr;
+
+    if (_scanner.peekToken() == "OFFSETS") {
+        _scanner.nextToken();
+
+        const auto offsetsType = _scanner.nextToken();
+
+        beginBinaryData();
+
+        sectionBegin = _scanner.position();
+
+        _layout->cellOffsets    = true;
+        _layout->numberOfLines  = numberOfCells > 0 ? numberOfCells - 1 : 0;
+        _layout->cells          = { std::string(offsetsType), true, numberOfCells, sectionBegin, std::string(), static_cast<std::size_t>(sectionBegin - _file->data()) };
+
+        int previousOffset = 0;
+
+        for (std::size_t offsetIndex = 0; offsetIndex < numberOfCells; offsetIndex++) {
+            int offset = 0;
+            readValues(offsetsType, &offset, 1, "LINES offsets");
+
+            if (offsetIndex > 0) {
+                if (previousOffset < 0 || previousOffset > offset || static_cast<std::size_t>(offset) > size)
+                    fail("invalid LINES offsets");
+
+                summarize(static_cast<std::size_t>(offset - previousOffset));
+            }
+
+            previousOffset = offset;
+        }
+
+        if (_scanner.nextToken() != "CONNECTIVITY")
+            fail("missing CONNECTIVITY in LINES");
+
+        const auto connectivityType = _scanner.nextToken();
+
+        beginBinaryData();
+        skipValues(connectivityType, size);
+    }
+    else {
+        beginBinaryData();
+
+        sectionBegin = _scanner.position();
+
+        _layout->numberOfLines  = numberOfCells;
+        _layout->cells          = { "int", true, size, sectionBegin, std::string(), static_cast<std::size_t>(sectionBegin - _file->data()) };
+
+        std::size_t position = 0;
+
+        for (std::size_t cellIndex = 0; cellIndex < numberOfCells; cellIndex++) {
+            int cellSize = 0;
+
+            if (position >= size)
+                fail("invalid LINES cell size");
+
+            readValues("int", &cellSize, 1, "LINES");
+
+            if (cellSize < 0 || position + 1 + static_cast<std::size_t>(cellSize) > size)
+                fail("invalid LINES cell size");
+
+            summarize(static_cast<std::size_t>(cellSize));
+            skipValues("int", static_cast<std::size_t>(cellSize));
+
+            position += 1 + static_cast<std::size_t>(cellSize);
+        }
+
+        skipValues("int", size - position);
+    }
+
+    _file->release(sectionBegin, _scanner.position());
+}
+
+void VTKLegacyReader::readCells()
+{
+    const auto numberOfCells = static_cast<std::size_t>(readCount());
+    const auto size = static_cast<std::size_t>(readCount());
+
+    if (_scanner.peekToken() == "OFFSETS") {
+        _scanner.nextToken();
+
+        const auto offsetsType = _scanner.nextToken();
+
+        beginBinaryData();
+        skipValues(offsetsType, numberOfCells);
+
+        // CONNECTIVITY keyword and data type.
+        _scanner.nextToken();
+
+        const auto connectivityType = _scanner.nextToken();
+
+        beginBinaryData();
+        skipValues(connectivityType, size);
+        return;
+    }
+
+    beginBinaryData();
+    skipValues("int", size);
+}
+
+void VTKLegacyReader::readAttributes(std::vector<VTKDataArray>& arrays, std::size_t count)
+{
+    const auto declaration = lineTokens(_scanner.nextLine());
+
+    if (declaration.size() < 3)
+        fail("incomplete " + std::string(declaration.empty() ? "attribute" : declaration[0]) + " declaration");
+
+    const auto keyword = declaration[0];
+
+    VTKDataArray array;
+
+    array.name = std::string(declaration[1]);
+    array.type = std::string(declaration[2]);
+
+    if (keyword == "SCALARS") {
+        if (declaration.size() > 3)
+            array.numComponents = std::stoi(std::string(declaration[3]));
+
+        // The lookup table line is optional in files written by some exporters.
+        if (_scanner.peekToken() == "LOOKUP_TABLE")
+            _scanner.skipLine();
+    }
+    else if (keyword == "VECTORS" || keyword == "NORMALS") {
+        array.numComponents = 3;
+    }
+    else if (keyword == "TENSORS") {
+        array.numComponents = 9;
+    }
+    else if (keyword == "TEXTURE_COORDINATES") {
+        array.numComponents = std::stoi(std::string(declaration[2]));
+        array.type = declaration.size() > 3 ? std::string(declaration[3]) : "float";
+    }
+    else if (keyword == "COLOR_SCALARS") {
+        array.numComponents = std::stoi(std::string(declaration[2]));
+        array.type = _binary ? "unsigned_char" : "float";
+    }
+
+    readArrayValues(array, count * static_cast<std::size_t>(array.numComponents), &arrays == _pointData);
+
+    // Binary color scalars are stored as bytes and converted while reading, which blocks cannot do.
+    if (keyword == "COLOR_SCALARS" && _binary && _layout != nullptr)
+        _layout->streamable = false;
+
+    // Binary color scalars are stored as bytes, convert them to the [0, 1] range of the ASCII form.
+    if (keyword == "COLOR_SCALARS" && _binary) {
+        array.values.reserve(array.integers.size());
+
+        for (const auto value : array.integers)
+            array.values.push_back(value / 255.0f);
+
+        array.integers.clear();
+        array.isInteger = false;
+        array.type = "float";
+    }
+
+    arrays.push_back(std::move(array));
+}
+
+void VTKLegacyReader::readArrayValues(VTKDataArray& array, std::size_t count, bool isPointData)
+{
+    array.isInteger = isIntegerType(array.type);
+
+    if (_layout != nullptr) {
+        auto location = skipLocated(array.type, count, array.isInteger);
+
+        location.name = array.name;
+
+        if (isPointData)
+            _layout->pointData.push_back(location);
+
+        return;
+    }
+
+    if (array.isInteger) {
+        array.integers.resize(count);
+        readValues(array.type, array.integers.data(), count, "array " + array.name);
+    }
+    else {
+        array.values.resize(count);
+        readValues(array.type, array.values.data(), count, "array " + array.name);
+    }
+}
+
+void VTKLegacyReader::readFieldData(std::vector<VTKDataArray>* arrays)
+{
+    // Field name.
+    _scanner.nextToken();
+
+    const auto numberOfArrays = readCount();
+
+    for (int arrayIndex = 0; arrayIndex < numberOfArrays; arrayIndex++) {
+        VTKDataArray array;
+
+        array.name = std::string(_scanner.nextToken());
+        array.numComponents = readCount();
+
+        const auto numberOfTuples = static_cast<std::size_t>(readCount());
+
+        array.type = std::string(_scanner.nextToken());
+
+        beginBinaryData();
+        readArrayValues(array, numberOfTuples * static_cast<std::size_t>(array.numComponents), arrays != nullptr && arrays == _pointData);
+
+        // Field data outside of an attribute section describes the whole dataset and is not used by the loader.
+        if (arrays != nullptr)
+            arrays->push_back(std::move(array));
+    }
+}
+
+void VTKLegacyReader::readVector(std::array<float, 3>& vector)
+{
+    for (auto& component : vector)
+        if (!_scanner.readFloat(component))
+            fail("invalid vector value");
+}
+
+template <typename Value>
+void VTKLegacyReader::readValues(std::string_view type, Value* destination, std::size_t count, const std::string& section)
+{
+    if (!_binary) {
+        for (std::size_t index = 0; index < count; index++) {
+            bool valid;
+
+            if constexpr (std::is_floating_point<Value>::value)
+                valid = _scanner.readFloat(destination[index]);
+            else
+                valid = _scanner.readInteger(destination[index]);
+
+            if (!valid)
+                fail("invalid value in " + section);
+        }
+
+        return;
+    }
+
+    const auto valueType = valueTypeFromLegacyName(type);
+
+    if (valueType == ValueType::Unknown)
+        fail("unsupported binary data type " + std::string(type) + " in " + section);
+
+    const auto numberOfBytes = count * valueTypeSize(valueType);
+
+    if (static_cast<std::size_t>(_scanner.end() - _scanner.position()) < numberOfBytes)
+        fail("binary data of " + section + " is truncated");
+
+    // Legacy binary files are always big endian.
+    decodeValues(valueType, _scanner.position(), count, true, destination);
+
+    _scanner.seek(_scanner.position() + numberOfBytes);
+}
+
+void VTKLegacyReader::skipValues(std::string_view type, std::size_t count)
+{
+    if (!_binary) {
+        _scanner.skipTokens(count);
+        return;
+    }
+
+    const auto numberOfBytes = count * valueTypeSize(valueTypeFromLegacyName(type));
+
+    if (static_cast<std::size_t>(_scanner.end() - _scanner.position()) < numberOfBytes)
+        fail("binary data is truncated");
+
+    _scanner.seek(_scanner.position() + numberOfBytes);
+}
+
+void VTKLegacyReader::beginBinaryData()
+{
+    // Binary values start right after the line that declares them.
+    if (_binary)
+        _scanner.skipLine();
+}
+
+void VTKLegacyReader::skipToKeywordLine()
+{
+    _scanner.skipLine();
+
+    while (!_scanner.atEnd()) {
+        const auto first = *_scanner.peekToken().data();
+
+        if ((first >= 'A' && first <= 'Z') || (first >= 'a' && first <= 'z'))
+            return;
+
+        _scanner.skipLine();
+    }
+}
+
+VTKValueLocation VTKLegacyReader::skipLocated(std::string_view type, std::size_t count, bool isInteger)
+{
+    VTKValueLocation location;
+
+    location.type       = std::string(type);
+    location.isInteger  = isInteger;
+    location.count      = count;
+    location.position   = _scanner.position();
+    location.offset     = static_cast<std::size_t>(location.position - _file->data());
+
+    if (_binary && valueTypeFromLegacyName(type) == ValueType::Unknown)
+        fail("unsupported binary data type " + std::string(type));
+
+    skipValues(type, count);
+
+    _file->release(location.position, _scanner.position());
+
+    return location;
+}
+
+int VTKLegacyReader::readCount()
+{
+    int count = 0;
+
+    if (!_scanner.readInteger(count) || count < 0)
+        fail("invalid count");
+
+    return count;
+}
+
+void VTKLegacyReader::fail(const std::string& message) const
+{
+    throw std::runtime_error(_fileName + ": " + message);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "VTKData.h"
+#include "VTKScanner.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class MappedFile;
+
+/** Position of an array of values in a mapped legacy file */
+struct VTKValueLocation
+{
+    std::string     type;                   /** VTK type name, e.g. float or vtktypeint64 */
+    bool            isInteger = false;
+    std::size_t     count = 0;              /** Number of values */
+    const char*     position = nullptr;     /** First value, as text or big endian binary */
+    std::string     name;                   /** Name of point data arrays */
+    std::size_t     offset = 0;             /** Bytes from the start of the file to the first value */
+};
+
+/**
+ * Sections of a legacy pathline file, found without converting their values.
+ * Used to read the points, line cells and point data of one file side by side in blocks.
+ */
+struct VTKLegacyLayout
+{
+    bool                            binary = false;
+    bool                            streamable = true;      /** False if the file has sections the block reader cannot serve */
+    std::string                     datasetType;            /** e.g. POLYDATA or STRUCTURED_POINTS */
+    std::array<int, 3>              dimensions = {};        /** Grid dimensions of structured datasets */
+    VTKValueLocation                points;                 /** Three values per point */
+    std::size_t                     numberOfLines = 0;
+    VTKValueLocation                cells;                  /** Cell sizes followed by point ids, or the offsets of version 5.1 files */
+    bool                            cellOffsets = false;    /** Cells are stored as version 5.1 offsets */
+    std::size_t                     firstSegmentSize = 0;   /** Number of points of the first line cell */
+    std::size_t                     uniformSegmentSize = 0; /** Number of points shared by all line cells, zero if they differ */
+    std::vector<VTKValueLocation>   pointData;              /** Point data arrays, in file order */
+};
+
+// =============================================================================
+// Legacy VTK reader
+// =============================================================================
+
+/**
+ * Reader for legacy (.vtk) files.
+ * The file is memory mapped and the sections are walked in place by keyword (POINTS, LINES, POINT_DATA, ...),
+ * so the reader does not depend on blank lines or on the number of values written per line.
+ * ASCII and BINARY files are supported. Binary arrays are big endian and are byte swapped in bulk
+ * directly into the output buffers.
+ * Errors are reported by throwing std::runtime_error with a message naming the file.
+ */
+class VTKLegacyReader
+{
+public:
+
+    /**
+     * Read the file at the given path.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Parsed file contents
+     */
+    VTKData read(const std::string& filePath);
+
+    /**
+     * Parse legacy VTK text that is already in memory.
+     * @param begin Start of the file contents
+     * @param end End of the file contents
+     * @param fileName Name used in error messages
+     * @return Parsed file contents
+     */
+    VTKData parse(const char* begin, const char* end, const std::string& fileName);
+
+    /**
+     * Returns the number of line cells declared by the LINES header of a file without converting the values
+     * that precede it. ASCII point values are skipped line by line, binary ones by their size.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Number of line cells, zero if the file has no LINES section
+     */
+    std::size_t readNumberOfLines(const std::string& filePath);
+
+    /**
+     * Returns the first points of a file without reading the rest of it.
+     * @param filePath UTF-8 encoded path of the file
+     * @param count Maximum number of points
+     * @return Up to count points, fewer if the file holds fewer
+     */
+    std::vector<std::array<float, 3>> readLeadingPoints(const std::string& filePath, std::size_t count);
+
+    /**
+     * Locate the sections of a mapped file without converting their values. Line cell sizes are read to
+     * summarize them. Consumed pages are released from memory as the file is walked.
+     * @param file Mapped file, must stay open while the layout is used
+     * @param fileName Name used in error messages
+     * @return Locations of the points, line cells and point data arrays
+     */
+    VTKLegacyLayout locate(const MappedFile& file, const std::string& fileName);
+
+    /**
+     * Point the locations of a layout into another mapping of the same file, e.g. of a layout kept in a study
+     * manifest after the file it was located in was closed.
+     * @param layout Layout returned by locate()
+     * @param file Mapped file with the same contents as the one that was located
+     */
+    static void attach(VTKLegacyLayout& layout, const MappedFile& file);
+
+private:
+    void readHeader(VTKData& data);
+    void readPoints(VTKData& data);
+    void readLines(VTKData& data);
+    void readCells();
+    void readAttributes(std::vector<VTKDataArray>& arrays, std::size_t count);
+    void readArrayValues(VTKDataArray& array, std::size_t count, bool isPointData);
+    void readFieldData(std::vector<VTKDataArray>* arrays);
+    void readVector(std::array<float, 3>& vector);
+
+    /** Reads count values of the given VTK type, as text or as binary depending on the file format */
+    template <typename Value>
+    void readValues(std::string_view type, Value* destination, std::size_t count, const std::string& section);
+
+    void skipValues(std::string_view type, std::size_t count);
+    void beginBinaryData();
+
+    /** Moves to the next line of ASCII data that starts with a keyword instead of a number */
+    void skipToKeywordLine();
+
+    /** When locating, skips count values and returns their location instead of reading them */
+    VTKValueLocation skipLocated(std::string_view type, std::size_t count, bool isInteger);
+
+    /** Summarizes the sizes of the line cells while locating */
+    void locateLines(std::size_t numberOfCells, std::size_t size);
+
+    int readCount();
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+private:
+    VTKScanner                  _scanner;
+    std::string                 _fileName;
+    bool                        _binary = false;
+    VTKLegacyLayout*            _layout = nullptr;      /** Set while locating instead of reading */
+    const MappedFile*           _file = nullptr;        /** File that is being located */
+    std::vector<VTKDataArray>*  _pointData = nullptr;   /** Point data of the file that is being parsed */
+};
@@ -1,26 +1,42 @@
 
 
 #include "VTKLoaderPlugin.h"
+#include "VTKStudyLoader.h"
+#include "LoadSelectionDialog.h"
+#include "ReducedPrecision.h"
+#include "PathlineLayout.h"
+#include "LoadProfiler.h"
+#include "CompressedFile.h"
+#include "ThreadPool.h"
 
 #include "PointData/PointData.h"
 #include "Set.h"
+#include "ForegroundTask.h"
 
 
 #include <iostream>
-#include <fstream>
 #include <ClusterData/ClusterData.h>
 
 
 #include <QtCore>
 #include <QtDebug>
 #include <QFileDialog>
+#include <QThread>
+#include <QPointer>
 #include <qmessagebox.h>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <random>
 #include <vector>
 #include <deque>
+#include <map>
+#include <set>
 #include <algorithm>
 #include <string>
+#include <utility>
 
 #include<chrono> 
 #include<thread>
@@ -31,6 +47,891 @@ Q_PLUGIN_METADATA(IID "nl.tudelft.VTKLoaderPlugin")
 
 using namespace mv;
 
+namespace
+{
+    /**
+     * Data matrix of a watched study in the layout and precision of its dataset, so an append converts only the
+     * values it adds or changes; the dataset receives a copy. The float matrix of the study keeps only the end of it
+     * that the next append reads: the last point of every pathline, no rows of a volume study unless its dimensions
+     * are scaled integers, which are scaled again from the float rows when their range grows.
+     */
+    struct StoredMatrix
+    {
+        std::size_t                         numRows = 0;
+        std::size_t                         numDimensions = 0;
+        std::size_t                         lineSize = 0;           /** Number of points per pathline, zero for volume studies */
+        std::vector<std::string>            dimensionNames;
+        std::vector<float>                  float32Data;            /** Values stored as floats */
+        std::vector<biovault::bfloat16_t>   bfloat16Data;           /** Values stored as bfloat16 */
+        std::vector<std::int16_t>           int16Data;              /** Values stored as scaled 16 bit integers */
+        DimensionRanges                     ranges;                 /** Range of every dimension, spanned by the scaled integers */
+        std::vector<std::uint32_t>          voxelIndices;           /** Voxel of every row of a masked volume study */
+        std::size_t                         firstStudyRow = 0;      /** Row held by the first row of the float matrix of the study */
+        std::size_t                         firstStudyPoint = 0;    /** Point held by the first point of every row of the float matrix of the study */
+    };
+
+    /** State shared between the loading thread and the GUI thread */
+    struct BackgroundLoad
+    {
+        LoadedStudy                         study;
+        ValuePrecision                      precision = ValuePrecision::Float32;
+        std::vector<float>                  float32Data;        /** Data matrix when stored as floats apart from the study, for studies that keep their values */
+        std::vector<biovault::bfloat16_t>   bfloat16Data;       /** Data matrix when stored as bfloat16 */
+        std::vector<std::int16_t>           int16Data;          /** Data matrix when stored as scaled 16 bit integers */
+        DimensionScaling                    scaling;            /** Mapping of the scaled integers back to values */
+        bool                                compactLayout = false;  /** Whether index, time and group are stored per pathline */
+        bool                                keepsValues = false;    /** Whether the stored matrix, the end of the float matrix and the spatial index of the study are kept after publishing, for appends */
+        StoredMatrix                        stored;             /** Data matrix as published, for studies that keep their values */
+        QByteArray                          pathlineGridBytes;  /** Serialized spatial index of a pathline study */
+        QByteArray                          voxelIndexBytes;    /** Voxel indices of a masked volume study */
+        PathlineMetadata                    metadata;           /** Per pathline values of a study in the compact layout */
+        Dataset<Clusters>                   groupClusters;      /** Groups of a study in the compact layout, one cluster per group */
+        Dataset<Points>                     pathlineValues;     /** Line index and first and last timepoint of every pathline in the compact layout */
+        LoadProfiler                        profiler;           /** Time, bytes and memory of the load stages */
+        QString                             error;
+        bool                                cancelled = false;
+        std::array<float, 4>                phaseProgress = {}; /** Completed fraction of every load phase */
+
+        /** Progress of the whole load, the phases weighted by their typical share of the loading time */
+        float overallProgress() const
+        {
+            const std::array<float, 4> phaseWeights = { 0.05f, 0.6f, 0.25f, 0.1f };
+
+            float progress = 0.0f;
+
+            for (std::size_t phaseIndex = 0; phaseIndex < phaseWeights.size(); phaseIndex++)
+                progress += phaseWeights[phaseIndex] * phaseProgress[phaseIndex];
+
+            return progress;
+        }
+    };
+
+    QString phaseName(LoadPhase phase)
+    {
+        switch (phase)
+        {
+            case LoadPhase::Scan:   return "Scanning";
+            case LoadPhase::Parse:  return "Parsing";
+            case LoadPhase::Stitch: return "Stitching";
+            case LoadPhase::Derive: return "Computing difference vectors";
+        }
+
+        return QString();
+    }
+
+    /**
+     * Move the index, time and group columns out of the rows of a pathline study when the compact layout is chosen.
+     * Runs on the loading thread.
+     * @param load Loaded study
+     */
+    void compactStudy(BackgroundLoad& load)
+    {
+        if (!load.compactLayout || !load.study.isPathlines)
+            return;
+
+        LoadProfiler::Scope scope(&load.profiler, "compact", load.study.data.size() * sizeof(float), load.study.numPoints);
+
+        load.metadata = compactPathlines(load.study);
+    }
+
+    /**
+     * Convert the data matrix of a loaded study to the requested precision, releasing the float matrix.
+     * Runs on the loading thread.
+     * @param load Loaded study and requested precision
+     */
+    void reducePrecision(BackgroundLoad& load)
+    {
+        auto& study = load.study;
+
+        if (load.precision == ValuePrecision::Float32)
+            return;
+
+        LoadProfiler::Scope scope(&load.profiler, "precision", study.data.size() * sizeof(float), study.data.size());
+
+        if (load.precision == ValuePrecision::BFloat16) {
+            static_assert(sizeof(biovault::bfloat16_t) == sizeof(std::uint16_t), "bfloat16 values must be stored in two bytes");
+
+            load.bfloat16Data.resize(study.data.size());
+            convertToBFloat16(study.data.data(), study.data.size(), reinterpret_cast<std::uint16_t*>(load.bfloat16Data.data()));
+        }
+        else {
+            load.scaling = computeInt16Scaling(study.data.data(), study.numPoints, study.numDimensions);
+
+            load.int16Data.resize(study.data.size());
+            convertToScaledInt16(study.data.data(), study.numPoints, study.numDimensions, load.scaling, load.int16Data.data());
+        }
+
+        study.data = StudyMatrix();
+    }
+
+    /**
+     * Fit a stored matrix to the shape of its study and write converted values into part of it, in parallel over
+     * blocks of rows. Widened rows keep their values at the front, added rows follow the existing ones.
+     * @param values Stored matrix of previousRows rows of previousDimensions values
+     * @param previousRows Number of rows of the stored matrix
+     * @param previousDimensions Number of values per row of the stored matrix
+     * @param numRows Number of rows of the study
+     * @param numDimensions Number of values per row of the study, at least previousDimensions
+     * @param firstRow First row to write
+     * @param firstDimension First dimension of every row to write, the dimensions from there to the end of the row are written
+     * @param source Value of row firstRow and dimension firstDimension in a float matrix
+     * @param sourceStride Number of values from one row of the float matrix to the next
+     * @param convert Returns the stored value of a float value and its dimension
+     */
+    template <typename Value, typename Convert>
+    void writeStoredValues(std::vector<Value>& values, std::size_t previousRows, std::size_t previousDimensions, std::size_t numRows, std::size_t numDimensions, std::size_t firstRow, std::size_t firstDimension, const float* source, std::size_t sourceStride, Convert convert)
+    {
+        values.resize(numRows * numDimensions);
+
+        // Rows only move towards the end, so moving them back to front never overwrites a row that has yet to move.
+        if (numDimensions != previousDimensions)
+            for (auto row = previousRows; row-- > 1; )
+                std::memmove(values.data() + row * numDimensions, values.data() + row * previousDimensions, previousDimensions * sizeof(Value));
+
+        const std::size_t blockSize = 4096;
+        const auto numberOfBlocks = (numRows - firstRow + blockSize - 1) / blockSize;
+
+        ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+            const auto blockRow = firstRow + blockIndex * blockSize;
+            const auto endRow   = std::min(blockRow + blockSize, numRows);
+
+            for (auto row = blockRow; row < endRow; row++) {
+                const auto* rowSource = source + (row - firstRow) * sourceStride;
+                auto* rowValues = values.data() + row * numDimensions;
+
+                for (auto dimension = firstDimension; dimension < numDimensions; dimension++)
+                    rowValues[dimension] = convert(rowSource[dimension - firstDimension], dimension);
+            }
+        });
+    }
+
+    /**
+     * Convert part of the float matrix of a study that keeps its values into its stored matrix, and copy the stored
+     * matrix for the dataset. Only the rows from firstRow and the points from firstPoint are converted, the rest of
+     * the stored matrix is kept as it is. Scaled integer dimensions keep their scaling unless their range grows, the
+     * kept rows of a dimension whose range grew are scaled again from the float matrix. The float values that the
+     * next append does not read are dropped afterwards. Runs on the loading thread.
+     * @param load Loaded study that keeps its values
+     * @param firstRow First row added to the stored matrix, zero when no rows were added
+     * @param firstPoint First changed point of every pathline of the stored matrix, zero for volume studies
+     */
+    void storeStudy(BackgroundLoad& load, std::size_t firstRow, std::size_t firstPoint)
+    {
+        auto& study     = load.study;
+        auto& stored    = load.stored;
+
+        // The float matrix holds the stored matrix from its first study row and point on.
+        const auto isCompact                = load.compactLayout && study.isPathlines;
+        const auto studyColumns             = study.isPathlines ? study.numDimensions / study.lineSize : study.numDimensions;
+        const auto numColumns               = isCompact ? compactColumnNames.size() : studyColumns;
+        const auto numRows                  = stored.firstStudyRow + study.numPoints;
+        const auto lineSize                 = study.isPathlines ? stored.firstStudyPoint + study.lineSize : 0;
+        const auto numDimensions            = study.isPathlines ? lineSize * numColumns : study.numDimensions;
+        const auto firstDimension           = study.isPathlines ? firstPoint * numColumns : 0;
+        const auto studyRow                 = firstRow - stored.firstStudyRow;
+        const auto studyPoint               = study.isPathlines ? firstPoint - stored.firstStudyPoint : 0;
+        const auto numberOfChangedRows      = numRows - firstRow;
+        const auto numberOfChangedDimensions = numDimensions - firstDimension;
+
+        LoadProfiler::Scope scope(&load.profiler, "store", numberOfChangedRows * numberOfChangedDimensions * sizeof(float), numberOfChangedRows * numberOfChangedDimensions);
+
+        // The changed values in the stored layout: part of the float matrix, or its changed points in the compact
+        // layout. Pathlines change in every row, so the compact copy starts at the first row.
+        std::vector<float> compactValues;
+
+        const float* source = study.data.data() + studyRow * study.numDimensions + studyPoint * studyColumns;
+        auto sourceStride   = study.numDimensions;
+
+        if (isCompact) {
+            compactValues.resize(study.numPoints * numberOfChangedDimensions);
+            copyCompactPoints(study, studyPoint, compactValues.data());
+
+            source          = compactValues.data();
+            sourceStride    = numberOfChangedDimensions;
+
+            // The dropped points keep their timepoints, the pathlines end at the last point of the float matrix.
+            auto metadata = readPathlineMetadata(study);
+
+            if (stored.firstStudyPoint == 0) {
+                load.metadata = std::move(metadata);
+            }
+            else {
+                load.metadata.lastTimepoints = std::move(metadata.lastTimepoints);
+                load.metadata.pointTimepoints.resize(stored.firstStudyPoint);
+                load.metadata.pointTimepoints.insert(load.metadata.pointTimepoints.end(), metadata.pointTimepoints.begin(), metadata.pointTimepoints.end());
+            }
+        }
+
+        const auto previousRows         = stored.numRows;
+        const auto previousDimensions   = stored.numDimensions;
+
+        switch (load.precision)
+        {
+            case ValuePrecision::Float32:
+            {
+                writeStoredValues(stored.float32Data, previousRows, previousDimensions, numRows, numDimensions, firstRow, firstDimension, source, sourceStride, [](float value, std::size_t) {
+                    return value;
+                });
+
+                load.float32Data = stored.float32Data;
+                break;
+            }
+
+            case ValuePrecision::BFloat16:
+            {
+                writeStoredValues(stored.bfloat16Data, previousRows, previousDimensions, numRows, numDimensions, firstRow, firstDimension, source, sourceStride, [](float value, std::size_t) {
+                    const auto bits = toBFloat16(value);
+
+                    biovault::bfloat16_t storedValue;
+                    std::memcpy(&storedValue, &bits, sizeof(bits));
+
+                    return storedValue;
+                });
+
+                load.bfloat16Data = stored.bfloat16Data;
+                break;
+            }
+
+            case ValuePrecision::ScaledInt16:
+            {
+                // Dimensions that are written in every row take the range of their new values, dimensions that gain
+                // rows widen their range.
+                if (firstRow == 0) {
+                    stored.ranges.minima.resize(firstDimension);
+                    stored.ranges.maxima.resize(firstDimension);
+                    stored.ranges.integral.resize(firstDimension);
+                }
+
+                mergeDimensionRanges(stored.ranges, firstDimension, computeDimensionRanges(source, numberOfChangedRows, numberOfChangedDimensions, sourceStride));
+
+                const auto previousScaling = std::move(load.scaling);
+
+                load.scaling = computeInt16Scaling(stored.ranges);
+
+                std::vector<float> inverseScales(numDimensions);
+
+                for (std::size_t dimension = 0; dimension < numDimensions; dimension++)
+                    inverseScales[dimension] = 1.0f / load.scaling.scales[dimension];
+
+                writeStoredValues(stored.int16Data, previousRows, previousDimensions, numRows, numDimensions, firstRow, firstDimension, source, sourceStride, [&load, &inverseScales](float value, std::size_t dimension) {
+                    return toScaledInt16(value, load.scaling.offsets[dimension], inverseScales[dimension]);
+                });
+
+                // Only volume studies gain rows, their stored layout is the loaded layout and they keep all float rows.
+                std::vector<std::size_t> rescaledDimensions;
+
+                for (std::size_t dimension = firstDimension; dimension < numDimensions && firstRow > 0; dimension++)
+                    if (load.scaling.scales[dimension] != previousScaling.scales[dimension] || load.scaling.offsets[dimension] != previousScaling.offsets[dimension])
+                        rescaledDimensions.push_back(dimension);
+
+                if (!rescaledDimensions.empty()) {
+                    const std::size_t blockSize = 4096;
+
+                    ThreadPool::global().parallelFor((firstRow + blockSize - 1) / blockSize, [&](std::size_t blockIndex) {
+                        const auto endRow = std::min((blockIndex + 1) * blockSize, firstRow);
+
+                        for (auto row = blockIndex * blockSize; row < endRow; row++)
+                            for (const auto dimension : rescaledDimensions)
+                                stored.int16Data[row * numDimensions + dimension] = toScaledInt16(study.data[row * study.numDimensions + dimension], load.scaling.offsets[dimension], inverseScales[dimension]);
+                    });
+                }
+
+                load.int16Data = stored.int16Data;
+                break;
+            }
+        }
+
+        if (!study.voxelIndices.empty()) {
+            stored.voxelIndices.resize(firstRow);
+            stored.voxelIndices.insert(stored.voxelIndices.end(), study.voxelIndices.begin() + studyRow, study.voxelIndices.end());
+        }
+
+        stored.numRows          = numRows;
+        stored.numDimensions    = numDimensions;
+        stored.lineSize         = lineSize;
+
+        if (isCompact)
+            stored.dimensionNames = compactDimensionNames(lineSize);
+        else if (study.isPathlines)
+            stored.dimensionNames = loadedDimensionNames(lineSize);
+        else
+            stored.dimensionNames = study.dimensionNames;
+
+        // Appends continue from the last point of every pathline, rows of volume studies are only read to scale
+        // their integers again.
+        if (study.isPathlines && study.lineSize > 1) {
+            stored.firstStudyPoint = lineSize - 1;
+
+            keepLastPoints(study, 1);
+        }
+        else if (!study.isPathlines && load.precision != ValuePrecision::ScaledInt16) {
+            stored.firstStudyRow = numRows;
+
+            study.data          = StudyMatrix();
+            study.numPoints     = 0;
+            study.voxelIndices  = std::vector<std::uint32_t>();
+        }
+    }
+
+    /**
+     * Serialize the spatial index and the voxel indices of a loaded study for the properties of its dataset.
+     * Runs on the loading thread.
+     * @param load Loaded study
+     */
+    void serializeProperties(BackgroundLoad& load)
+    {
+        auto& study = load.study;
+
+        // A study that keeps its values may have dropped the rows of its float matrix, the stored matrix keeps their voxels.
+        const auto& voxelIndices = load.keepsValues ? load.stored.voxelIndices : study.voxelIndices;
+
+        if (!voxelIndices.empty())
+            load.voxelIndexBytes = QByteArray(reinterpret_cast<const char*>(voxelIndices.data()), static_cast<int>(voxelIndices.size() * sizeof(std::uint32_t)));
+
+        if (!study.pathlineGrid.empty()) {
+            const auto gridBytes = study.pathlineGrid.serialize();
+
+            load.pathlineGridBytes = QByteArray(gridBytes.data(), static_cast<int>(gridBytes.size()));
+
+            // Appends extend the spatial index of a study that keeps its values.
+            if (!load.keepsValues)
+                study.pathlineGrid = PathlineGrid();
+        }
+    }
+
+    /** Converts per dimension values to a property value */
+    QVariantList toVariantList(const std::vector<float>& values)
+    {
+        QVariantList list;
+        list.reserve(static_cast<int>(values.size()));
+
+        for (const auto value : values)
+            list.append(value);
+
+        return list;
+    }
+
+    /**
+     * Fill a points dataset with a loaded study, must be called on the GUI thread.
+     * @param load Loaded study, its data matrix is moved into the dataset
+     * @param points Dataset receiving the study
+     */
+    void fillDataset(BackgroundLoad& load, Dataset<Points>& points)
+    {
+        auto& study = load.study;
+
+        const auto numDimensions = load.keepsValues ? load.stored.numDimensions : study.numDimensions;
+
+        if (study.isPathlines)
+            points->setProperty("lineSize", static_cast<qulonglong>(load.keepsValues ? load.stored.lineSize : study.lineSize));
+
+        // In the compact layout the points of a row carry the timepoint of their position.
+        if (!load.metadata.pointTimepoints.empty())
+            points->setProperty("pointTimepoints", toVariantList(load.metadata.pointTimepoints));
+
+        // Rows of masked volume studies map back to their voxel through its grid index.
+        if (!load.voxelIndexBytes.isEmpty()) {
+            points->setProperty("volumeDimensions", QVariantList({ study.volumeDimensions[0], study.volumeDimensions[1], study.volumeDimensions[2] }));
+            points->setProperty("voxelIndices", std::exchange(load.voxelIndexBytes, QByteArray()));
+        }
+
+        // Region queries visit only the pathlines listed in the cells of the spatial index (see PathlineGrid::deserialize()).
+        if (!load.pathlineGridBytes.isEmpty())
+            points->setProperty("pathlineGrid", std::exchange(load.pathlineGridBytes, QByteArray()));
+
+        // Hand the data matrix over to the points object without copying it. The points object holds its values in
+        // memory, so a matrix that was spilled to a scratch file is read back into memory once. A study that keeps
+        // its values hands over the copy made on the loading thread.
+        switch (load.precision)
+        {
+            case ValuePrecision::Float32:
+                points->setData(load.keepsValues ? std::move(load.float32Data) : study.data.takeValues(), numDimensions);
+                break;
+
+            case ValuePrecision::BFloat16:
+                points->setData(std::move(load.bfloat16Data), numDimensions);
+                break;
+
+            case ValuePrecision::ScaledInt16:
+                points->setData(std::move(load.int16Data), numDimensions);
+
+                // value = valueOffsets[dimension] + valueScales[dimension] * stored value
+                points->setProperty("valueScales", toVariantList(load.scaling.scales));
+                points->setProperty("valueOffsets", toVariantList(load.scaling.offsets));
+                break;
+        }
+
+        // Add dimension names.
+        const auto& dimensionNames = load.keepsValues ? load.stored.dimensionNames : study.dimensionNames;
+
+        std::vector<QString> dimNames;
+        dimNames.reserve(dimensionNames.size());
+
+        for (const auto& dimensionName : dimensionNames)
+            dimNames.push_back(QString::fromStdString(dimensionName));
+
+        points->setDimensionNames(dimNames);
+    }
+
+    /**
+     * Store the per pathline values of a study in the compact layout with its dataset: the groups as a clusters
+     * dataset and the line index and first and last timepoint of every pathline as a derived points dataset. Creates
+     * them on first use and refreshes them afterwards. Must be called on the GUI thread.
+     * @param load Loaded study
+     * @param points Dataset of the study
+     */
+    void publishPathlineMetadata(BackgroundLoad& load, Dataset<Points>& points)
+    {
+        const auto& metadata = load.metadata;
+
+        if (!load.compactLayout || !load.study.isPathlines)
+            return;
+
+        const auto isNew = !load.groupClusters.isValid();
+
+        if (isNew) {
+            load.groupClusters  = mv::data().createDataset<Clusters>("Cluster", "Groups", points);
+            load.pathlineValues = mv::data().createDataset<Points>("Points", "Pathlines", points);
+        }
+
+        // One cluster per group, in ascending group order.
+        std::map<int, std::vector<std::uint32_t>> groupRows;
+
+        for (std::size_t row = 0; row < metadata.groups.size(); row++)
+            groupRows[metadata.groups[row]].push_back(static_cast<std::uint32_t>(row));
+
+        load.groupClusters->getClusters().clear();
+
+        for (auto& [group, rows] : groupRows) {
+            Cluster cluster;
+
+            cluster.setName(QString("Group %1").arg(group));
+            cluster.setColor(QColor::fromHsv((group * 67) % 360, 200, 220));
+            cluster.setIndices(std::move(rows));
+
+            load.groupClusters->addCluster(cluster);
+        }
+
+        std::vector<float> values(3 * metadata.lineIndices.size());
+
+        for (std::size_t row = 0; row < metadata.lineIndices.size(); row++) {
+            values[3 * row]     = metadata.lineIndices[row];
+            values[3 * row + 1] = metadata.firstTimepoints[row];
+            values[3 * row + 2] = metadata.lastTimepoints[row];
+        }
+
+        load.pathlineValues->setData(std::move(values), 3);
+        load.pathlineValues->setDimensionNames({ "index", "first time", "last time" });
+
+        if (isNew) {
+            mv::events().notifyDatasetAdded(load.groupClusters);
+            mv::events().notifyDatasetAdded(load.pathlineValues);
+        }
+
+        mv::events().notifyDatasetDataChanged(load.groupClusters);
+        mv::events().notifyDatasetDataChanged(load.pathlineValues);
+    }
+
+    /**
+     * Create the points dataset of a loaded study and announce it, must be called on the GUI thread.
+     * @param load Loaded study, its data matrix is moved into the dataset
+     * @param datasetName Name of the new dataset
+     * @return The new dataset
+     */
+    Dataset<Points> publishStudy(BackgroundLoad& load, const QString& datasetName)
+    {
+        LoadProfiler::Scope scope(&load.profiler, "publish", 0, load.keepsValues ? load.stored.numRows : load.study.numPoints);
+
+        // Create pointdata to load the dataset into.
+        auto points = mv::data().createDataset<Points>("Points", datasetName);
+
+        fillDataset(load, points);
+
+        // Notify the core system of the new data
+        mv::events().notifyDatasetAdded(points);
+        mv::events().notifyDatasetDataChanged(points);
+
+        publishPathlineMetadata(load, points);
+
+        return points;
+    }
+
+    /** A loaded study whose directory is watched for timepoint files that arrive later */
+    struct DirectoryWatch
+    {
+        std::shared_ptr<VTKStudyLoader>     loader;
+        std::shared_ptr<BackgroundLoad>     load;                   /** Study of the dataset, with its stored matrix, the end of its float matrix and its spatial index */
+        Dataset<Points>                     points;
+        QString                             directory;
+        QSet<QString>                       knownFiles;             /** Files of the directory that were present when loading or have been appended */
+        std::vector<std::string>            groupNames;             /** Group name of every group of the study, see StudyManifest::groupName() */
+        std::vector<int>                    groups;                 /** Selected groups */
+        bool                                isAppending = false;
+        bool                                isPending = false;      /** Whether the directory changed while appending */
+    };
+
+    /** Name patterns of VTK files, plain or compressed */
+    const QStringList studyFilePatterns = { "*.vtk", "*.vtp", "*.vtu", "*.vtk.gz", "*.vtp.gz", "*.vtu.gz", "*.vtk.zst", "*.vtp.zst", "*.vtu.zst" };
+
+    /** Returns the absolute paths of the VTK files of a directory, sorted by name like a file dialog selection */
+    QStringList listStudyFiles(const QString& directory)
+    {
+        QStringList filePaths;
+
+        for (const auto& fileInfo : QDir(directory).entryInfoList(studyFilePatterns, QDir::Files, QDir::Name))
+            filePaths.append(fileInfo.absoluteFilePath());
+
+        return filePaths;
+    }
+
+    /**
+     * Append the files that arrived in the directory of a watched study to its dataset, in the background. The files
+     * are appended once every selected group has received the same number of them. Must be called on the GUI thread.
+     * @param watch Watched study
+     * @param watcher Watcher of the directory, deleted when watching stops
+     */
+    void appendNewFiles(const std::shared_ptr<DirectoryWatch>& watch, QFileSystemWatcher* watcher)
+    {
+        // Watching ends with the dataset.
+        if (!watch->points.isValid()) {
+            watcher->deleteLater();
+            return;
+        }
+
+        if (watch->isAppending) {
+            watch->isPending = true;
+            return;
+        }
+
+        // New files join the group with their name, only those of the selected groups are appended.
+        std::vector<std::vector<std::string>> groupFiles(watch->groups.size());
+
+        for (const auto& filePath : listStudyFiles(watch->directory)) {
+            if (watch->knownFiles.contains(filePath))
+                continue;
+
+            const auto groupName = StudyManifest::groupName(filePath.toStdString());
+
+            for (std::size_t index = 0; index < watch->groups.size(); index++)
+                if (watch->groupNames[watch->groups[index]] == groupName)
+                    groupFiles[index].push_back(filePath.toStdString());
+        }
+
+        // Files wait until every selected group has the same number of them.
+        const auto filesPerGroup = groupFiles.front().size();
+
+        const auto isComplete = std::all_of(groupFiles.begin(), groupFiles.end(), [filesPerGroup](const std::vector<std::string>& files) {
+            return files.size() == filesPerGroup;
+        });
+
+        if (filesPerGroup == 0 || !isComplete)
+            return;
+
+        std::vector<std::string> filePaths;
+
+        for (const auto& files : groupFiles) {
+            for (const auto& filePath : files) {
+                filePaths.push_back(filePath);
+                watch->knownFiles.insert(QString::fromStdString(filePath));
+            }
+        }
+
+        watch->isAppending = true;
+        watch->load->error.clear();
+
+        auto* thread = QThread::create([watch, filePaths]() {
+            try {
+                auto& load = *watch->load;
+
+                const auto previousRows     = load.stored.numRows;
+                const auto previousLineSize = load.stored.lineSize;
+
+                watch->loader->append(load.study, filePaths);
+
+                // Pathlines gain points and the point before them a new difference vector, volumes gain rows.
+                if (load.study.isPathlines)
+                    storeStudy(load, 0, previousLineSize > 0 ? previousLineSize - 1 : 0);
+                else
+                    storeStudy(load, previousRows, 0);
+
+                serializeProperties(load);
+            }
+            catch (const std::exception& exception) {
+                watch->load->error = QString::fromLocal8Bit(exception.what());
+            }
+        });
+
+        QObject::connect(thread, &QThread::finished, thread, [thread, watch, watcher, numberOfFiles = static_cast<int>(filePaths.size())]() {
+            watch->isAppending = false;
+
+            // A failed append leaves the study incomplete, the dataset keeps the timepoints it had.
+            if (!watch->load->error.isEmpty()) {
+                watch->load->study  = LoadedStudy();
+                watch->load->stored = StoredMatrix();
+
+                qWarning().noquote() << QString("Stopped appending to %1: %2").arg(watch->directory, watch->load->error);
+                watcher->deleteLater();
+            }
+            else if (watch->points.isValid()) {
+                fillDataset(*watch->load, watch->points);
+
+                mv::events().notifyDatasetDataChanged(watch->points);
+
+                publishPathlineMetadata(*watch->load, watch->points);
+
+                qInfo().noquote() << QString("Appended %1 files to %2").arg(numberOfFiles).arg(watch->directory);
+
+                if (watch->isPending) {
+                    watch->isPending = false;
+                    appendNewFiles(watch, watcher);
+                }
+            }
+
+            thread->deleteLater();
+        });
+
+        thread->start();
+    }
+
+    /**
+     * Start watching the directory of a loaded study, must be called on the GUI thread.
+     * @param watch Watched study
+     */
+    void watchDirectory(const std::shared_ptr<DirectoryWatch>& watch)
+    {
+        // Not owned by the plugin, watching continues after the import for as long as the dataset exists.
+        auto* watcher = new QFileSystemWatcher(QStringList({ watch->directory }), QCoreApplication::instance());
+        auto* timer = new QTimer(watcher);
+
+        // Files are written over some time, so changes are collected until the directory has been quiet for a while.
+        timer->setSingleShot(true);
+        timer->setInterval(2000);
+
+        QObject::connect(watcher, &QFileSystemWatcher::directoryChanged, timer, [timer]() {
+            timer->start();
+        });
+
+        QObject::connect(timer, &QTimer::timeout, watcher, [watch, watcher]() {
+            appendNewFiles(watch, watcher);
+        });
+    }
+
+    /** Settings of the plugin that apply to every load, read on the GUI thread */
+    struct LoadSettings
+    {
+        std::string     cacheDirectory;                                     /** Directory of the study cache, empty when the cache is disabled */
+        std::uint64_t   cacheSizeLimit = VTKStudyLoader::defaultCacheSizeLimit; /** Bytes the study cache may take, zero if unbounded */
+        std::size_t     memoryLimit = VTKStudyLoader::defaultMemoryLimit;   /** Bytes for reading files, in addition to the loaded study */
+        std::size_t     memoryBudget = 0;                                   /** Bytes for the whole import, zero if unbounded */
+        std::string     scratchDirectory;                                   /** Directory of the scratch file of a matrix beyond the budget */
+        bool            derivedSpeed = false;                               /** Whether the speed is the distance travelled per point */
+        QString         reportFilePath;                                     /** JSON report of the stage timings, none when empty */
+    };
+
+    LoadSettings readLoadSettings(const VTKLoaderPlugin& plugin)
+    {
+        LoadSettings settings;
+
+        // Repeated imports of an unchanged study are served from the study cache.
+        if (plugin.getSetting("Cache/Enabled", true).toBool()) {
+            const auto defaultCacheDirectory = QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("VTKLoader");
+            settings.cacheDirectory = plugin.getSetting("Cache/Directory", defaultCacheDirectory).toString().toStdString();
+
+            // The least recently used studies are evicted beyond the size limit.
+            settings.cacheSizeLimit = static_cast<std::uint64_t>(plugin.getSetting("Cache/SizeLimitMB", qulonglong(VTKStudyLoader::defaultCacheSizeLimit >> 20)).toULongLong()) << 20;
+        }
+
+        // Bounds the memory used for reading files, in addition to the loaded study itself.
+        settings.memoryLimit = static_cast<std::size_t>(plugin.getSetting("Loading/MemoryLimitMB", qulonglong(VTKStudyLoader::defaultMemoryLimit >> 20)).toULongLong()) << 20;
+
+        // Matrices beyond the memory budget move to a scratch file instead of growing the resident memory.
+        settings.memoryBudget       = static_cast<std::size_t>(plugin.getSetting("Loading/MemoryBudgetMB", qulonglong(0)).toULongLong()) << 20;
+        settings.scratchDirectory   = plugin.getSetting("Loading/ScratchDirectory", QString()).toString().toStdString();
+
+        // Optionally the speed is the distance travelled per point rather than the speed stored in the files.
+        settings.derivedSpeed = plugin.getSetting("Loading/DerivedSpeed", false).toBool();
+
+        // The stage timings always go to the log, a JSON report is written when a report file is set.
+        settings.reportFilePath = plugin.getSetting("Profiling/ReportFile", QString()).toString();
+
+        return settings;
+    }
+
+    /**
+     * Create the loader of a study and the state it shares with the GUI thread.
+     * @param filePaths UTF-8 encoded paths of the files of the study
+     * @param options Part of the study to load and how to store it
+     * @param settings Settings of the plugin
+     * @param result Receives the state of the load
+     * @return Loader, its profiler is that of the result
+     */
+    std::shared_ptr<VTKStudyLoader> createLoader(const std::vector<std::string>& filePaths, const VTKImportOptions& options, const LoadSettings& settings, std::shared_ptr<BackgroundLoad>& result)
+    {
+        auto loader = std::make_shared<VTKStudyLoader>(filePaths);
+
+        loader->setSelection(options.selection);
+        loader->setCacheDirectory(settings.cacheDirectory, settings.cacheSizeLimit);
+        loader->setMemoryLimit(settings.memoryLimit);
+        loader->setMemoryBudget(settings.memoryBudget, settings.scratchDirectory);
+        loader->setDerivedSpeed(settings.derivedSpeed);
+
+        // Problems that do not stop the load, such as a cache that could not be written, go to the log.
+        loader->setWarningCallback([](const std::string& message) {
+            qWarning().noquote() << QString::fromStdString(message);
+        });
+
+        // Pathlines may be resampled to a fixed number of points, trading fidelity for dimensions.
+        loader->setResampledLineSize(options.resampledLineSize);
+
+        result = std::make_shared<BackgroundLoad>();
+
+        // The compact layout keeps one timepoint per point position, resampled pathlines do not share them.
+        if (options.compactLayout && options.resampledLineSize > 0)
+            qWarning() << "Resampled pathlines are stored in the full layout, their points have different timepoints in every pathline";
+
+        result->precision       = options.precision;
+        result->compactLayout   = options.compactLayout && options.resampledLineSize == 0;
+
+        loader->setProfiler(&result->profiler);
+
+        return loader;
+    }
+
+    /**
+     * Create the thread that loads a study into its result, it is not started yet.
+     * @param loader Loader of the study
+     * @param result Receives the study, or the error or cancellation
+     * @return Thread, to be deleted once finished
+     */
+    QThread* createLoadThread(const std::shared_ptr<VTKStudyLoader>& loader, const std::shared_ptr<BackgroundLoad>& result)
+    {
+        return QThread::create([loader, result]() {
+            try {
+                result->study = loader->load();
+
+                // A watched study keeps its stored matrix for the appends, its dataset receives a copy.
+                if (result->keepsValues) {
+                    storeStudy(*result, 0, 0);
+                }
+                else {
+                    compactStudy(*result);
+                    reducePrecision(*result);
+                }
+
+                serializeProperties(*result);
+            }
+            catch (const LoadCancelled&) {
+                result->cancelled = true;
+            }
+            catch (const std::exception& exception) {
+                result->error = QString::fromLocal8Bit(exception.what());
+            }
+        });
+    }
+
+    /**
+     * Write the stage timings of a completed load to the log and, when set, to the report file.
+     * @param load Completed load
+     * @param datasetName Name of the dataset of the study
+     * @param reportFilePath JSON report of the stage timings, none when empty
+     */
+    void reportLoad(const BackgroundLoad& load, const QString& datasetName, const QString& reportFilePath)
+    {
+        qInfo().noquote() << QString("Loaded %1\n%2").arg(datasetName, QString::fromStdString(load.profiler.summary()));
+
+        if (!reportFilePath.isEmpty() && !load.profiler.writeJson(reportFilePath.toStdString(), datasetName.toStdString()))
+            qWarning() << "Unable to write the load report" << reportFilePath;
+    }
+
+    /** Studies of a batch import, shared by the loads of the batch */
+    struct ImportBatch
+    {
+        QPointer<VTKLoaderPlugin>       plugin;                 /** Receives the signals, the batch completes without it */
+        std::deque<VTKStudyImport>      pending;                /** Studies that have not started loading */
+        VTKImportOptions                options;
+        LoadSettings                    settings;
+        int                             numberOfStudies = 0;
+        int                             numberOfRunning = 0;
+        int                             numberOfFailures = 0;
+        std::vector<std::string>        reports;                /** JSON reports of the imported studies, written together once the batch is done */
+        LoadProfiler::Clock::time_point start;
+    };
+
+    /**
+     * Start loading the next pending study of a batch, or report the batch once all of its studies are done.
+     * Must be called on the GUI thread.
+     * @param batch Batch import
+     */
+    void startNextImport(const std::shared_ptr<ImportBatch>& batch)
+    {
+        if (batch->pending.empty()) {
+            if (batch->numberOfRunning > 0)
+                return;
+
+            const auto seconds = std::chrono::duration<double>(LoadProfiler::Clock::now() - batch->start).count();
+
+            qInfo().noquote() << QString("Imported %1 of %2 studies in %3 s").arg(batch->numberOfStudies - batch->numberOfFailures).arg(batch->numberOfStudies).arg(seconds, 0, 'f', 3);
+
+            // The studies of a batch share the report file.
+            if (!batch->settings.reportFilePath.isEmpty() && !LoadProfiler::writeJsonArray(batch->settings.reportFilePath.toStdString(), batch->reports))
+                qWarning() << "Unable to write the load report" << batch->settings.reportFilePath;
+
+            if (batch->plugin)
+                emit batch->plugin->studiesImported(batch->numberOfStudies, batch->numberOfFailures);
+
+            return;
+        }
+
+        const auto study = std::move(batch->pending.front());
+
+        batch->pending.pop_front();
+
+        std::vector<std::string> filePaths;
+
+        for (const auto& filePath : study.filePaths)
+            filePaths.push_back(filePath.toStdString());
+
+        auto datasetName = study.name;
+
+        if (datasetName.isEmpty() && !study.filePaths.isEmpty())
+            datasetName = QFileInfo(study.filePaths.front()).absoluteDir().dirName();
+
+        std::shared_ptr<BackgroundLoad> result;
+
+        const auto loader = createLoader(filePaths, batch->options, batch->settings, result);
+
+        auto* thread = createLoadThread(loader, result);
+
+        // Runs on the GUI thread, the next study starts as soon as one is done.
+        QObject::connect(thread, &QThread::finished, thread, [thread, batch, result, datasetName]() {
+            batch->numberOfRunning--;
+
+            if (!result->error.isEmpty()) {
+                batch->numberOfFailures++;
+
+                qWarning().noquote() << QString("Unable to import %1: %2").arg(datasetName, result->error);
+            }
+            else {
+                publishStudy(*result, datasetName);
+                reportLoad(*result, datasetName, QString());
+
+                batch->reports.push_back(result->profiler.toJson(datasetName.toStdString()));
+            }
+
+            if (batch->plugin)
+                emit batch->plugin->studyImported(datasetName, result->error);
+
+            thread->deleteLater();
+
+            startNextImport(batch);
+        });
+
+        batch->numberOfRunning++;
+
+        thread->start();
+    }
+}
+
 // =============================================================================
 // VTK loader plugin, created in order to fascilitate the loading in of 4D flow pathline data.
 // Written by: Mitchell Martijn de Boer
@@ -53,8 +954,9 @@ void VTKLoaderPlugin::init()
 
 /**
  * Funtion the loads in the data and transforms it from its file type to pointsdata.
- * It also fills in missing data in the input volume with values 1 smaller than the smallest value in the dimension
- * (needed for visualization).
+ * Volume studies can be masked, in which case only the voxels inside the mask get a point and the grid index of the
+ * voxel of every point is stored alongside. Optionally the directory of the study is watched afterwards, and timepoint
+ * files that arrive in it are appended to the dataset.
  */
 void VTKLoaderPlugin::loadData()
 {
@@ -64,18 +966,20 @@ void VTKLoaderPlugin::loadData()
     // Read selected files from file selector.
     QFileDialog fileDialog;
     fileDialog.setFileMode(QFileDialog::ExistingFiles);
-    QStringList filePath = fileDialog.getOpenFileNames(nullptr, "Open a .vtk file", workingDirectory); // Open the file selector
+    QStringList filePath = fileDialog.getOpenFileNames(nullptr, "Open VTK files", workingDirectory, QString("VTK files (%1);;All files (*)").arg(studyFilePatterns.join(' '))); // Open the file selector
 
+    if (filePath.isEmpty())
+        return;
 
     if (QFileInfo(filePath[0]).exists())
         setSetting("Data/WorkingDirectory", QFileInfo(filePath[0]).absoluteDir().absolutePath());
 
     std::vector<int> incorrectIndex;
 
-    // Check if filetype == .vtk
+    // Check if filetype is legacy (.vtk) or XML (.vtp, .vtu) VTK, possibly gzip or zstd compressed
     for (int i = 0; i < filePath.length(); i++) {
-        int found = filePath[i].toStdString().find(".vtk");
-        if (found == -1) {
+        const auto suffix = QFileInfo(QString::fromStdString(withoutCompressionExtension(filePath[i].toStdString()))).suffix().toLower();
+        if (suffix != "vtk" && suffix != "vtp" && suffix != "vtu") {
             incorrectIndex.push_back(i);
         }
     }
@@ -83,7 +987,7 @@ void VTKLoaderPlugin::loadData()
     // If the type is wrong, throw error, else start data loading.
     if (incorrectIndex.size() != 0) {
         QMessageBox messageBox;
-        messageBox.critical(0, "Error", "File(s) is/are not of type(s) .vtk"); // Throws error if file format is wrong
+        messageBox.critical(0, "Error", "File(s) is/are not of type(s) .vtk, .vtp or .vtu, optionally compressed as .gz or .zst"); // Throws error if file format is wrong
         messageBox.setFixedSize(500, 200);
 
     }
@@ -91,470 +995,196 @@ void VTKLoaderPlugin::loadData()
         // Convert string of file names, to individual correct file names.
         std::string base_filename = filePath[0].toStdString().substr(0,filePath[0].toStdString().find_last_of("/\\"));
         std::string fileName = base_filename.substr(base_filename.find_last_of("/\\") + 1);
-        
-        // Create empty pointdata to load the dataset into.
-        auto points = mv::data().createDataset<Points>("Points", QString::fromStdString(fileName));
-        int timePoints = filePath.length();
-        int numPoints;
-        int xSize, ySize, zSize;
-        int numDimensions = 8;
-
-        // Creates a 1D vector used to read the completed dataset into the mv points datatype.
-        std::vector<float> dataSet;
-        std::vector<std::vector<std::array<float, 7 >>> flowLines;
-        std::vector<std::vector<std::array<float, 7 >>> flowLinesPrefix;
-        std::vector<float> pathlines;
-        int newTest = 0;
-        std::string type;
-        int flowLineSize = 0;
-        std::string myString;
-        std::string dimensions;
-        int xCor, yCor, zCor;
-        bool prefixVectorEngaged = false;
-
-        // Calculates the number of seperate datagroups, this is done specifically for the 4D flow dataset that was used in the thesis 
-        // "Stochastic Neighbor Embedding for interactive visualization of flow patterns in 4D flow MRI" by Mitchell de Boer. This is
-        // because of the fact that this dataset consisted of path lines subdivided into flow components with each having 30 timepoints.
-        // Meaning that this calculates the amount of flow components added based on the amount of imported files.
-        int groupSize = filePath.size() / 30;
-        
-        
-        int countLines = -1;
-        int cumulativeLines = 0;
-        int cumulativeLinesSaved = 0;
 
-        // Notify the core system of the new data
-        mv::events().notifyDatasetAdded(points);
-        
-        std::vector<std::array<float, 3>> previousLocationVector;
-        int resetPoint;
-
-        // Loop over all timepoints.
-        for (int t = 0; t < 30; t++) {
-            int i = 0;   
-            // Open the current file.
-            std::ifstream file(filePath[t].toStdString());       
-
-            // Record metadata. (might be no longer necessary because this is done later as well)
-            while (getline(file, myString)) {
-                if (i == 4) {
-                    dimensions = myString;
-                }
-                if (i == 5) {
-                    break;
-                }
-                i++;
-            }
-            if (!dimensions.empty()) {
-                std::vector<std::string> seperatedLine = VTKLoaderPlugin::cutString(myString);
-                numPoints = std::stoi(seperatedLine[1]);
-                seperatedLine = VTKLoaderPlugin::cutString(dimensions);
-                xSize = std::stoi(seperatedLine[1]);
-                ySize = std::stoi(seperatedLine[2]);
-                zSize = std::stoi(seperatedLine[3]);
-            }
-            // Initializes vectors for data recording.
-            std::array<float, 3> pointLocation = { 0,0,0 };
-            std::vector<std::array<float, 3>> pointLocationsVectorTemp;
-
-            // Reads in the location of points. (might be no longer necessary because this is done later as well)
-            std::vector<std::string> seperatedLine;
-            while (getline(file, myString)) {
-                if (myString.empty()) {
-                    break;
-                }
-                else if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                    break;
-                }
-                else {
-                    seperatedLine = VTKLoaderPlugin::cutString(myString);
-                    pointLocation[0] = std::stof(seperatedLine[0]);
-                    pointLocation[1] = std::stof(seperatedLine[1]);
-                    pointLocation[2] = std::stof(seperatedLine[2]);
-                    pointLocationsVectorTemp.push_back(pointLocation);
-                }
-            }
-            file.close();
-
-            
-            
-            // Because files were not fully ordered from start to finish, this loop records the point at which vectors no longer line up with the previous file. 
-            // The files after are then put in front of this first group of time points.
-            if (t != 0) {
-                if (pointLocationsVectorTemp[0][0] != previousLocationVector[5][0] && pointLocationsVectorTemp[0][1] != previousLocationVector[5][1] && pointLocationsVectorTemp[0][2] != previousLocationVector[5][2])
-                {
-                    std::cout << "reset found at t =" << t << std::endl;
-                    resetPoint = t;
-                }
-            }
-            previousLocationVector = pointLocationsVectorTemp;
-        }
-    
+        std::vector<std::string> filePaths;
+        for (const auto& path : filePath)
+            filePaths.push_back(path.toStdString());
 
+        // Let the user pick the part of the study to import, the pathline stride and sample size are remembered.
+        LoadSelection selection;
 
-        // Loops over all flow components.
-        for (int group = 0; group < groupSize; group++) {
-           
-            // Loop over all timepoints
-            for (int t = 0; t < 30; t++) {
+        selection.lineStride = getSetting("Selection/LineStride", 1).toULongLong();
+        selection.sampleSize = getSetting("Selection/SampleSize", 0).toULongLong();
+        selection.minimumSpeed = getSetting("Selection/MinimumSpeed", 0.0).toFloat();
+        selection.maskFilePath = getSetting("Selection/MaskFile", QString()).toString().toStdString();
 
+        const auto initialPrecision = static_cast<ValuePrecision>(std::clamp(getSetting("Loading/Precision", 0).toInt(), 0, 2));
 
-                // Initialize indexing parameters
-                int i = 0;
-                int q = 0;
+        // The first file tells pathline studies from volume studies, only its header is read.
+        bool isPathlineStudy = true;
 
-                //Adjust the timpoint counter in order to load in data in the propper order
-                if (t + resetPoint >= 30) {
-                    q = t + resetPoint - 30 + group * 30;
-                }
-                else {
-                    q = t + resetPoint + group * 30;
-                }
+        try {
+            isPathlineStudy = VTKStudyLoader::readNumberOfLines(filePaths.front()) > 0;
+        }
+        catch (const std::exception&) {
+            // Unreadable files are reported by the load itself.
+        }
 
-                // Open current timepoint file.
-                std::ifstream file(filePath[q].toStdString());
-                
-                // Record metadata.
-                while (getline(file, myString)) {
-                    if (i == 4) {
-                        dimensions = myString;
-                    }
-                    if (i == 5) {
-                        break;
-                    }
-                    i++;
-                }
-                if (!dimensions.empty()) {
-                    std::vector<std::string> seperatedLine = VTKLoaderPlugin::cutString(myString);
-                    numPoints = std::stoi(seperatedLine[1]);
-                    seperatedLine = VTKLoaderPlugin::cutString(dimensions);
-                    xSize = std::stoi(seperatedLine[1]);
-                    ySize = std::stoi(seperatedLine[2]);
-                    zSize = std::stoi(seperatedLine[3]);
-                }
+        // The file names tell the groups, the headers of all files are checked by the load itself.
+        const auto timepointsPerGroup   = StudyManifest::groupSize(filePaths);
+        const auto numberOfGroups       = static_cast<int>(filePaths.size()) / timepointsPerGroup;
 
-                std::array<float, 3> pointLocation = { 0,0,0 };
-                std::vector<std::array<float, 3>> pointLocationsVector;
-
-                // Read point locataions. (mainly done in order to get to the end of the file)
-                std::vector<std::string> seperatedLine;
-                while (getline(file, myString)) {
-                    if (myString.empty()) {
-                        break;
-                    }
-                    else if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                        break;
-                    }
-                    else {
-                        seperatedLine = VTKLoaderPlugin::cutString(myString);
-                        pointLocation[0] = std::stof(seperatedLine[0]);
-                        pointLocation[1] = std::stof(seperatedLine[1]);
-                        pointLocation[2] = std::stof(seperatedLine[2]);
-                        pointLocationsVector.push_back(pointLocation);
-                    }
-                }
-                 
-                numPoints = pointLocationsVector.size();           
-
-                // Record what type of data is loaded in.
-                getline(file, myString);
-                seperatedLine = VTKLoaderPlugin::cutString(myString);
-                type = seperatedLine[0];
-
-                // "scalars" is old depricated code for when i was working with vectorfields instead of pathlines. 
-                // This used to be a function that checked whether scalar points were loaded or pathlines.
-                if (type == "SCALARS") {
-                    getline(file, myString);
-                    std::vector<float> velocityMagnitude;
-                    while (getline(file, myString)) {
-                        if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                            break;
-                        }
-                        velocityMagnitude.push_back(std::stof(myString));
-                    }
-                    std::array<float, 3> velocityVector = { 0,0,0 };
-                    std::vector<std::array<float, 3>> velocityVectorVector;
-
-                    while (getline(file, myString)) {
-
-                        if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-
-                            break;
-                        }
-
-                        seperatedLine = VTKLoaderPlugin::cutString(myString);
-                        velocityVector[0] = std::stof(seperatedLine[0]);
-                        velocityVector[1] = std::stof(seperatedLine[1]);
-                        velocityVector[2] = std::stof(seperatedLine[2]);
-                        velocityVectorVector.push_back(velocityVector);
-                    }
-                    velocityVector.~array();
-                    file.close();
-
-                    int iterator = 0;
-                    for (int z = 0; z < zSize; z++) {
-                        for (int y = 0; y < ySize; y++) {
-                            for (int x = 0; x < xSize; x++) {
-                                for (int dim = 0; dim < numDimensions; dim++) {
-                                    if (dim < 3) {
-                                        dataSet.push_back(pointLocationsVector[iterator / numDimensions][dim]);
-                                    }
-                                    else if (dim == 3) {
-                                        dataSet.push_back(velocityMagnitude[iterator / numDimensions]);
-                                    }
-                                    else if (dim == 7) {
-                                        dataSet.push_back(t);
-                                    }
-                                    else {
-                                        dataSet.push_back(velocityVectorVector[iterator / numDimensions][dim - 4]);
-                                    }
-                                    iterator++;
-                                }
-                            }
-                        }
-                    }
-                    pointLocationsVector.~vector();
-                }
-                else if (type == "LINES") {
-                    numDimensions = 3;
-                    std::vector<std::vector<int>> lineIndexSize;
-
-                    // Records the size of pathlines, in order to make them all have the same amount of datapoints at the end.
-                    std::vector<int> tempLineIndex;
-                    while (getline(file, myString)) {
-                        if (myString.empty()) {
-                            break;
-                        }
-                        auto seperatedVector = VTKLoaderPlugin::cutString(myString);
-                        for (int k = 0; k < seperatedVector.size(); k++)
-                        {
-                            tempLineIndex.push_back(std::stoi(seperatedVector[k]));
-                        }
-                        lineIndexSize.push_back(tempLineIndex);
-                        tempLineIndex.clear();
-                    }
-                    // Skip irrelevent metadata.
-                    getline(file, myString);
-                    getline(file, myString);
-                    getline(file, myString);
-
-                    // Records the indices of pathlines, is later used in order to allign the same pathline for over multiple timepoints.
-                    std::vector<float> lineIndex;
-                    while (getline(file, myString)) {
-                        if (myString.empty()) {
-                            break;
-                        }
-                        else if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                            break;
-                        }
-                        lineIndex.push_back(std::stof(myString));
-                    }
-                    getline(file, myString);
-
-                    // Record the velocity magnitude for points along pathlines.
-                    std::vector<float> speed;
-                    while (getline(file, myString)) {
-                        if (myString.empty()) {
-                            break;
-                        }
-                        else if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                            break;
-                        }
-                        speed.push_back(std::stof(myString));
-                    }
-
-
-                    getline(file, myString);
-                    std::vector<int> ID;
-                    while (getline(file, myString)) {
-                        if (myString.empty()) {
-                            break;
-                        }
-                        else if (!isNumber(VTKLoaderPlugin::cutString(myString)[0])) {
-                            break;
-                        }
-                        ID.push_back(std::stoi(myString));
-                    }
-                    file.close();
-                    ID.~vector();
-                    int iterator = 0;
-                    std::vector<std::array<float, 7>> tempFlowLine;
-
-
-                    // Count the number of pathlines read in up to this points.
-                    countLines = -1;
-                    if (group == 0)
-                    {
-                        cumulativeLines = countLines;
-                    }
-                    else if (t == 0) {
-                        cumulativeLines = flowLines.size() - 1;
-                        cumulativeLinesSaved = cumulativeLines;
-                    }
-                    else {
-                        cumulativeLines = cumulativeLinesSaved;
-                    }
-
-                    float previousIndex = -1;
-                    int test = 0;
-                    auto temp = lineIndex;
-
-                    int l = 0;
-
-                    // Loop actually reading in pathline data.
-                    for (int i = 0; i < pointLocationsVector.size(); i++) {
-                        // Checks if we have landed on a new pathine segment.
-                        if (test == 0)
-                        {
-                            l = 0;
-                            test = 1;
-                            countLines++;
-                            cumulativeLines++;
-                            previousIndex = lineIndex[i];
-                            
-                            tempFlowLine.clear();
-
-                        }
-                        // Record current points in pathline.
-                        tempFlowLine.push_back({ pointLocationsVector[i][0], pointLocationsVector[i][1], pointLocationsVector[i][2], speed[i], lineIndex[i], float(t), float(group) });                        
-                        l++;
-
-                        // Checks if the end of this line segment has been reached, if so record the temporary vector into a permanent one containing already recorded pathline segments.
-                        if (l == lineIndexSize[countLines][0])
-                        {
-                            test = 0;                            
-                            if (t == 0) {
-                                flowLines.push_back(tempFlowLine);
-                                tempFlowLine.clear();                               
-                            }
-                            else {
-                                int copy = 0;
-                                for (int j = 3; j < l; j++)
-                                {
-                                    flowLines[cumulativeLines].push_back(tempFlowLine[j]);
-                                    copy = j;
-                                }
-                                if (l != 8) {
-                                    for (int j = 0; j < 8 - l; j++)
-                                    {
-                                        flowLines[cumulativeLines].push_back(tempFlowLine[copy]);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    
-                }
+        LoadSelectionDialog selectionDialog(numberOfGroups, timepointsPerGroup, isPathlineStudy, selection, initialPrecision, getSetting("Loading/ResampledLineSize", 0).toULongLong(), getSetting("Loading/CompactLayout", false).toBool(), getSetting("Loading/WatchDirectory", false).toBool());
 
-            }
-        }
-        // After all data has been loaded in, convert it into the created points dataset, I think the pathlines vector could be removed, but im not 100% about that.
-        int q = 0;
-        for (int i = 0; i < flowLines.size(); i++) {
-            for (int j = 0; j < flowLines[i].size(); j++) {
-
-                pathlines.push_back(flowLines[i][j][0]);
-                pathlines.push_back(flowLines[i][j][1]);
-                pathlines.push_back(flowLines[i][j][2]);
-                pathlines.push_back(flowLines[i][j][3]);
-                pathlines.push_back(flowLines[i][j][5]);
-
-                dataSet.push_back(flowLines[i][j][0]);
-                dataSet.push_back(flowLines[i][j][1]);
-                dataSet.push_back(flowLines[i][j][2]);
-
-                dataSet.push_back(flowLines[i][j][3]);
-                dataSet.push_back(flowLines[i][j][4]);
-                dataSet.push_back(flowLines[i][j][5]);
-                dataSet.push_back(flowLines[i][j][6]);
-
-                // Calculate the vectors at timepoints.
-                if (j == flowLines[i].size() - 1) {
-                    dataSet.push_back(flowLines[i][j][0] - flowLines[i][j - 1][0]);
-                    dataSet.push_back(flowLines[i][j][1] - flowLines[i][j - 1][1]);
-                    dataSet.push_back(flowLines[i][j][2] - flowLines[i][j - 1][2]);
-                }
-                else {
-                    dataSet.push_back(flowLines[i][j + 1][0] - flowLines[i][j][0]);
-                    dataSet.push_back(flowLines[i][j + 1][1] - flowLines[i][j][1]);
-                    dataSet.push_back(flowLines[i][j + 1][2] - flowLines[i][j][2]);
-                }
-                
-                
-            }
-        }
+        if (selectionDialog.exec() != QDialog::Accepted)
+            return;
+
+        selection = selectionDialog.selection();
 
-        
-        points->setProperty("lineSize", flowLines[0].size());
+        setSetting("Selection/LineStride", qulonglong(selection.lineStride));
+        setSetting("Selection/SampleSize", qulonglong(selection.sampleSize));
+        setSetting("Selection/MinimumSpeed", selection.minimumSpeed);
+        setSetting("Selection/MaskFile", QString::fromStdString(selection.maskFilePath));
+        setSetting("Loading/Precision", static_cast<int>(selectionDialog.precision()));
+        setSetting("Loading/WatchDirectory", selectionDialog.watchDirectory());
 
-        // Put dataset into the points object.
-        if (type == "LINES") {
-            points->setData(dataSet.data(), flowLines.size(), flowLines[0].size() * 10);
+        if (isPathlineStudy) {
+            setSetting("Loading/ResampledLineSize", qulonglong(selectionDialog.resampledLineSize()));
+            setSetting("Loading/CompactLayout", selectionDialog.compactLayout());
         }
-        else {
-            points->setData(dataSet.data(), numPoints * timePoints, numDimensions);
+
+        // Read, order and stitch the selected files in the background. The dataset is only created once the study is complete.
+        VTKImportOptions options;
+
+        options.selection           = selection;
+        options.precision           = selectionDialog.precision();
+        options.resampledLineSize   = selectionDialog.resampledLineSize();
+        options.compactLayout       = selectionDialog.compactLayout();
+
+        const auto settings = readLoadSettings(*this);
+
+        std::shared_ptr<BackgroundLoad> result;
+
+        auto loader = createLoader(filePaths, options, settings, result);
+
+        // Files that are already in the directory when loading starts are never appended. Resampled pathlines no
+        // longer have the points that new timepoints continue from.
+        std::shared_ptr<DirectoryWatch> watch;
+
+        if (selectionDialog.watchDirectory() && selectionDialog.resampledLineSize() > 0)
+            qWarning() << "Resampled pathlines are not extended with timepoints that arrive later";
+
+        // New files are told to a group by their name, which has to differ between the groups.
+        std::vector<std::string> groupNames;
+
+        for (int group = 0; group < numberOfGroups; group++)
+            groupNames.push_back(StudyManifest::groupName(QFileInfo(filePath[group * timepointsPerGroup]).absoluteFilePath().toStdString()));
+
+        const auto hasDistinctGroupNames = std::set<std::string>(groupNames.begin(), groupNames.end()).size() == groupNames.size();
+
+        if (selectionDialog.watchDirectory() && !hasDistinctGroupNames)
+            qWarning() << "The file names do not tell the groups apart, the directory is not watched";
+
+        if (selectionDialog.watchDirectory() && selectionDialog.resampledLineSize() == 0 && hasDistinctGroupNames) {
+            watch = std::make_shared<DirectoryWatch>();
+
+            result->keepsValues = true;
+
+            watch->loader       = loader;
+            watch->load         = result;
+            watch->directory    = QFileInfo(filePath[0]).absolutePath();
+            watch->groupNames   = groupNames;
+            watch->groups       = selection.groups;
+
+            if (watch->groups.empty())
+                for (int group = 0; group < numberOfGroups; group++)
+                    watch->groups.push_back(group);
+
+            for (const auto& knownFile : listStudyFiles(watch->directory))
+                watch->knownFiles.insert(knownFile);
+
+            for (const auto& path : filePath)
+                watch->knownFiles.insert(QFileInfo(path).absoluteFilePath());
         }
 
-        // Add dimension names.
-        std::vector<QString> dimNames;
-        int alterator = 0;
-        for (int i = 0; i < flowLines[0].size() * 10; i++)
-        {
-            if (alterator == 10) {
-                alterator = 0;
-            }
-            if (alterator == 0) {
-                QString string = QString("x") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 1) {
-                QString string = QString("y") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 2) {
-                QString string = QString("z") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 3) {
-                QString string = QString("speed") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 4) {
-                QString string = QString("index") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 5) {
-                QString string = QString("time") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }
-            else if (alterator == 6) {
-                QString string = QString("group") + QString::number(i / 10);
-                dimNames.push_back(string);
-            }else if (alterator == 7) {
-                QString string = QString("x'") + QString::number(i / 10);
-                dimNames.push_back(string);
+        auto* task = new ForegroundTask(nullptr, QString("Load %1").arg(QString::fromStdString(fileName)), Task::Status::Idle, true);
+
+        loader->setProgressCallback([task, result](const LoadProgress& progress) {
+            result->phaseProgress[static_cast<std::size_t>(progress.phase)] = progress.total > 0 ? float(progress.completed) / progress.total : 1.0f;
+
+            const auto overallProgress = result->overallProgress();
+            const auto description = QString("%1 %2").arg(phaseName(progress.phase), QFileInfo(QString::fromStdString(progress.filePath)).fileName()).trimmed();
+
+            // The task lives on the GUI thread, progress arrives from the loading threads.
+            QMetaObject::invokeMethod(task, [task, overallProgress, description]() {
+                task->setProgress(overallProgress);
+                task->setProgressDescription(description);
+            }, Qt::QueuedConnection);
+        });
+
+        auto* thread = createLoadThread(loader, result);
+
+        QObject::connect(task, &Task::requestAbort, thread, [loader]() {
+            loader->cancel();
+        });
+
+        // Runs on the GUI thread once loading has finished, failed or was cancelled.
+        QObject::connect(thread, &QThread::finished, thread, [thread, task, loader, result, watch, fileName, reportFilePath = settings.reportFilePath]() {
+            if (result->cancelled) {
+                task->setAborted();
             }
-            else if (alterator == 8) {
-                QString string = QString("y'") + QString::number(i / 10);
-                dimNames.push_back(string);
+            else if (!result->error.isEmpty()) {
+                task->setFinished();
+                QMessageBox::critical(nullptr, "Error", QString("Unable to load the VTK files: %1").arg(result->error));
             }
             else {
-                QString string = QString("z'") + QString::number(i / 10);
-                dimNames.push_back(string);
+                task->setProgressDescription("Publishing the dataset");
+                const auto points = publishStudy(*result, QString::fromStdString(fileName));
+                task->setFinished();
+
+                reportLoad(*result, QString::fromStdString(fileName), reportFilePath);
+
+                // The task that received the progress of the load is gone, appends run without progress.
+                if (watch) {
+                    loader->setProgressCallback(VTKStudyLoader::ProgressCallback());
+
+                    watch->points = points;
+
+                    watchDirectory(watch);
+                }
             }
 
+            task->deleteLater();
+            thread->deleteLater();
+        });
 
-            alterator++;
+        task->setRunning();
+        thread->start();
+    }
+}
 
-        }
+/**
+ * Imports studies without dialogs or message boxes, failures are logged and reported by the signals. The number of
+ * studies that load at once is bounded, the loads share the global thread pool for their files, so the throughput
+ * grows with the number of cores while memory is bounded by the studies in flight.
+ */
+void VTKLoaderPlugin::importStudies(const std::vector<VTKStudyImport>& studies, const VTKImportOptions& options, std::size_t maximumConcurrentStudies)
+{
+    auto batch = std::make_shared<ImportBatch>();
 
-       
-        points->setDimensionNames(dimNames);
-        mv::events().notifyDatasetDataChanged(points);
+    batch->plugin           = this;
+    batch->pending.assign(studies.begin(), studies.end());
+    batch->options          = options;
+    batch->settings         = readLoadSettings(*this);
+    batch->numberOfStudies  = static_cast<int>(studies.size());
+    batch->start            = LoadProfiler::Clock::now();
 
+    // Parsing and deriving already spread over the pool, loading several studies at once mainly overlaps their serial stages and file access.
+    if (maximumConcurrentStudies == 0)
+        maximumConcurrentStudies = std::max<std::size_t>(2, ThreadPool::global().size() / 4);
 
+    const auto numberOfConcurrentStudies = std::max<std::size_t>(1, std::min(maximumConcurrentStudies, studies.size()));
 
-    }
+    // The memory for reading files and the memory budget are shared by the studies in flight.
+    batch->settings.memoryLimit = std::max<std::size_t>(1, batch->settings.memoryLimit / numberOfConcurrentStudies);
+
+    if (batch->settings.memoryBudget > 0)
+        batch->settings.memoryBudget = std::max<std::size_t>(1, batch->settings.memoryBudget / numberOfConcurrentStudies);
+
+    qInfo().noquote() << QString("Importing %1 studies, %2 at once").arg(studies.size()).arg(numberOfConcurrentStudies);
+
+    for (std::size_t studyIndex = 0; studyIndex < numberOfConcurrentStudies; studyIndex++)
+        startNextImport(batch);
 }
 
 QIcon VTKLoaderPluginFactory::getIcon(const QColor& color /*= Qt::black*/) const
@@ -573,34 +1203,3 @@ mv::DataTypes VTKLoaderPluginFactory::supportedDataTypes() const
     supportedTypes.append(PointType);
     return supportedTypes;
 }
-
-std::vector<std::string> VTKLoaderPlugin::cutString(std::string str)
-{
-
-    std::vector<std::string> spaceSeperated;
-    std::string word = "";
-    for (auto x : str)
-    {
-        if (x == ' ')
-        {
-            spaceSeperated.push_back(word);
-            word = "";
-
-        }
-        else {
-            word = word + x;
-        }
-    }
-    spaceSeperated.push_back(word);
-
-    return spaceSeperated;
-}
-
-bool VTKLoaderPlugin::isNumber(std::string str)
-{
-    /*for (char const& c : str) {
-        if (std::isdigit(c) == 0) return false;
-    }
-    return true;*/
-    return str.find_first_not_of("0123456789.-") == std::string::npos;
-}
\ No newline at end of file
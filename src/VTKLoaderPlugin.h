@@ -2,9 +2,38 @@
 
 #include <LoaderPlugin.h>
 
+#include "VTKStudyLoader.h"
+#include "ReducedPrecision.h"
+
+#include <QStringList>
+
+#include <cstddef>
+#include <vector>
+
 using namespace mv::plugin;
 
 
+// =============================================================================
+// Batch import
+// =============================================================================
+
+/** One study of a batch import */
+struct VTKStudyImport
+{
+    QString         name;           /** Name of the dataset, the name of the directory of the first file when empty */
+    QStringList     filePaths;      /** Files of the study, grouped by flow component and in time order like a file dialog selection */
+};
+
+/** Options of a batch import, they apply to every study of the batch */
+struct VTKImportOptions
+{
+    LoadSelection   selection;                              /** Part of every study to import */
+    ValuePrecision  precision = ValuePrecision::Float32;    /** Element type of the datasets */
+    std::size_t     resampledLineSize = 0;                  /** Number of points to resample every pathline to, zero keeps the stitched points */
+    bool            compactLayout = false;                  /** Whether index, time and group of pathline studies are stored per pathline, not for resampled pathlines */
+};
+
+
 // =============================================================================
 // Loader
 // =============================================================================
@@ -18,10 +47,35 @@ public:
     
     void init() override;
 
-    std::vector<std::string> cutString(std::string str);
-
     void loadData() Q_DECL_OVERRIDE;
-    bool isNumber(std::string str);
+
+    /**
+     * Import studies without any user interaction, e.g. from a scheduled batch. Several studies load at once, each
+     * on a thread of its own that spreads its files over the thread pool shared by all loads. One points dataset is
+     * created per study as soon as it is complete. Returns immediately, the signals report the outcome. The cache,
+     * memory limit, memory budget, derived speed and report file settings of the plugin apply; the memory limit and
+     * budget are shared by the studies that load at once. Must be called on the GUI thread.
+     * @param studies Studies to import
+     * @param options Options that apply to every study
+     * @param maximumConcurrentStudies Number of studies that load at once, zero selects a quarter of the hardware threads (at least two)
+     */
+    void importStudies(const std::vector<VTKStudyImport>& studies, const VTKImportOptions& options, std::size_t maximumConcurrentStudies = 0);
+
+signals:
+
+    /**
+     * Emitted on the GUI thread when a study of a batch import has been imported or has failed.
+     * @param datasetName Name of the dataset of the study
+     * @param error Reason of the failure, empty when the dataset was created
+     */
+    void studyImported(const QString& datasetName, const QString& error);
+
+    /**
+     * Emitted on the GUI thread once every study of a batch import is done.
+     * @param numberOfStudies Number of studies of the batch
+     * @param numberOfFailures Number of studies that could not be imported
+     */
+    void studiesImported(int numberOfStudies, int numberOfFailures);
 
 private:
     unsigned int _numDimensions;
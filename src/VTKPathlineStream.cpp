@@ -0,0 +1,377 @@
+#include "VTKPathlineStream.h"
+#include "VTKLegacyReader.h"
+#include "VTKXMLReader.h"
+#include "MappedFile.h"
+#include "StudyManifest.h"
+#include "ValueDecoding.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /** Consumed bytes of a cursor after which their pages are released */
+    const std::size_t releaseInterval = 1 << 20;
+
+    /** Reads the values of one located section front to back */
+    class ValueCursor
+    {
+    public:
+        ValueCursor(const MappedFile& file, const VTKValueLocation& location, bool binary, const std::string& fileName) :
+            _file(&file),
+            _location(location),
+            _binary(binary),
+            _valueType(valueTypeFromLegacyName(location.type)),
+            _fileName(fileName),
+            _scanner(),
+            _remaining(0),
+            _released(nullptr)
+        {
+            rewind();
+        }
+
+        void rewind()
+        {
+            _scanner    = VTKScanner(_location.position, _file->end());
+            _remaining  = _location.count;
+            _released   = _location.position;
+        }
+
+        /** Reads values as the destination type, sections of the other kind are converted like a full read */
+        template <typename Value>
+        void read(Value* destination, std::size_t count)
+        {
+            if (count > _remaining)
+                fail("holds fewer values than its section declares");
+
+            if constexpr (std::is_floating_point<Value>::value) {
+                if (_location.isInteger) {
+                    _integers.resize(count);
+                    read(_integers.data(), count);
+
+                    for (std::size_t index = 0; index < count; index++)
+                        destination[index] = static_cast<Value>(_integers[index]);
+
+                    return;
+                }
+            }
+            else {
+                if (!_location.isInteger) {
+                    _floats.resize(count);
+                    read(_floats.data(), count);
+
+                    for (std::size_t index = 0; index < count; index++)
+                        destination[index] = static_cast<Value>(_floats[index]);
+
+                    return;
+                }
+            }
+
+            if (_binary) {
+                decodeValues(_valueType, _scanner.position(), count, true, destination);
+                _scanner.seek(_scanner.position() + count * valueTypeSize(_valueType));
+            }
+            else {
+                for (std::size_t index = 0; index < count; index++) {
+                    bool valid;
+
+                    if constexpr (std::is_floating_point<Value>::value)
+                        valid = _scanner.readFloat(destination[index]);
+                    else
+                        valid = _scanner.readInteger(destination[index]);
+
+                    if (!valid)
+                        fail("invalid value");
+                }
+            }
+
+            _remaining -= count;
+
+            releaseConsumed();
+        }
+
+        /** Skips values without converting them */
+        void skip(std::size_t count)
+        {
+            if (count > _remaining)
+                fail("holds fewer values than its section declares");
+
+            if (_binary)
+                _scanner.seek(_scanner.position() + count * valueTypeSize(_valueType));
+            else
+                _scanner.skipTokens(count);
+
+            _remaining -= count;
+
+            releaseConsumed();
+        }
+
+    private:
+        void releaseConsumed()
+        {
+            if (static_cast<std::size_t>(_scanner.position() - _released) < releaseInterval)
+                return;
+
+            _file->release(_released, _scanner.position());
+            _released = _scanner.position();
+        }
+
+        [[noreturn]] void fail(const std::string& message) const
+        {
+            throw std::runtime_error(_fileName + ": " + message);
+        }
+
+    private:
+        const MappedFile*   _file;
+        VTKValueLocation    _location;
+        bool                _binary;
+        ValueType           _valueType;
+        std::string         _fileName;
+        VTKScanner          _scanner;
+        std::size_t         _remaining;
+        const char*         _released;          /** Start of the consumed range that has not been released yet */
+        std::vector<int>    _integers;          /** Conversion buffer of integer sections */
+        std::vector<float>  _floats;            /** Conversion buffer of floating point sections */
+    };
+
+    /** Legacy file read through one cursor per section */
+    class LegacyPathlineStream : public VTKPathlineStream
+    {
+    public:
+        LegacyPathlineStream(MappedFile&& file, const VTKLegacyLayout& layout, const std::string& fileName) :
+            _file(std::move(file)),
+            _fileName(fileName),
+            _cellOffsets(layout.cellOffsets),
+            _points(_file, layout.points, layout.binary, fileName),
+            _cells(_file, layout.cells, layout.binary, fileName),
+            _pointData(),
+            _previousOffset(0),
+            _offsets()
+        {
+            _numberOfPoints         = layout.points.count / 3;
+            _numberOfLines          = layout.numberOfLines;
+            _numberOfPointArrays    = layout.pointData.size();
+            _firstSegmentSize       = layout.firstSegmentSize;
+            _uniformSegmentSize     = layout.uniformSegmentSize;
+
+            _pointData.reserve(layout.pointData.size());
+
+            for (const auto& location : layout.pointData) {
+                _pointData.emplace_back(_file, location, layout.binary, fileName);
+                _pointArraySizes.push_back(location.count);
+                _pointArrayNames.push_back(location.name);
+            }
+
+            rewind();
+        }
+
+        std::size_t pointArraySize(std::size_t arrayIndex) const override
+        {
+            return _pointArraySizes[arrayIndex];
+        }
+
+        std::string pointArrayName(std::size_t arrayIndex) const override
+        {
+            return _pointArrayNames[arrayIndex];
+        }
+
+        void rewind() override
+        {
+            _points.rewind();
+            _cells.rewind();
+
+            for (auto& cursor : _pointData)
+                cursor.rewind();
+
+            // Offsets describe a cell by the difference to the previous offset, the first one starts the series.
+            if (_cellOffsets && _numberOfLines > 0)
+                _cells.read(&_previousOffset, 1);
+        }
+
+        void readSegmentSizes(std::size_t count, std::uint32_t* sizes) override
+        {
+            if (_cellOffsets) {
+                _offsets.resize(count);
+                _cells.read(_offsets.data(), count);
+
+                for (std::size_t index = 0; index < count; index++) {
+                    sizes[index]    = static_cast<std::uint32_t>(_offsets[index] - _previousOffset);
+                    _previousOffset = _offsets[index];
+                }
+
+                return;
+            }
+
+            // Each cell is stored as its point count followed by the point indices, which the loader does not use.
+            for (std::size_t index = 0; index < count; index++) {
+                int size = 0;
+
+                _cells.read(&size, 1);
+                _cells.skip(static_cast<std::size_t>(size));
+
+                sizes[index] = static_cast<std::uint32_t>(size);
+            }
+        }
+
+        void readPoints(std::size_t count, float* positions) override
+        {
+            _points.read(positions, 3 * count);
+        }
+
+        void readPointData(std::size_t arrayIndex, std::size_t count, float* values) override
+        {
+            _pointData[arrayIndex].read(values, count);
+        }
+
+        void readPointData(std::size_t arrayIndex, std::size_t count, int* values) override
+        {
+            _pointData[arrayIndex].read(values, count);
+        }
+
+        void skipPoints(std::size_t count) override
+        {
+            _points.skip(3 * count);
+        }
+
+        void skipPointData(std::size_t arrayIndex, std::size_t count) override
+        {
+            _pointData[arrayIndex].skip(count);
+        }
+
+    private:
+        MappedFile                  _file;
+        std::string                 _fileName;
+        bool                        _cellOffsets;
+        ValueCursor                 _points;
+        ValueCursor                 _cells;
+        std::vector<ValueCursor>    _pointData;
+        std::vector<std::size_t>    _pointArraySizes;
+        std::vector<std::string>    _pointArrayNames;
+        int                         _previousOffset;
+        std::vector<int>            _offsets;
+    };
+
+    /** File that was parsed in full, served in blocks from memory */
+    class ParsedPathlineStream : public VTKPathlineStream
+    {
+    public:
+        explicit ParsedPathlineStream(VTKData&& data) :
+            _data(std::move(data)),
+            _nextLine(0),
+            _nextPoint(0),
+            _nextValues(_data.pointData.size(), 0)
+        {
+            _numberOfPoints         = _data.points.size();
+            _numberOfLines          = _data.numberOfLines();
+            _numberOfPointArrays    = _data.pointData.size();
+
+            for (std::size_t lineIndex = 0; lineIndex < _numberOfLines; lineIndex++) {
+                const auto size = _data.lineSize(lineIndex);
+
+                if (lineIndex == 0) {
+                    _firstSegmentSize   = size;
+                    _uniformSegmentSize = size;
+                }
+                else if (size != _uniformSegmentSize) {
+                    _uniformSegmentSize = 0;
+                }
+            }
+        }
+
+        std::size_t pointArraySize(std::size_t arrayIndex) const override
+        {
+            return _data.pointData[arrayIndex].size();
+        }
+
+        std::string pointArrayName(std::size_t arrayIndex) const override
+        {
+            return _data.pointData[arrayIndex].name;
+        }
+
+        void rewind() override
+        {
+            _nextLine   = 0;
+            _nextPoint  = 0;
+
+            std::fill(_nextValues.begin(), _nextValues.end(), 0);
+        }
+
+        void readSegmentSizes(std::size_t count, std::uint32_t* sizes) override
+        {
+            for (std::size_t index = 0; index < count; index++)
+                sizes[index] = static_cast<std::uint32_t>(_data.lineSize(_nextLine++));
+        }
+
+        void readPoints(std::size_t count, float* positions) override
+        {
+            for (std::size_t index = 0; index < count; index++, _nextPoint++)
+                for (std::size_t component = 0; component < 3; component++)
+                    positions[3 * index + component] = _data.points[_nextPoint][component];
+        }
+
+        void readPointData(std::size_t arrayIndex, std::size_t count, float* values) override
+        {
+            const auto& array = _data.pointData[arrayIndex];
+            auto& nextValue = _nextValues[arrayIndex];
+
+            for (std::size_t index = 0; index < count; index++)
+                values[index] = array.valueAt(nextValue++);
+        }
+
+        void readPointData(std::size_t arrayIndex, std::size_t count, int* values) override
+        {
+            const auto& array = _data.pointData[arrayIndex];
+            auto& nextValue = _nextValues[arrayIndex];
+
+            for (std::size_t index = 0; index < count; index++)
+                values[index] = array.integerAt(nextValue++);
+        }
+
+        void skipPoints(std::size_t count) override
+        {
+            _nextPoint += count;
+        }
+
+        void skipPointData(std::size_t arrayIndex, std::size_t count) override
+        {
+            _nextValues[arrayIndex] += count;
+        }
+
+    private:
+        VTKData                     _data;
+        std::size_t                 _nextLine;
+        std::size_t                 _nextPoint;
+        std::vector<std::size_t>    _nextValues;
+    };
+}
+
+std::unique_ptr<VTKPathlineStream> VTKPathlineStream::open(const std::string& filePath, const VTKFileManifest* manifest)
+{
+    if (VTKXMLReader::isXMLFile(filePath))
+        return std::make_unique<ParsedPathlineStream>(VTKXMLReader().read(filePath));
+
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    VTKLegacyLayout layout;
+
+    // A file that changed since it was scanned is located again.
+    if (manifest != nullptr && manifest->hasLayout && manifest->contentSize == file.size()) {
+        layout = manifest->layout;
+
+        VTKLegacyReader::attach(layout, file);
+    }
+    else {
+        layout = VTKLegacyReader().locate(file, filePath);
+    }
+
+    if (!layout.streamable)
+        return std::make_unique<ParsedPathlineStream>(VTKLegacyReader().parse(file.data(), file.end(), filePath));
+
+    return std::make_unique<LegacyPathlineStream>(std::move(file), layout, filePath);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct VTKFileManifest;
+
+// =============================================================================
+// Pathline stream
+// =============================================================================
+
+/**
+ * Block wise reader for the pathline data of one file: the sizes of its line cells, the point positions and
+ * the point data arrays, each read front to back in blocks of any size.
+ *
+ * Legacy files are located first (see VTKLegacyReader::locate) and then read through one cursor per section
+ * straight from the memory mapping, so only the blocks handed to the caller are ever held in memory; the
+ * pages of consumed blocks are released as the cursors advance. XML files, and legacy files with sections
+ * that cannot be read in blocks, are parsed in full and served from memory through the same interface.
+ * Errors are reported by throwing std::runtime_error with a message naming the file.
+ */
+class VTKPathlineStream
+{
+public:
+
+    /**
+     * Open a file for reading in blocks.
+     * @param filePath UTF-8 encoded path of the file
+     * @param manifest Manifest of the file (see StudyManifest), its located sections are used instead of locating them again; may be nullptr
+     * @return Stream positioned at the start of every section
+     */
+    static std::unique_ptr<VTKPathlineStream> open(const std::string& filePath, const VTKFileManifest* manifest = nullptr);
+
+    virtual ~VTKPathlineStream() = default;
+
+    std::size_t numberOfPoints() const { return _numberOfPoints; }
+    std::size_t numberOfLines() const { return _numberOfLines; }
+    std::size_t numberOfPointArrays() const { return _numberOfPointArrays; }
+
+    /** Number of points of the first line cell, zero without line cells */
+    std::size_t firstSegmentSize() const { return _firstSegmentSize; }
+
+    /** Number of points shared by all line cells, zero if their sizes differ */
+    std::size_t uniformSegmentSize() const { return _uniformSegmentSize; }
+
+    /** Number of values of a point data array */
+    virtual std::size_t pointArraySize(std::size_t arrayIndex) const = 0;
+
+    /** Name of a point data array */
+    virtual std::string pointArrayName(std::size_t arrayIndex) const = 0;
+
+    /** Move all sections back to their start */
+    virtual void rewind() = 0;
+
+    /**
+     * Read the number of points of the next line cells.
+     * @param count Number of line cells
+     * @param sizes Receives count sizes
+     */
+    virtual void readSegmentSizes(std::size_t count, std::uint32_t* sizes) = 0;
+
+    /**
+     * Read the next point positions.
+     * @param count Number of points
+     * @param positions Receives three values per point
+     */
+    virtual void readPoints(std::size_t count, float* positions) = 0;
+
+    /**
+     * Read the next values of a point data array, integer arrays are converted to float.
+     * @param arrayIndex Index of the array in file order
+     * @param count Number of values
+     * @param values Receives count values
+     */
+    virtual void readPointData(std::size_t arrayIndex, std::size_t count, float* values) = 0;
+
+    /**
+     * Read the next values of a point data array as integers, floating point arrays are truncated.
+     * @param arrayIndex Index of the array in file order
+     * @param count Number of values
+     * @param values Receives count values
+     */
+    virtual void readPointData(std::size_t arrayIndex, std::size_t count, int* values) = 0;
+
+    /**
+     * Move past point positions without converting them.
+     * @param count Number of points
+     */
+    virtual void skipPoints(std::size_t count) = 0;
+
+    /**
+     * Move past values of a point data array without converting them.
+     * @param arrayIndex Index of the array in file order
+     * @param count Number of values
+     */
+    virtual void skipPointData(std::size_t arrayIndex, std::size_t count) = 0;
+
+protected:
+    std::size_t     _numberOfPoints = 0;
+    std::size_t     _numberOfLines = 0;
+    std::size_t     _numberOfPointArrays = 0;
+    std::size_t     _firstSegmentSize = 0;
+    std::size_t     _uniformSegmentSize = 0;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+
+// =============================================================================
+// Scanner
+// =============================================================================
+
+/**
+ * Allocation free scanner over a range of ASCII VTK text.
+ * Tokens are returned as views into the scanned range and numbers are converted in place,
+ * so walking a mapped file never copies it into strings.
+ */
+class VTKScanner
+{
+public:
+    VTKScanner() = default;
+    VTKScanner(const char* begin, const char* end) : _begin(begin), _current(begin), _end(end) { }
+
+    /** Returns true when only whitespace is left */
+    bool atEnd()
+    {
+        skipWhitespace();
+        return _current == _end;
+    }
+
+    /** Returns the next whitespace separated token, or an empty view at the end of the range */
+    std::string_view nextToken()
+    {
+        skipWhitespace();
+
+        const char* start = _current;
+        while (_current != _end && !isWhitespace(*_current))
+            ++_current;
+
+        return std::string_view(start, static_cast<std::size_t>(_current - start));
+    }
+
+    /** Returns the next token without consuming it */
+    std::string_view peekToken()
+    {
+        const char* position = _current;
+        const auto token = nextToken();
+        _current = position;
+        return token;
+    }
+
+    /** Returns the remainder of the current line (without line terminator) and moves to the start of the next line */
+    std::string_view nextLine()
+    {
+        const char* start = _current;
+        const char* newLine = static_cast<const char*>(std::memchr(_current, '\n', static_cast<std::size_t>(_end - _current)));
+        const char* lineEnd = newLine != nullptr ? newLine : _end;
+
+        _current = newLine != nullptr ? newLine + 1 : _end;
+
+        if (lineEnd != start && *(lineEnd - 1) == '\r')
+            --lineEnd;
+
+        return std::string_view(start, static_cast<std::size_t>(lineEnd - start));
+    }
+
+    /** Skips the remainder of the current line */
+    void skipLine()
+    {
+        nextLine();
+    }
+
+    /**
+     * Reads the next token as an integer.
+     * @param value Receives the value
+     * @return False if the next token is not an integer
+     */
+    template <typename IntegerType>
+    bool readInteger(IntegerType& value)
+    {
+        skipWhitespace();
+
+        if (_current != _end && *_current == '+')
+            ++_current;
+
+        const auto result = std::from_chars(_current, _end, value);
+        if (result.ec != std::errc())
+            return false;
+
+        // Accept integers written as floating point (e.g. "3.0"), truncating like std::stoi does.
+        _current = result.ptr;
+        while (_current != _end && !isWhitespace(*_current))
+            ++_current;
+
+        return true;
+    }
+
+    /**
+     * Reads the next token as a single precision float.
+     * Conversion is correctly rounded, so the result is identical to std::stof on the same token.
+     * @param value Receives the value
+     * @return False if the next token is not a number
+     */
+    bool readFloat(float& value)
+    {
+        skipWhitespace();
+
+        if (_current != _end && *_current == '+')
+            ++_current;
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        const auto result = std::from_chars(_current, _end, value);
+
+        if (result.ec == std::errc()) {
+            _current = result.ptr;
+            return true;
+        }
+
+        // Denormals and overflow are reported as out of range, let strtof decide on the value like std::stof does.
+        if (result.ec != std::errc::result_out_of_range)
+            return false;
+#endif
+
+        return readFloatFallback(value);
+    }
+
+    /** Skips the given number of tokens without converting them */
+    void skipTokens(std::size_t count)
+    {
+        for (std::size_t tokenIndex = 0; tokenIndex < count && _current != _end; tokenIndex++)
+            nextToken();
+    }
+
+    const char* begin() const { return _begin; }
+    const char* position() const { return _current; }
+    const char* end() const { return _end; }
+
+    void seek(const char* position) { _current = position; }
+
+    /** Byte offset of the current position from the start of the scanned range */
+    std::size_t offset() const { return static_cast<std::size_t>(_current - _begin); }
+
+    static bool isWhitespace(char character)
+    {
+        return character == ' ' || character == '\n' || character == '\r' || character == '\t' || character == '\v' || character == '\f';
+    }
+
+private:
+    void skipWhitespace()
+    {
+        while (_current != _end && isWhitespace(*_current))
+            ++_current;
+    }
+
+    /** Converts the current token with strtof from a small stack buffer, used where std::from_chars has no float support */
+    bool readFloatFallback(float& value)
+    {
+        char buffer[64];
+
+        std::size_t length = 0;
+        while (_current + length != _end && !isWhitespace(_current[length]) && length < sizeof(buffer) - 1)
+            ++length;
+
+        if (length == 0)
+            return false;
+
+        std::memcpy(buffer, _current, length);
+        buffer[length] = '\0';
+
+        char* parsedEnd = nullptr;
+        value = std::strtof(buffer, &parsedEnd);
+
+        if (parsedEnd == buffer)
+            return false;
+
+        _current += parsedEnd - buffer;
+        return true;
+    }
+
+private:
+    const char* _begin      = nullptr;
+    const char* _current    = nullptr;
+    const char* _end        = nullptr;
+};
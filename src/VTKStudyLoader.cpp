@@ -0,0 +1,1672 @@
+#include "VTKStudyLoader.h"
+#include "VTKLegacyReader.h"
+#include "VTKXMLReader.h"
+#include "ThreadPool.h"
+#include "PathlineKernels.h"
+#include "StudyCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    /** Size of a file in bytes, zero if it can not be inspected */
+    std::size_t fileSize(const std::string& filePath)
+    {
+        std::error_code error;
+
+        const auto size = std::filesystem::file_size(std::filesystem::u8path(filePath), error);
+
+        return error ? 0 : static_cast<std::size_t>(size);
+    }
+
+    /** Column names of the values stored per pathline point */
+    const std::array<const char*, 10> pathlineColumnNames = { "x", "y", "z", "speed", "index", "time", "group", "x'", "y'", "z'" };
+
+    /** Column names of the values stored per voxel */
+    const std::array<const char*, 8> volumeColumnNames = { "x", "y", "z", "speed", "x'", "y'", "z'", "time" };
+}
+
+std::string LoadSelection::key() const
+{
+    std::string key;
+
+    if (!groups.empty()) {
+        key += "groups";
+
+        for (const auto group : groups)
+            key += " " + std::to_string(group);
+
+        key += "\n";
+    }
+
+    if (firstTimepoint != 0 || lastTimepoint >= 0)
+        key += "timepoints " + std::to_string(firstTimepoint) + " " + std::to_string(lastTimepoint) + "\n";
+
+    if (lineStride != 1)
+        key += "stride " + std::to_string(lineStride) + "\n";
+
+    if (sampleSize != 0)
+        key += "sample " + std::to_string(sampleSize) + " " + std::to_string(seed) + "\n";
+
+    // The threshold is written with all its digits, the mask file itself is part of the study files of the cache.
+    if (minimumSpeed > 0.0f) {
+        char threshold[32];
+        std::snprintf(threshold, sizeof(threshold), "%.9g", minimumSpeed);
+
+        key += "minimumSpeed " + std::string(threshold) + "\n";
+    }
+
+    if (!maskFilePath.empty())
+        key += "mask " + maskFilePath + "\n";
+
+    return key;
+}
+
+VTKStudyLoader::VTKStudyLoader(const std::vector<std::string>& filePaths) :
+    _filePaths(filePaths),
+    _cacheDirectory(),
+    _cacheSizeLimit(defaultCacheSizeLimit),
+    _selection(),
+    _manifest(),
+    _timepointsPerGroup(StudyManifest::defaultTimepointsPerGroup),
+    _groups(),
+    _firstTimepoint(0),
+    _lastTimepoint(_timepointsPerGroup - 1),
+    _resetPoint(0),
+    _study(),
+    _groupOffsets(),
+    _lineLengths(),
+    _lineRows(),
+    _pathlineIndex(),
+    _idleBlockBuffers(),
+    _blockBuffersMutex(),
+    _volumeOffset(0),
+    _numberOfAppendedTimepoints(0),
+    _memoryLimit(defaultMemoryLimit),
+    _memoryBudget(0),
+    _scratchDirectory(),
+    _derivedSpeed(false),
+    _resampledLineSize(0),
+    _profiler(nullptr),
+    _progressCallback(),
+    _progressMutex(),
+    _warningCallback(),
+    _warningMutex(),
+    _cancelled(false)
+{
+}
+
+void VTKStudyLoader::setProgressCallback(ProgressCallback progressCallback)
+{
+    _progressCallback = std::move(progressCallback);
+}
+
+void VTKStudyLoader::setWarningCallback(WarningCallback warningCallback)
+{
+    _warningCallback = std::move(warningCallback);
+}
+
+void VTKStudyLoader::cancel()
+{
+    _cancelled = true;
+}
+
+bool VTKStudyLoader::isCancelled() const
+{
+    return _cancelled;
+}
+
+void VTKStudyLoader::setCacheDirectory(const std::string& cacheDirectory, std::uint64_t cacheSizeLimit)
+{
+    _cacheDirectory = cacheDirectory;
+    _cacheSizeLimit = cacheSizeLimit;
+}
+
+void VTKStudyLoader::setSelection(const LoadSelection& selection)
+{
+    _selection = selection;
+}
+
+void VTKStudyLoader::setMemoryLimit(std::size_t memoryLimit)
+{
+    _memoryLimit = memoryLimit;
+}
+
+void VTKStudyLoader::setMemoryBudget(std::size_t memoryBudget, const std::string& scratchDirectory)
+{
+    _memoryBudget       = memoryBudget;
+    _scratchDirectory   = scratchDirectory;
+}
+
+std::size_t VTKStudyLoader::matrixMemoryBudget(std::size_t residentBytes) const
+{
+    if (_memoryBudget == 0)
+        return std::numeric_limits<std::size_t>::max();
+
+    // The blocks read from the files come first, they bound the parsing concurrency.
+    const auto usedBytes = _memoryLimit + residentBytes;
+
+    return _memoryBudget > usedBytes ? _memoryBudget - usedBytes : 0;
+}
+
+void VTKStudyLoader::setDerivedSpeed(bool derivedSpeed)
+{
+    _derivedSpeed = derivedSpeed;
+}
+
+void VTKStudyLoader::setResampledLineSize(std::size_t resampledLineSize)
+{
+    _resampledLineSize = resampledLineSize;
+}
+
+void VTKStudyLoader::setProfiler(LoadProfiler* profiler)
+{
+    _profiler = profiler;
+}
+
+LoadedStudy VTKStudyLoader::load()
+{
+    if (_cacheDirectory.empty())
+        return loadFiles();
+
+    // An edited mask file changes the study like an edited study file.
+    auto cacheFilePaths = _filePaths;
+
+    if (!_selection.maskFilePath.empty())
+        cacheFilePaths.push_back(_selection.maskFilePath);
+
+    const StudyCache cache(_cacheDirectory, cacheFilePaths, _selection.key() + (_derivedSpeed ? " derivedSpeed" : "") + (_resampledLineSize > 0 ? " resampled " + std::to_string(_resampledLineSize) : ""));
+
+    LoadedStudy study;
+
+    study.data.setMemoryBudget(matrixMemoryBudget(), _scratchDirectory);
+
+    bool isCached;
+
+    {
+        LoadProfiler::Scope scope(_profiler, "cache read");
+
+        isCached = cache.read(study);
+
+        scope.addBytes(study.data.size() * sizeof(float));
+        scope.addElements(study.data.size());
+    }
+
+    if (isCached) {
+        for (const auto phase : { LoadPhase::Scan, LoadPhase::Parse, LoadPhase::Stitch, LoadPhase::Derive })
+            reportProgress(phase, 1, 1, cache.cacheFilePath());
+
+        // The cache holds the matrix only, the spatial index is rebuilt from it.
+        if (study.isPathlines)
+            indexPathlines(study);
+
+        return study;
+    }
+
+    study = loadFiles();
+
+    // A study beyond the size limit would evict every other entry and then itself.
+    if (_cacheSizeLimit > 0 && study.data.size() * sizeof(float) > _cacheSizeLimit)
+        return study;
+
+    LoadProfiler::Scope scope(_profiler, "cache write", study.data.size() * sizeof(float), study.data.size());
+
+    if (!cache.write(study))
+        reportWarning("Unable to write the study cache " + cache.cacheFilePath());
+    else
+        cache.prune(_cacheSizeLimit);
+
+    return study;
+}
+
+LoadedStudy VTKStudyLoader::loadFiles()
+{
+    // The headers of all files come first: a broken or mismatching series fails before any value is read.
+    {
+        LoadProfiler::Scope scope(_profiler, "manifest", 0, _filePaths.size());
+
+        std::atomic<std::size_t> numberOfScannedFiles(0);
+
+        _manifest = StudyManifest::scan(_filePaths, [this, &numberOfScannedFiles](const VTKFileManifest& file) {
+            throwIfCancelled();
+
+            reportProgress(LoadPhase::Scan, ++numberOfScannedFiles, _filePaths.size(), file.filePath);
+        });
+
+        for (const auto& file : _manifest.files)
+            scope.addBytes(file.fileSize);
+    }
+
+    _timepointsPerGroup = _manifest.timepointsPerGroup;
+
+    resolveSelection(_manifest.numberOfGroups);
+
+    _study.data.setMemoryBudget(matrixMemoryBudget(), _scratchDirectory);
+
+    _study.isPathlines = _manifest.isPathlines;
+
+    if (_study.isPathlines) {
+        loadPathlines();
+
+        if (_resampledLineSize > 0) {
+            LoadProfiler::Scope scope(_profiler, "resample", 0, _study.numPoints * _resampledLineSize);
+
+            resamplePathlines();
+        }
+
+        {
+            LoadProfiler::Scope scope(_profiler, "derive", 6 * sizeof(float) * _study.numPoints * _study.lineSize, _study.numPoints * _study.lineSize);
+
+            computeDifferences();
+        }
+
+        indexPathlines(_study);
+
+        // Add dimension names.
+        _study.dimensionNames.reserve(_study.numDimensions);
+
+        for (std::size_t pointIndex = 0; pointIndex < _study.lineSize; pointIndex++)
+            for (const auto columnName : pathlineColumnNames)
+                _study.dimensionNames.push_back(columnName + std::to_string(pointIndex));
+    }
+    else {
+        loadVolumes();
+
+        _study.numPoints = _volumeOffset / _study.numDimensions;
+        _study.dimensionNames.assign(volumeColumnNames.begin(), volumeColumnNames.end());
+    }
+
+    return std::move(_study);
+}
+
+void VTKStudyLoader::resolveSelection(int numberOfGroups)
+{
+    _groups = _selection.groups;
+
+    if (_groups.empty())
+        for (int group = 0; group < numberOfGroups; group++)
+            _groups.push_back(group);
+
+    std::sort(_groups.begin(), _groups.end());
+    _groups.erase(std::unique(_groups.begin(), _groups.end()), _groups.end());
+
+    if (_groups.front() < 0 || _groups.back() >= numberOfGroups)
+        throw std::runtime_error("The selection refers to groups outside the " + std::to_string(numberOfGroups) + " groups of the study");
+
+    _firstTimepoint = _selection.firstTimepoint;
+    _lastTimepoint  = _selection.lastTimepoint < 0 ? _timepointsPerGroup - 1 : _selection.lastTimepoint;
+
+    if (_firstTimepoint < 0 || _lastTimepoint >= _timepointsPerGroup || _firstTimepoint > _lastTimepoint)
+        throw std::runtime_error("The selected timepoints must lie between 0 and " + std::to_string(_timepointsPerGroup - 1));
+
+    if (_selection.lineStride == 0)
+        throw std::runtime_error("The pathline stride must be at least one");
+}
+
+std::vector<std::size_t> VTKStudyLoader::selectLines(std::size_t numberOfLines, int group) const
+{
+    std::vector<std::size_t> lineRows(numberOfLines, std::string::npos);
+
+    const auto stride               = _selection.lineStride;
+    const auto numberOfCandidates   = (numberOfLines + stride - 1) / stride;
+    const auto numberOfSelected     = countSelectedLines(numberOfLines);
+
+    // Selection sampling (Knuth's algorithm S) draws the sample in file order in a single pass. Each group has its
+    // own sequence, so the sample of a group does not depend on which other groups are loaded.
+    std::seed_seq seed{ _selection.seed, static_cast<std::uint32_t>(group) };
+    std::mt19937 random(seed);
+
+    std::size_t row = 0;
+
+    for (std::size_t candidate = 0; candidate < numberOfCandidates && row < numberOfSelected; candidate++) {
+        const auto remainingCandidates  = numberOfCandidates - candidate;
+        const auto remainingRows        = numberOfSelected - row;
+
+        if (remainingRows == remainingCandidates || std::uniform_int_distribution<std::size_t>(0, remainingCandidates - 1)(random) < remainingRows)
+            lineRows[candidate * stride] = row++;
+    }
+
+    return lineRows;
+}
+
+std::size_t VTKStudyLoader::countSelectedLines(std::size_t numberOfLines) const
+{
+    const auto numberOfCandidates = (numberOfLines + _selection.lineStride - 1) / _selection.lineStride;
+
+    return _selection.sampleSize > 0 ? std::min(_selection.sampleSize, numberOfCandidates) : numberOfCandidates;
+}
+
+std::size_t VTKStudyLoader::timepointFileIndex(int group, int timepoint) const
+{
+    return static_cast<std::size_t>(group * _timepointsPerGroup + (timepoint + _resetPoint) % _timepointsPerGroup);
+}
+
+const std::string& VTKStudyLoader::timepointFilePath(int group, int timepoint) const
+{
+    return _filePaths[timepointFileIndex(group, timepoint)];
+}
+
+void VTKStudyLoader::loadPathlines()
+{
+    const auto numberOfGroups       = static_cast<int>(_filePaths.size()) / _timepointsPerGroup;
+    const auto numberOfTimepoints   = _lastTimepoint - _firstTimepoint + 1;
+
+    std::atomic<std::size_t> numberOfOpenedFiles(0);
+    std::atomic<std::size_t> numberOfStitchedFiles(0);
+
+    for (const auto group : _groups) {
+        std::vector<std::unique_ptr<VTKPathlineStream>> files;
+
+        // The first selected group determines the order of the files and the size of the data matrix.
+        if (group == _groups.front()) {
+            LoadProfiler::Scope scope(_profiler, "scan");
+
+            if (numberOfTimepoints == _timepointsPerGroup) {
+
+                // Every file of the group is opened anyway, in selection order until the reset point is known.
+                _resetPoint = 0;
+                files = openTimepoints(group, numberOfOpenedFiles);
+
+                _resetPoint = readResetPoint(files);
+
+                std::rotate(files.begin(), files.begin() + _resetPoint, files.end());
+            }
+            else {
+                _resetPoint = readResetPoint(group);
+
+                files = openTimepoints(group, numberOfOpenedFiles);
+            }
+
+            allocatePathlines(files, numberOfGroups);
+        }
+        else {
+            files = openTimepoints(group, numberOfOpenedFiles);
+        }
+
+        stitchGroup(files, group, numberOfStitchedFiles);
+
+        // The rows of the group are complete until the difference vectors are derived.
+        _study.data.release(_groupOffsets[group] * _study.numDimensions, _groupOffsets[group + 1] * _study.numDimensions);
+    }
+
+    // The block buffers are only needed while stitching.
+    _idleBlockBuffers.clear();
+}
+
+std::vector<std::unique_ptr<VTKPathlineStream>> VTKStudyLoader::openTimepoints(int group, std::atomic<std::size_t>& numberOfOpenedFiles)
+{
+    const auto numberOfFiles = _groups.size() * static_cast<std::size_t>(_lastTimepoint - _firstTimepoint + 1);
+
+    // Locate the sections of every file in parallel, the values are read while stitching.
+    std::vector<std::unique_ptr<VTKPathlineStream>> files(_lastTimepoint - _firstTimepoint + 1);
+
+    ThreadPool::global().parallelFor(files.size(), [this, group, &files, &numberOfOpenedFiles, numberOfFiles](std::size_t index) {
+        throwIfCancelled();
+
+        const auto fileIndex    = timepointFileIndex(group, _firstTimepoint + static_cast<int>(index));
+        const auto& filePath    = _filePaths[fileIndex];
+
+        LoadProfiler::Scope scope(_profiler, "open", fileSize(filePath));
+
+        // The sections were located by the manifest, unless the layout of a loaded study was restored without one.
+        files[index] = VTKPathlineStream::open(filePath, _manifest.files.empty() ? nullptr : &_manifest.files[fileIndex]);
+
+        scope.addElements(files[index]->numberOfPoints());
+
+        reportProgress(LoadPhase::Parse, ++numberOfOpenedFiles, numberOfFiles, filePath);
+    });
+
+    return files;
+}
+
+void VTKStudyLoader::loadVolumes()
+{
+    const auto numberOfTimepoints   = _lastTimepoint - _firstTimepoint + 1;
+    const auto numberOfFiles        = _groups.size() * numberOfTimepoints;
+
+    std::atomic<std::size_t> numberOfParsedFiles(0);
+    std::size_t numberOfStitchedFiles = 0;
+
+    for (const auto group : _groups) {
+
+        // Read every selected file of the group once, in parallel.
+        std::vector<VTKData> files(numberOfTimepoints);
+
+        ThreadPool::global().parallelFor(files.size(), [this, group, &files, &numberOfParsedFiles, numberOfFiles](std::size_t index) {
+            throwIfCancelled();
+
+            const auto& filePath = timepointFilePath(group, _firstTimepoint + static_cast<int>(index));
+
+            LoadProfiler::Scope scope(_profiler, "parse", fileSize(filePath));
+
+            files[index] = readFile(filePath);
+
+            scope.addElements(std::max(files[index].points.size(), static_cast<std::size_t>(files[index].dimensions[0]) * files[index].dimensions[1] * files[index].dimensions[2]));
+
+            reportProgress(LoadPhase::Parse, ++numberOfParsedFiles, numberOfFiles, filePath);
+        });
+
+        // The first file determines the size of the data matrix. Masked studies grow it file by file instead, as
+        // only the voxels that pass the mask get a row.
+        if (group == _groups.front()) {
+            const auto& dimensions = files.front().dimensions;
+            const auto numberOfVoxels = static_cast<std::size_t>(dimensions[0]) * dimensions[1] * dimensions[2];
+
+            _study.numDimensions    = volumeColumnNames.size();
+            _study.volumeDimensions = dimensions;
+
+            if (_selection.masksVolumes())
+                loadVoxelMask(dimensions);
+            else
+                _study.data.resize(numberOfFiles * numberOfVoxels * _study.numDimensions);
+        }
+
+        for (int index = 0; index < numberOfTimepoints; index++) {
+            throwIfCancelled();
+
+            const auto timepoint = _firstTimepoint + index;
+            const auto& filePath = timepointFilePath(group, timepoint);
+
+            {
+                LoadProfiler::Scope scope(_profiler, "stitch");
+
+                const auto firstValue = _volumeOffset;
+
+                appendVolume(files[index], filePath, timepoint);
+
+                scope.addElements((_volumeOffset - firstValue) / volumeColumnNames.size());
+                scope.addBytes((_volumeOffset - firstValue) * sizeof(float));
+            }
+
+            // Release the parsed file as soon as it has been used.
+            files[index] = VTKData();
+
+            reportProgress(LoadPhase::Stitch, ++numberOfStitchedFiles, numberOfFiles, filePath);
+        }
+    }
+}
+
+namespace
+{
+    /** Number of points a segment adds to its pathline: all of them at the first timepoint, later ones drop their overlap and are padded */
+    std::size_t segmentContribution(std::size_t segmentSize, int timepoint)
+    {
+        if (segmentSize == 0)
+            return 0;
+
+        if (timepoint == 0)
+            return segmentSize;
+
+        const auto appended = segmentSize > VTKStudyLoader::segmentOverlap ? segmentSize - VTKStudyLoader::segmentOverlap : 0;
+        const auto padding  = segmentSize < VTKStudyLoader::segmentPoints ? VTKStudyLoader::segmentPoints - segmentSize : 0;
+
+        return appended + padding;
+    }
+
+    /** Bytes held per point of a block: position, line index, speed and a share of the segment sizes */
+    const std::size_t bytesPerBlockPoint = 5 * sizeof(float) + sizeof(std::uint32_t);
+
+    /** Smallest block, below which the per block overhead dominates */
+    const std::size_t minimumBlockSize = 1024;
+}
+
+VTKData VTKStudyLoader::readFile(const std::string& filePath)
+{
+    if (VTKXMLReader::isXMLFile(filePath))
+        return VTKXMLReader().read(filePath);
+
+    return VTKLegacyReader().read(filePath);
+}
+
+std::size_t VTKStudyLoader::readNumberOfLines(const std::string& filePath)
+{
+    if (VTKXMLReader::isXMLFile(filePath))
+        return VTKXMLReader().readNumberOfLines(filePath);
+
+    return VTKLegacyReader().readNumberOfLines(filePath);
+}
+
+std::vector<std::array<float, 3>> VTKStudyLoader::readLeadingPoints(const std::string& filePath, std::size_t count)
+{
+    if (VTKXMLReader::isXMLFile(filePath))
+        return VTKXMLReader().readLeadingPoints(filePath, count);
+
+    return VTKLegacyReader().readLeadingPoints(filePath, count);
+}
+
+int VTKStudyLoader::readResetPoint(int group)
+{
+    std::vector<std::unique_ptr<VTKPathlineStream>> files(_timepointsPerGroup);
+
+    // Only the sections of the files are located, their leading points are read from there.
+    ThreadPool::global().parallelFor(files.size(), [this, group, &files](std::size_t index) {
+        throwIfCancelled();
+
+        const auto fileIndex = group * _timepointsPerGroup + index;
+
+        files[index] = VTKPathlineStream::open(_filePaths[fileIndex], _manifest.files.empty() ? nullptr : &_manifest.files[fileIndex]);
+    });
+
+    return readResetPoint(files);
+}
+
+int VTKStudyLoader::readResetPoint(const std::vector<std::unique_ptr<VTKPathlineStream>>& files)
+{
+    std::vector<std::vector<std::array<float, 3>>> leadingPoints(files.size());
+
+    // Pathlines may be listed in a different order in every file, files that identify them are compared on the
+    // pathline of the first point of the first file.
+    auto& firstFile     = *files.front();
+    const auto idArray  = findIdArray(firstFile);
+
+    bool matchById = idArray != std::string::npos && firstFile.numberOfPoints() > 0 && firstFile.pointArraySize(idArray) >= firstFile.numberOfPoints();
+
+    if (matchById) {
+        int id = 0;
+
+        firstFile.readPointData(idArray, 1, &id);
+        firstFile.rewind();
+
+        std::vector<std::uint8_t> holdsLine(files.size(), 0);
+
+        ThreadPool::global().parallelFor(files.size(), [this, &files, &leadingPoints, &holdsLine, id](std::size_t index) {
+            throwIfCancelled();
+
+            holdsLine[index] = readLeadingLinePoints(*files[index], id, 6, leadingPoints[index]);
+        });
+
+        matchById = std::all_of(holdsLine.begin(), holdsLine.end(), [](std::uint8_t value) { return value != 0; });
+    }
+
+    if (!matchById) {
+        for (std::size_t index = 0; index < files.size(); index++) {
+            auto& points = leadingPoints[index];
+
+            points.resize(std::min<std::size_t>(6, files[index]->numberOfPoints()));
+
+            if (!points.empty())
+                files[index]->readPoints(points.size(), points.front().data());
+
+            files[index]->rewind();
+        }
+    }
+
+    return detectResetPoint(leadingPoints);
+}
+
+bool VTKStudyLoader::readLeadingLinePoints(VTKPathlineStream& file, int id, std::size_t count, std::vector<std::array<float, 3>>& points)
+{
+    const auto idArray = findIdArray(file);
+
+    if (idArray == std::string::npos || file.pointArraySize(idArray) < file.numberOfPoints())
+        return false;
+
+    std::vector<std::uint32_t> segmentSizes;
+    std::vector<int> ids;
+
+    std::size_t segmentIndex = 0;
+    std::size_t pointIndex = 0;
+    std::size_t lineSize = 0;
+    bool isFound = false;
+
+    // The ID of a segment is the ID of its first point, the IDs of the segments are read block by block until the
+    // pathline is found.
+    while (!isFound && segmentIndex < file.numberOfLines()) {
+        throwIfCancelled();
+
+        segmentSizes.resize(numberOfBlockSegments(file, segmentIndex, std::max(minimumBlockSize, _memoryLimit / bytesPerBlockPoint)));
+        file.readSegmentSizes(segmentSizes.size(), segmentSizes.data());
+
+        std::size_t numberOfPoints = 0;
+
+        for (const auto segmentSize : segmentSizes)
+            numberOfPoints += segmentSize;
+
+        // Broken files are reported by the load itself.
+        if (pointIndex + numberOfPoints > file.numberOfPoints())
+            break;
+
+        ids.resize(numberOfPoints);
+        file.readPointData(idArray, numberOfPoints, ids.data());
+
+        std::size_t segmentStart = 0;
+
+        for (std::size_t blockSegment = 0; blockSegment < segmentSizes.size() && !isFound; blockSegment++, segmentIndex++) {
+            if (segmentSizes[blockSegment] > 0 && ids[segmentStart] == id) {
+                isFound = true;
+                lineSize = segmentSizes[blockSegment];
+            }
+            else {
+                segmentStart += segmentSizes[blockSegment];
+            }
+        }
+
+        pointIndex += segmentStart;
+    }
+
+    file.rewind();
+
+    if (!isFound)
+        return false;
+
+    points.resize(std::min(count, lineSize));
+
+    file.skipPoints(pointIndex);
+    file.readPoints(points.size(), points.front().data());
+    file.rewind();
+
+    return true;
+}
+
+int VTKStudyLoader::detectResetPoint(const std::vector<std::vector<std::array<float, 3>>>& leadingPoints)
+{
+    int resetPoint = 0;
+
+    for (std::size_t fileIndex = 1; fileIndex < leadingPoints.size(); fileIndex++) {
+        const auto& points = leadingPoints[fileIndex];
+        const auto& previousPoints = leadingPoints[fileIndex - 1];
+
+        if (points.empty() || previousPoints.size() < 6)
+            continue;
+
+        if (points[0][0] != previousPoints[5][0] && points[0][1] != previousPoints[5][1] && points[0][2] != previousPoints[5][2])
+            resetPoint = static_cast<int>(fileIndex);
+    }
+
+    return resetPoint;
+}
+
+void VTKStudyLoader::allocatePathlines(const std::vector<std::unique_ptr<VTKPathlineStream>>& firstGroup, int numberOfGroups)
+{
+    const auto& firstTimepoint = *firstGroup.front();
+
+    if (firstTimepoint.numberOfLines() == 0)
+        throw std::runtime_error("The files do not contain any pathlines");
+
+    // Every pathline gets as many points as the first pathline of the study.
+    std::size_t lineSize = 0;
+
+    for (std::size_t index = 0; index < firstGroup.size(); index++)
+        if (firstGroup[index]->numberOfLines() > 0)
+            lineSize += segmentContribution(firstGroup[index]->firstSegmentSize(), static_cast<int>(index));
+
+    // Each selected group has one row per selected line cell of its first timepoint. Only the headers of the other
+    // groups are read.
+    std::vector<std::size_t> groupSizes(numberOfGroups, 0);
+
+    groupSizes[_groups.front()] = countSelectedLines(firstTimepoint.numberOfLines());
+
+    std::atomic<std::size_t> numberOfScannedGroups(1);
+
+    reportProgress(LoadPhase::Scan, 1, _groups.size());
+
+    ThreadPool::global().parallelFor(_groups.size() - 1, [this, &groupSizes, &numberOfScannedGroups](std::size_t index) {
+        throwIfCancelled();
+
+        const auto group = _groups[index + 1];
+        const auto& filePath = timepointFilePath(group, _firstTimepoint);
+
+        groupSizes[group] = countSelectedLines(readNumberOfLines(filePath));
+
+        reportProgress(LoadPhase::Scan, ++numberOfScannedGroups, _groups.size(), filePath);
+    });
+
+    _groupOffsets.assign(1, 0);
+
+    for (const auto groupSize : groupSizes)
+        _groupOffsets.push_back(_groupOffsets.back() + groupSize);
+
+    _study.numPoints        = _groupOffsets.back();
+    _study.lineSize         = lineSize;
+    _study.numDimensions    = lineSize * pathlineColumnNames.size();
+
+    _study.data.resize(_study.numPoints * _study.numDimensions);
+    _lineLengths.assign(_study.numPoints, 0);
+}
+
+void VTKStudyLoader::stitchGroup(const std::vector<std::unique_ptr<VTKPathlineStream>>& files, int group, std::atomic<std::size_t>& numberOfStitchedFiles)
+{
+    const auto groupOffset          = _groupOffsets[group];
+    const auto groupSize            = _groupOffsets[group + 1] - groupOffset;
+    const auto numberOfTimepoints   = files.size();
+    const auto& firstFilePath       = timepointFilePath(group, _firstTimepoint);
+
+    if (countSelectedLines(files.front()->numberOfLines()) != groupSize)
+        throw std::runtime_error(firstFilePath + ": the number of pathlines changed while loading");
+
+    _lineRows = selectLines(files.front()->numberOfLines(), group);
+
+    // Segments are matched to the rows of their pathline by ID when the first timepoint identifies its pathlines.
+    bool matchById;
+
+    {
+        LoadProfiler::Scope scope(_profiler, "index", 0, files.front()->numberOfLines());
+
+        matchById = buildPathlineIndex(*files.front(), firstFilePath);
+    }
+
+    // With equally sized segments every timepoint starts at the same position in all rows of the group. Matching by ID
+    // puts every segment in its own row, so the files may then also hold fewer or more pathlines.
+    std::vector<std::size_t> timepointOffsets(numberOfTimepoints + 1);
+
+    bool isUniform = true;
+    std::size_t rowOffset = 0;
+
+    for (std::size_t index = 0; index < numberOfTimepoints; index++) {
+        const auto& file = *files[index];
+
+        if (file.uniformSegmentSize() == 0 || (!matchById && file.numberOfLines() != _lineRows.size()))
+            isUniform = false;
+
+        timepointOffsets[index] = rowOffset;
+        rowOffset += segmentContribution(file.uniformSegmentSize(), static_cast<int>(index));
+    }
+
+    timepointOffsets[numberOfTimepoints] = rowOffset;
+
+    if (rowOffset != _study.lineSize)
+        isUniform = false;
+
+    // Rows of the group that received a segment, per timepoint.
+    std::vector<std::vector<std::uint8_t>> stitchedLines(matchById ? numberOfTimepoints : 0, std::vector<std::uint8_t>(groupSize, 0));
+
+    const auto numberOfFiles = _groups.size() * numberOfTimepoints;
+
+    const auto stitchTimepoint = [&](std::size_t index, std::size_t blockSize) {
+        throwIfCancelled();
+
+        const auto timepoint = _firstTimepoint + static_cast<int>(index);
+        const auto& filePath = timepointFilePath(group, timepoint);
+
+        LoadProfiler::Scope scope(_profiler, "stitch", 0, files[index]->numberOfPoints());
+
+        stitchPathlines(*files[index], filePath, timepoint, index == 0, group, isUniform ? timepointOffsets[index] : std::string::npos, blockSize, matchById ? &stitchedLines[index] : nullptr);
+
+        reportProgress(LoadPhase::Stitch, ++numberOfStitchedFiles, numberOfFiles, filePath);
+    };
+
+    if (isUniform) {
+
+        // The files write to disjoint columns of the rows, so they can be stitched in parallel. The memory limit is
+        // shared by the files that are streamed at the same time.
+        const auto concurrency  = std::min<std::size_t>(ThreadPool::global().size() + 1, numberOfTimepoints);
+        const auto blockSize    = std::max(minimumBlockSize, _memoryLimit / (concurrency * bytesPerBlockPoint));
+
+        ThreadPool::global().parallelFor(numberOfTimepoints, [&stitchTimepoint, blockSize](std::size_t index) {
+            stitchTimepoint(index, blockSize);
+        });
+
+        for (std::size_t line = 0; line < groupSize; line++) {
+            const auto row = groupOffset + line;
+
+            if (matchById && !stitchedLines[0][line])
+                continue;
+
+            // Pathlines that are missing from a later timepoint repeat the point before the gap.
+            if (matchById)
+                for (std::size_t index = 1; index < numberOfTimepoints; index++)
+                    if (!stitchedLines[index][line])
+                        repeatPoint(row, timepointOffsets[index], timepointOffsets[index + 1]);
+
+            _lineLengths[row] = _study.lineSize;
+        }
+    }
+    else {
+
+        // Stitch serially in time order, so the result is identical to a serial load.
+        const auto blockSize = std::max(minimumBlockSize, _memoryLimit / bytesPerBlockPoint);
+
+        for (std::size_t index = 0; index < numberOfTimepoints; index++)
+            stitchTimepoint(index, blockSize);
+
+        // Pathlines that are missing from some timepoints are completed with their last point.
+        if (matchById) {
+            for (std::size_t row = groupOffset; row < groupOffset + groupSize; row++) {
+                if (_lineLengths[row] == 0)
+                    continue;
+
+                repeatPoint(row, _lineLengths[row], _study.lineSize);
+
+                _lineLengths[row] = _study.lineSize;
+            }
+        }
+    }
+}
+
+bool VTKStudyLoader::buildPathlineIndex(VTKPathlineStream& firstTimepoint, const std::string& filePath)
+{
+    const auto idArray = findIdArray(firstTimepoint);
+
+    if (idArray == std::string::npos || firstTimepoint.pointArraySize(idArray) < firstTimepoint.numberOfPoints())
+        return false;
+
+    _pathlineIndex.reset(firstTimepoint.numberOfLines());
+
+    std::vector<std::uint32_t> segmentSizes;
+    std::vector<int> ids;
+
+    std::size_t segmentIndex = 0;
+    std::size_t pointIndex = 0;
+    bool isUnique = true;
+
+    // The ID of a segment is the ID of its first point.
+    while (isUnique && segmentIndex < firstTimepoint.numberOfLines()) {
+        throwIfCancelled();
+
+        segmentSizes.resize(numberOfBlockSegments(firstTimepoint, segmentIndex, std::max(minimumBlockSize, _memoryLimit / bytesPerBlockPoint)));
+        firstTimepoint.readSegmentSizes(segmentSizes.size(), segmentSizes.data());
+
+        std::size_t numberOfPoints = 0;
+
+        for (const auto segmentSize : segmentSizes)
+            numberOfPoints += segmentSize;
+
+        if (pointIndex + numberOfPoints > firstTimepoint.numberOfPoints())
+            throw std::runtime_error(filePath + ": line cells refer to more points than the file holds");
+
+        ids.resize(numberOfPoints);
+        firstTimepoint.readPointData(idArray, numberOfPoints, ids.data());
+
+        std::size_t segmentStart = 0;
+
+        for (std::size_t blockSegment = 0; blockSegment < segmentSizes.size() && isUnique; blockSegment++, segmentIndex++) {
+            if (segmentSizes[blockSegment] > 0)
+                isUnique = _pathlineIndex.insert(ids[segmentStart], segmentIndex);
+
+            segmentStart += segmentSizes[blockSegment];
+        }
+
+        pointIndex += numberOfPoints;
+    }
+
+    firstTimepoint.rewind();
+
+    if (!isUnique)
+        reportWarning(filePath + ": pathline IDs are not unique, segments are matched by position");
+
+    return isUnique;
+}
+
+std::size_t VTKStudyLoader::findIdArray(const VTKPathlineStream& file)
+{
+    for (std::size_t arrayIndex = 0; arrayIndex < file.numberOfPointArrays(); arrayIndex++)
+        if (file.pointArrayName(arrayIndex) == "ID")
+            return arrayIndex;
+
+    return std::string::npos;
+}
+
+std::size_t VTKStudyLoader::numberOfBlockSegments(const VTKPathlineStream& file, std::size_t segmentIndex, std::size_t blockSize)
+{
+    // Take as many segments as fit in the block, or a single segment that is larger than a block.
+    const auto expectedSegmentSize = std::max<std::size_t>(file.firstSegmentSize(), 1);
+
+    return std::min(file.numberOfLines() - segmentIndex, std::max<std::size_t>(blockSize / expectedSegmentSize, 1));
+}
+
+void VTKStudyLoader::stitchPathlines(VTKPathlineStream& file, const std::string& filePath, int timepoint, bool startsLines, int group, std::size_t rowOffset, std::size_t blockSize, std::vector<std::uint8_t>* stitchedLines)
+{
+    // The first point data array holds the indices of pathlines, the second the velocity magnitude along the pathlines.
+    if (file.numberOfPointArrays() < 2)
+        throw std::runtime_error(filePath + ": missing line index or speed data");
+
+    if (file.pointArraySize(0) < file.numberOfPoints() || file.pointArraySize(1) < file.numberOfPoints())
+        throw std::runtime_error(filePath + ": point data does not cover all points");
+
+    // Segments matched by ID need the ID array of every file.
+    const auto idArray = stitchedLines != nullptr ? findIdArray(file) : std::string::npos;
+
+    if (stitchedLines != nullptr && (idArray == std::string::npos || file.pointArraySize(idArray) < file.numberOfPoints()))
+        throw std::runtime_error(filePath + ": missing pathline ID data");
+
+    const auto groupOffset = _groupOffsets[group];
+
+    // Block buffers, reused for every block of the file and then for the next file.
+    auto blockBuffers = acquireBlockBuffers();
+
+    auto& segmentSizes  = blockBuffers->segmentSizes;
+    auto& segmentRows   = blockBuffers->segmentRows;
+    auto& positions     = blockBuffers->positions;
+    auto& lineIndex     = blockBuffers->lineIndex;
+    auto& speed         = blockBuffers->speed;
+    auto& ids           = blockBuffers->ids;
+
+    std::size_t segmentIndex = 0;
+    std::size_t pointIndex = 0;
+    std::size_t numberOfUnknownLines = 0;
+
+    while (segmentIndex < file.numberOfLines()) {
+        throwIfCancelled();
+
+        const auto numberOfSegments = numberOfBlockSegments(file, segmentIndex, blockSize);
+
+        segmentSizes.resize(numberOfSegments);
+        file.readSegmentSizes(numberOfSegments, segmentSizes.data());
+
+        std::size_t numberOfPoints = 0;
+
+        for (const auto segmentSize : segmentSizes)
+            numberOfPoints += segmentSize;
+
+        if (pointIndex + numberOfPoints > file.numberOfPoints())
+            throw std::runtime_error(filePath + ": line cells refer to more points than the file holds");
+
+        if (stitchedLines != nullptr) {
+            ids.resize(numberOfPoints);
+            file.readPointData(idArray, numberOfPoints, ids.data());
+        }
+
+        // Find the row of every segment, by the ID of its first point or by its position in the file. Segments of
+        // pathlines that are not selected get no row.
+        segmentRows.resize(numberOfSegments);
+
+        std::size_t numberOfLoadedPoints = 0;
+        std::size_t firstPoint = 0;
+
+        for (std::size_t blockSegment = 0; blockSegment < numberOfSegments; blockSegment++) {
+            const std::size_t segmentSize = segmentSizes[blockSegment];
+            auto& row = segmentRows[blockSegment];
+
+            // Empty segments have no first point and get no row.
+            row = std::string::npos;
+
+            if (segmentSize > 0 && stitchedLines != nullptr) {
+                const auto line = _pathlineIndex.find(ids[firstPoint]);
+
+                if (line == PathlineIndex::notFound)
+                    numberOfUnknownLines++;
+                else
+                    row = _lineRows[line];
+
+                if (row != std::string::npos) {
+                    if ((*stitchedLines)[row])
+                        throw std::runtime_error(filePath + ": pathline ID " + std::to_string(ids[firstPoint]) + " appears more than once");
+
+                    (*stitchedLines)[row] = 1;
+                }
+            }
+            else if (segmentSize > 0) {
+                if (segmentIndex + blockSegment >= _lineRows.size())
+                    throw std::runtime_error(filePath + ": holds more pathlines than the first timepoint of its group");
+
+                row = _lineRows[segmentIndex + blockSegment];
+            }
+
+            if (row != std::string::npos)
+                numberOfLoadedPoints += segmentSize;
+
+            firstPoint += segmentSize;
+        }
+
+        // Read the points of the selected segments in runs, the others are skipped without converting them.
+        {
+            LoadProfiler::Scope scope(_profiler, "decode", 5 * sizeof(float) * numberOfLoadedPoints, numberOfLoadedPoints);
+
+            positions.resize(3 * numberOfLoadedPoints);
+            lineIndex.resize(numberOfLoadedPoints);
+            speed.resize(numberOfLoadedPoints);
+
+            std::size_t loadedPoint = 0;
+
+            for (std::size_t blockSegment = 0; blockSegment < numberOfSegments; ) {
+                const auto isLoaded = segmentRows[blockSegment] != std::string::npos;
+
+                std::size_t runSize = 0;
+
+                for (; blockSegment < numberOfSegments && (segmentRows[blockSegment] != std::string::npos) == isLoaded; blockSegment++)
+                    runSize += segmentSizes[blockSegment];
+
+                if (isLoaded) {
+                    file.readPoints(runSize, positions.data() + 3 * loadedPoint);
+                    file.readPointData(0, runSize, lineIndex.data() + loadedPoint);
+                    file.readPointData(1, runSize, speed.data() + loadedPoint);
+
+                    loadedPoint += runSize;
+                }
+                else {
+                    file.skipPoints(runSize);
+                    file.skipPointData(0, runSize);
+                    file.skipPointData(1, runSize);
+                }
+            }
+        }
+
+        std::size_t segmentStart = 0;
+
+        for (std::size_t blockSegment = 0; blockSegment < numberOfSegments; blockSegment++) {
+            if (segmentRows[blockSegment] == std::string::npos)
+                continue;
+
+            const std::size_t segmentSize = segmentSizes[blockSegment];
+            const auto row = groupOffset + segmentRows[blockSegment];
+
+            // Rows are either filled at a known position or appended to, depending on how the group is stitched.
+            std::size_t fixedLength = rowOffset;
+            auto& lineLength = rowOffset != std::string::npos ? fixedLength : _lineLengths[row];
+
+            // Writes a point of the block to the end of the pathline row.
+            const auto appendPoint = [&](std::size_t blockPoint) {
+                if (lineLength == _study.lineSize)
+                    throw std::runtime_error("Pathlines have different numbers of points");
+
+                auto* values = _study.data.data() + row * _study.numDimensions + lineLength * pathlineColumnNames.size();
+
+                values[0] = positions[3 * blockPoint];
+                values[1] = positions[3 * blockPoint + 1];
+                values[2] = positions[3 * blockPoint + 2];
+                values[3] = speed[blockPoint];
+                values[4] = lineIndex[blockPoint];
+                values[5] = float(timepoint);
+                values[6] = float(group);
+
+                lineLength++;
+            };
+
+            // The first timepoint starts the pathlines, later timepoints extend them.
+            if (startsLines) {
+                for (std::size_t j = 0; j < segmentSize; j++)
+                    appendPoint(segmentStart + j);
+            }
+            else {
+
+                // The first three points overlap with the previous timepoint, short segments are padded with their last
+                // point. Segments without points beyond the overlap are padded with their first point instead.
+                for (std::size_t j = segmentOverlap; j < segmentSize; j++)
+                    appendPoint(segmentStart + j);
+
+                if (segmentSize < segmentPoints) {
+                    auto padding = segmentPoints - segmentSize;
+
+                    if (segmentSize <= segmentOverlap) {
+                        appendPoint(segmentStart);
+                        padding--;
+                    }
+
+                    const auto paddingEnd = lineLength + padding;
+
+                    if (paddingEnd > _study.lineSize)
+                        throw std::runtime_error("Pathlines have different numbers of points");
+
+                    ::repeatPoint(_study.data.data() + row * _study.numDimensions, pathlineColumnNames.size(), lineLength - 1, lineLength, paddingEnd);
+
+                    lineLength = paddingEnd;
+                }
+            }
+
+            segmentStart += segmentSize;
+        }
+
+        segmentIndex += numberOfSegments;
+        pointIndex += numberOfPoints;
+    }
+
+    releaseBlockBuffers(std::move(blockBuffers));
+
+    if (numberOfUnknownLines > 0)
+        reportWarning(filePath + ": skipped " + std::to_string(numberOfUnknownLines) + " pathlines that are not in the first timepoint of the group");
+}
+
+std::unique_ptr<VTKStudyLoader::BlockBuffers> VTKStudyLoader::acquireBlockBuffers()
+{
+    std::lock_guard<std::mutex> lock(_blockBuffersMutex);
+
+    if (_idleBlockBuffers.empty())
+        return std::make_unique<BlockBuffers>();
+
+    auto blockBuffers = std::move(_idleBlockBuffers.back());
+
+    _idleBlockBuffers.pop_back();
+
+    return blockBuffers;
+}
+
+void VTKStudyLoader::releaseBlockBuffers(std::unique_ptr<BlockBuffers> blockBuffers)
+{
+    std::lock_guard<std::mutex> lock(_blockBuffersMutex);
+
+    _idleBlockBuffers.push_back(std::move(blockBuffers));
+}
+
+void VTKStudyLoader::repeatPoint(std::size_t row, std::size_t begin, std::size_t end)
+{
+    if (begin == 0)
+        return;
+
+    ::repeatPoint(_study.data.data() + row * _study.numDimensions, pathlineColumnNames.size(), begin - 1, begin, end);
+}
+
+void VTKStudyLoader::loadVoxelMask(const std::array<int, 3>& dimensions)
+{
+    _voxelMask.clear();
+
+    if (_selection.maskFilePath.empty())
+        return;
+
+    const auto mask = readFile(_selection.maskFilePath);
+    const auto* maskValues = mask.findPointData(1);
+
+    if (mask.dimensions != dimensions)
+        throw std::runtime_error(_selection.maskFilePath + ": the mask grid differs from the grid of the study");
+
+    const auto numberOfVoxels = static_cast<std::size_t>(dimensions[0]) * dimensions[1] * dimensions[2];
+
+    if (maskValues == nullptr || maskValues->size() < numberOfVoxels)
+        throw std::runtime_error(_selection.maskFilePath + ": missing mask data");
+
+    _voxelMask.resize(numberOfVoxels);
+
+    for (std::size_t voxelIndex = 0; voxelIndex < numberOfVoxels; voxelIndex++)
+        _voxelMask[voxelIndex] = maskValues->valueAt(voxelIndex) != 0.0f ? 1 : 0;
+}
+
+void VTKStudyLoader::appendVolume(const VTKData& file, const std::string& filePath, int timepoint)
+{
+    const auto* velocityMagnitude   = file.findPointData(1);
+    const auto* velocityVector      = file.findPointData(3);
+
+    if (velocityMagnitude == nullptr || velocityVector == nullptr)
+        throw std::runtime_error(filePath + ": missing velocity magnitude or velocity vector data");
+
+    const auto& dimensions = file.dimensions;
+    const auto sliceSize = static_cast<std::size_t>(dimensions[0]) * dimensions[1];
+    const auto numberOfVoxels = sliceSize * dimensions[2];
+
+    if (!file.points.empty() && file.points.size() < numberOfVoxels)
+        throw std::runtime_error(filePath + ": fewer points than voxels");
+
+    if (velocityMagnitude->size() < numberOfVoxels || velocityVector->size() < 3 * numberOfVoxels)
+        throw std::runtime_error(filePath + ": velocity data does not cover all voxels");
+
+    const auto isMasked     = _selection.masksVolumes();
+    const auto minimumSpeed = _selection.minimumSpeed;
+    const auto numColumns   = volumeColumnNames.size();
+
+    // Rows are identified by their voxel index, so every file of a masked study has to share the grid.
+    if (isMasked && dimensions != _study.volumeDimensions)
+        throw std::runtime_error(filePath + ": the grid differs from the grid of the first file of the study");
+
+    if (isMasked && numberOfVoxels > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error(filePath + ": the grid holds too many voxels to be masked");
+
+    // Voxels outside the mask or below the speed threshold are background.
+    const auto isLoaded = [&](std::size_t voxelIndex) {
+        if (!_voxelMask.empty() && !_voxelMask[voxelIndex])
+            return false;
+
+        return minimumSpeed <= 0.0f || velocityMagnitude->valueAt(voxelIndex) >= minimumSpeed;
+    };
+
+    // The rows of the z slices follow each other, count the rows of every slice to find where each one starts.
+    std::vector<std::size_t> sliceRows(dimensions[2] + 1, sliceSize);
+
+    sliceRows[0] = 0;
+
+    if (isMasked) {
+        ThreadPool::global().parallelFor(dimensions[2], [&](std::size_t z) {
+            std::size_t numberOfRows = 0;
+
+            for (auto voxelIndex = z * sliceSize; voxelIndex < (z + 1) * sliceSize; voxelIndex++)
+                numberOfRows += isLoaded(voxelIndex) ? 1 : 0;
+
+            sliceRows[z + 1] = numberOfRows;
+        });
+    }
+
+    std::partial_sum(sliceRows.begin(), sliceRows.end(), sliceRows.begin());
+
+    const auto numberOfRows = sliceRows.back();
+    const auto firstRow     = _volumeOffset / numColumns;
+
+    if (isMasked) {
+        _study.data.resize(_volumeOffset + numberOfRows * numColumns);
+        _study.voxelIndices.resize(firstRow + numberOfRows);
+    }
+    else if (_volumeOffset + numberOfRows * numColumns > _study.data.size()) {
+        throw std::runtime_error(filePath + ": holds more voxels than the first file of the study");
+    }
+
+    ThreadPool::global().parallelFor(dimensions[2], [&](std::size_t z) {
+        auto* values = _study.data.data() + _volumeOffset + sliceRows[z] * numColumns;
+        auto row = firstRow + sliceRows[z];
+        auto voxelIndex = z * sliceSize;
+
+        for (int y = 0; y < dimensions[1]; y++) {
+            for (int x = 0; x < dimensions[0]; x++, voxelIndex++) {
+                if (isMasked) {
+                    if (!isLoaded(voxelIndex))
+                        continue;
+
+                    _study.voxelIndices[row++] = static_cast<std::uint32_t>(voxelIndex);
+                }
+
+                // Structured points files describe the voxel locations by their grid instead of a POINTS section.
+                if (file.points.empty()) {
+                    *values++ = file.origin[0] + x * file.spacing[0];
+                    *values++ = file.origin[1] + y * file.spacing[1];
+                    *values++ = file.origin[2] + static_cast<int>(z) * file.spacing[2];
+                }
+                else {
+                    values = std::copy(file.points[voxelIndex].begin(), file.points[voxelIndex].end(), values);
+                }
+
+                *values++ = velocityMagnitude->valueAt(voxelIndex);
+
+                for (std::size_t component = 0; component < 3; component++)
+                    *values++ = velocityVector->valueAt(3 * voxelIndex + component);
+
+                *values++ = float(timepoint);
+            }
+        }
+    });
+
+    _volumeOffset += numberOfRows * numColumns;
+
+    _study.data.release(firstRow * numColumns, _volumeOffset);
+}
+
+void VTKStudyLoader::resamplePathlines()
+{
+    for (const auto lineLength : _lineLengths)
+        if (lineLength != _study.lineSize)
+            throw std::runtime_error("Pathlines have different numbers of points");
+
+    const auto numColumns       = pathlineColumnNames.size();
+    const auto numDimensions    = _resampledLineSize * numColumns;
+
+    // Rows are resampled in blocks, in parallel, into a new matrix.
+    StudyMatrix data;
+
+    data.setMemoryBudget(matrixMemoryBudget(_study.data.isSpilled() ? 0 : _study.data.size() * sizeof(float)), _scratchDirectory);
+    data.resize(_study.numPoints * numDimensions);
+
+    const std::size_t blockSize = 4096;
+    const auto numberOfBlocks = (_study.numPoints + blockSize - 1) / blockSize;
+
+    ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+        throwIfCancelled();
+
+        std::vector<double> arcLengths(_study.lineSize);
+
+        const auto firstRow = blockIndex * blockSize;
+        const auto endRow   = std::min(firstRow + blockSize, _study.numPoints);
+
+        for (auto row = firstRow; row < endRow; row++)
+            resampleByArcLength(_study.data.data() + row * _study.numDimensions, numColumns, _study.lineSize, _resampledLineSize, arcLengths.data(), data.data() + row * numDimensions);
+
+        _study.data.release(firstRow * _study.numDimensions, endRow * _study.numDimensions);
+        data.release(firstRow * numDimensions, endRow * numDimensions);
+    });
+
+    _study.data             = std::move(data);
+    _study.lineSize         = _resampledLineSize;
+    _study.numDimensions    = numDimensions;
+
+    _lineLengths.assign(_study.numPoints, _resampledLineSize);
+}
+
+void VTKStudyLoader::indexPathlines(LoadedStudy& study) const
+{
+    LoadProfiler::Scope scope(_profiler, "spatial index", 3 * sizeof(float) * study.numPoints * study.lineSize, study.numPoints * study.lineSize);
+
+    study.pathlineGrid = PathlineGrid::build(study.data.data(), study.numPoints, study.numDimensions, study.lineSize);
+}
+
+void VTKStudyLoader::computeDifferences(std::size_t firstPoint)
+{
+    for (const auto lineLength : _lineLengths)
+        if (lineLength != _study.lineSize)
+            throw std::runtime_error("Pathlines have different numbers of points");
+
+    // The point before the first one changes from the last point of its line, which reuses the vector towards it, to
+    // a point with a successor.
+    const auto startPoint   = firstPoint > 0 ? std::min(firstPoint - 1, _study.lineSize) : 0;
+    const auto numColumns   = pathlineColumnNames.size();
+    const auto lineSize     = _study.lineSize - startPoint;
+
+    // Rows are processed in blocks, in parallel. Progress is reported and cancellation is checked between blocks.
+    const std::size_t blockSize = 4096;
+    const auto numberOfBlocks = (_study.numPoints + blockSize - 1) / blockSize;
+
+    std::atomic<std::size_t> numberOfDerivedRows(0);
+
+    ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+        throwIfCancelled();
+
+        // Positions, difference vectors and speeds of one row as separate arrays.
+        std::vector<float> columns(7 * lineSize);
+
+        float* positions[3]     = { columns.data(), columns.data() + lineSize, columns.data() + 2 * lineSize };
+        float* differences[3]   = { columns.data() + 3 * lineSize, columns.data() + 4 * lineSize, columns.data() + 5 * lineSize };
+        float* speed            = columns.data() + 6 * lineSize;
+
+        const auto firstRow = blockIndex * blockSize;
+        const auto endRow   = std::min(firstRow + blockSize, _study.numPoints);
+
+        for (auto row = firstRow; row < endRow; row++) {
+            auto* line = _study.data.data() + row * _study.numDimensions + startPoint * numColumns;
+
+            // Calculate the vectors at timepoints, the last point reuses the vector towards it.
+            gatherColumns(line, numColumns, 0, lineSize, positions[0], positions[1], positions[2]);
+
+            for (std::size_t component = 0; component < 3; component++)
+                computeForwardDifferences(positions[component], lineSize, differences[component]);
+
+            scatterColumns(differences[0], differences[1], differences[2], lineSize, numColumns, 7, line);
+
+            if (_derivedSpeed) {
+                computeMagnitudes(differences[0], differences[1], differences[2], lineSize, speed);
+                scatterColumn(speed, lineSize, numColumns, 3, line);
+            }
+        }
+
+        _study.data.release(firstRow * _study.numDimensions, endRow * _study.numDimensions);
+
+        reportProgress(LoadPhase::Derive, numberOfDerivedRows += endRow - firstRow, _study.numPoints);
+    });
+
+    reportProgress(LoadPhase::Derive, _study.numPoints, _study.numPoints);
+}
+
+void VTKStudyLoader::append(LoadedStudy& study, const std::vector<std::string>& filePaths)
+{
+    if (filePaths.empty())
+        return;
+
+    // A study served from the cache left no layout behind, it is recovered from the headers of the study files.
+    if (_groups.empty())
+        restoreLayout(study);
+
+    if (_resampledLineSize > 0)
+        throw std::runtime_error("Timepoints can not be appended to resampled pathlines");
+
+    if (filePaths.size() % _groups.size() != 0)
+        throw std::runtime_error("Expected the same number of new files for each of the " + std::to_string(_groups.size()) + " loaded groups, got " + std::to_string(filePaths.size()) + " files");
+
+    _cancelled  = false;
+    _study      = std::move(study);
+
+    _study.data.setMemoryBudget(matrixMemoryBudget(), _scratchDirectory);
+
+    const auto numberOfNewTimepoints = static_cast<int>(filePaths.size() / _groups.size());
+
+    // The new files continue the timepoints of the study, in the order of the selected groups.
+    std::vector<std::vector<std::string>> groupFilePaths(_groups.size());
+
+    for (std::size_t groupIndex = 0; groupIndex < _groups.size(); groupIndex++)
+        groupFilePaths[groupIndex].assign(filePaths.begin() + groupIndex * numberOfNewTimepoints, filePaths.begin() + (groupIndex + 1) * numberOfNewTimepoints);
+
+    const auto firstNewTimepoint = _lastTimepoint + 1 + _numberOfAppendedTimepoints;
+
+    // The new rows of a volume study follow the rows it holds, which may be fewer than were loaded.
+    if (!_study.isPathlines)
+        _volumeOffset = _study.numPoints * _study.numDimensions;
+
+    if (_study.isPathlines)
+        appendPathlines(groupFilePaths, firstNewTimepoint);
+    else
+        appendVolumes(groupFilePaths, firstNewTimepoint);
+
+    _numberOfAppendedTimepoints += numberOfNewTimepoints;
+
+    study = std::move(_study);
+}
+
+void VTKStudyLoader::restoreLayout(const LoadedStudy& study)
+{
+    if (_filePaths.empty())
+        throw std::runtime_error("The study has no files");
+
+    // The files were checked when the study was loaded, their names still tell the groups.
+    _timepointsPerGroup = StudyManifest::groupSize(_filePaths);
+
+    const int numberOfGroups = static_cast<int>(_filePaths.size()) / _timepointsPerGroup;
+
+    resolveSelection(numberOfGroups);
+
+    if (!study.isPathlines) {
+        if (_selection.masksVolumes())
+            loadVoxelMask(study.volumeDimensions);
+
+        return;
+    }
+
+    _resetPoint = readResetPoint(_groups.front());
+
+    // Each selected group has one row per selected line cell of its first timepoint, as when loading.
+    std::vector<std::size_t> groupSizes(numberOfGroups, 0);
+
+    ThreadPool::global().parallelFor(_groups.size(), [this, &groupSizes](std::size_t index) {
+        const auto group = _groups[index];
+
+        groupSizes[group] = countSelectedLines(readNumberOfLines(timepointFilePath(group, _firstTimepoint)));
+    });
+
+    _groupOffsets.assign(1, 0);
+
+    for (const auto groupSize : groupSizes)
+        _groupOffsets.push_back(_groupOffsets.back() + groupSize);
+
+    if (_groupOffsets.back() != study.numPoints)
+        throw std::runtime_error("The study files no longer match the loaded study");
+}
+
+void VTKStudyLoader::appendPathlines(const std::vector<std::vector<std::string>>& groupFilePaths, int firstNewTimepoint)
+{
+    const auto previousLineSize = _study.lineSize;
+
+    std::atomic<std::size_t> numberOfOpenedFiles(0);
+    std::atomic<std::size_t> numberOfStitchedFiles(0);
+
+    for (std::size_t groupIndex = 0; groupIndex < _groups.size(); groupIndex++) {
+        const auto group = _groups[groupIndex];
+        const auto& filePaths = groupFilePaths[groupIndex];
+        const auto numberOfFiles = _groups.size() * filePaths.size();
+
+        std::vector<std::unique_ptr<VTKPathlineStream>> files(filePaths.size());
+
+        ThreadPool::global().parallelFor(files.size(), [&](std::size_t index) {
+            throwIfCancelled();
+
+            LoadProfiler::Scope scope(_profiler, "open", fileSize(filePaths[index]));
+
+            files[index] = VTKPathlineStream::open(filePaths[index]);
+
+            scope.addElements(files[index]->numberOfPoints());
+
+            reportProgress(LoadPhase::Parse, ++numberOfOpenedFiles, numberOfFiles, filePaths[index]);
+        });
+
+        // The new files of the first group determine how many points the pathlines gain, every row is widened once.
+        if (groupIndex == 0) {
+            auto lineSize = previousLineSize;
+
+            for (const auto& file : files)
+                if (file->numberOfLines() > 0)
+                    lineSize += segmentContribution(file->firstSegmentSize(), 1);
+
+            widenPathlines(lineSize);
+        }
+
+        LoadProfiler::Scope scope(_profiler, "stitch");
+
+        const auto groupOffset  = _groupOffsets[group];
+        const auto groupSize    = _groupOffsets[group + 1] - groupOffset;
+
+        // Segments are matched to the rows of their pathline through the first timepoint, as when loading.
+        const auto& firstFilePath = timepointFilePath(group, _firstTimepoint);
+        const auto firstTimepoint = VTKPathlineStream::open(firstFilePath);
+
+        if (countSelectedLines(firstTimepoint->numberOfLines()) != groupSize)
+            throw std::runtime_error(firstFilePath + ": the number of pathlines changed since the study was loaded");
+
+        _lineRows = selectLines(firstTimepoint->numberOfLines(), group);
+
+        const auto matchById = buildPathlineIndex(*firstTimepoint, firstFilePath);
+
+        std::fill(_lineLengths.begin() + groupOffset, _lineLengths.begin() + groupOffset + groupSize, previousLineSize);
+
+        const auto blockSize = std::max(minimumBlockSize, _memoryLimit / bytesPerBlockPoint);
+
+        for (std::size_t index = 0; index < files.size(); index++) {
+            throwIfCancelled();
+
+            std::vector<std::uint8_t> stitchedLines(matchById ? groupSize : 0, 0);
+
+            stitchPathlines(*files[index], filePaths[index], firstNewTimepoint + static_cast<int>(index), false, group, std::string::npos, blockSize, matchById ? &stitchedLines : nullptr);
+
+            // Pathlines that are missing from the file repeat their last point in its place.
+            if (matchById) {
+                const auto contribution = segmentContribution(files[index]->firstSegmentSize(), 1);
+
+                for (std::size_t line = 0; line < groupSize; line++) {
+                    auto& lineLength = _lineLengths[groupOffset + line];
+
+                    if (stitchedLines[line])
+                        continue;
+
+                    const auto end = std::min(lineLength + contribution, _study.lineSize);
+
+                    repeatPoint(groupOffset + line, lineLength, end);
+
+                    lineLength = end;
+                }
+            }
+
+            files[index].reset();
+
+            reportProgress(LoadPhase::Stitch, ++numberOfStitchedFiles, numberOfFiles, filePaths[index]);
+        }
+    }
+
+    _idleBlockBuffers.clear();
+
+    {
+        LoadProfiler::Scope scope(_profiler, "derive", 6 * sizeof(float) * _study.numPoints * (_study.lineSize - previousLineSize), _study.numPoints * (_study.lineSize - previousLineSize));
+
+        computeDifferences(previousLineSize);
+    }
+
+    // The spatial index grows by the boxes of the new points, a study that lost its index is indexed in full.
+    if (!_study.pathlineGrid.empty() && _study.pathlineGrid.numberOfLines() == _study.numPoints) {
+        const auto numberOfNewPoints = _study.numPoints * (_study.lineSize - previousLineSize);
+
+        LoadProfiler::Scope scope(_profiler, "spatial index", 3 * sizeof(float) * numberOfNewPoints, numberOfNewPoints);
+
+        _study.pathlineGrid.extend(_study.data.data(), _study.numDimensions, _study.lineSize, previousLineSize);
+    }
+    else {
+        indexPathlines(_study);
+    }
+
+    // Add the names of the new dimensions.
+    for (auto pointIndex = previousLineSize; pointIndex < _study.lineSize; pointIndex++)
+        for (const auto columnName : pathlineColumnNames)
+            _study.dimensionNames.push_back(columnName + std::to_string(pointIndex));
+}
+
+void VTKStudyLoader::widenPathlines(std::size_t lineSize)
+{
+    const auto previousDimensions   = _study.numDimensions;
+    const auto numDimensions        = lineSize * pathlineColumnNames.size();
+
+    if (lineSize < _study.lineSize)
+        throw std::runtime_error("Pathlines can not lose points");
+
+    LoadProfiler::Scope scope(_profiler, "widen", _study.numPoints * previousDimensions * sizeof(float), _study.numPoints);
+
+    _study.data.resize(_study.numPoints * numDimensions);
+
+    // Rows only move towards the end, so moving them back to front never overwrites a row that has yet to move.
+    for (auto row = _study.numPoints; row-- > 1; )
+        std::memmove(_study.data.data() + row * numDimensions, _study.data.data() + row * previousDimensions, previousDimensions * sizeof(float));
+
+    _study.numDimensions    = numDimensions;
+    _study.lineSize         = lineSize;
+
+    _lineLengths.assign(_study.numPoints, 0);
+}
+
+void VTKStudyLoader::appendVolumes(const std::vector<std::vector<std::string>>& groupFilePaths, int firstNewTimepoint)
+{
+    std::atomic<std::size_t> numberOfParsedFiles(0);
+    std::size_t numberOfStitchedFiles = 0;
+
+    for (const auto& filePaths : groupFilePaths) {
+        const auto numberOfFiles = groupFilePaths.size() * filePaths.size();
+
+        std::vector<VTKData> files(filePaths.size());
+
+        ThreadPool::global().parallelFor(files.size(), [&](std::size_t index) {
+            throwIfCancelled();
+
+            LoadProfiler::Scope scope(_profiler, "parse", fileSize(filePaths[index]));
+
+            files[index] = readFile(filePaths[index]);
+
+            reportProgress(LoadPhase::Parse, ++numberOfParsedFiles, numberOfFiles, filePaths[index]);
+        });
+
+        for (std::size_t index = 0; index < files.size(); index++) {
+            throwIfCancelled();
+
+            LoadProfiler::Scope scope(_profiler, "stitch");
+
+            // Masked volumes grow by the rows that pass the mask, unmasked volumes by a row per voxel.
+            if (!_selection.masksVolumes()) {
+                const auto& dimensions = files[index].dimensions;
+
+                _study.data.resize(_volumeOffset + static_cast<std::size_t>(dimensions[0]) * dimensions[1] * dimensions[2] * volumeColumnNames.size());
+            }
+
+            appendVolume(files[index], filePaths[index], firstNewTimepoint + static_cast<int>(index));
+
+            files[index] = VTKData();
+
+            reportProgress(LoadPhase::Stitch, ++numberOfStitchedFiles, numberOfFiles, filePaths[index]);
+        }
+    }
+
+    _study.data.resize(_volumeOffset);
+    _study.numPoints = _volumeOffset / _study.numDimensions;
+}
+
+void VTKStudyLoader::reportProgress(LoadPhase phase, std::size_t completed, std::size_t total, const std::string& filePath)
+{
+    if (!_progressCallback)
+        return;
+
+    LoadProgress progress;
+
+    progress.phase      = phase;
+    progress.completed  = completed;
+    progress.total      = total;
+    progress.filePath   = filePath;
+
+    std::lock_guard<std::mutex> lock(_progressMutex);
+
+    _progressCallback(progress);
+}
+
+void VTKStudyLoader::reportWarning(const std::string& message)
+{
+    if (!_warningCallback)
+        return;
+
+    std::lock_guard<std::mutex> lock(_warningMutex);
+
+    _warningCallback(message);
+}
+
+void VTKStudyLoader::throwIfCancelled() const
+{
+    if (_cancelled)
+        throw LoadCancelled();
+}
@@ -0,0 +1,465 @@
+#pragma once
+
+#include "VTKData.h"
+#include "VTKPathlineStream.h"
+#include "PathlineIndex.h"
+#include "LoadProfiler.h"
+#include "StudyMatrix.h"
+#include "PathlineGrid.h"
+#include "StudyManifest.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Study loader
+// =============================================================================
+
+/**
+ * Result of loading a study: a row major data matrix plus the names of its columns. The matrix lives in a scratch
+ * file when it exceeds the memory budget of the loader (see VTKStudyLoader::setMemoryBudget()).
+ */
+struct LoadedStudy
+{
+    StudyMatrix                 data;
+    std::size_t                 numPoints = 0;
+    std::size_t                 numDimensions = 0;
+    std::vector<std::string>    dimensionNames;
+    bool                        isPathlines = false;
+    std::size_t                 lineSize = 0;           /** Number of points per pathline */
+    std::array<int, 3>          volumeDimensions = { 0, 0, 0 };     /** Grid dimensions of volume studies */
+    std::vector<std::uint32_t>  voxelIndices;           /** Grid index (x + width * (y + height * z)) of the voxel of every row of a masked volume study, empty when all voxels are loaded */
+    PathlineGrid                pathlineGrid;           /** Spatial index of the rows of a pathline study, empty for volume studies */
+};
+
+/** Phases of loading a study */
+enum class LoadPhase
+{
+    Scan,       /** Reading the headers that size the data matrix */
+    Parse,      /** Parsing the files */
+    Stitch,     /** Writing the points of the files into the data matrix */
+    Derive      /** Computing the difference vectors */
+};
+
+/** Progress of one phase of loading a study */
+struct LoadProgress
+{
+    LoadPhase       phase = LoadPhase::Scan;
+    std::size_t     completed = 0;          /** Number of finished steps (files, or rows when deriving) */
+    std::size_t     total = 0;              /** Number of steps of the phase */
+    std::string     filePath;               /** File of the step that finished, if any */
+};
+
+/**
+ * Part of a study to load, everything by default.
+ * Files outside the selected groups and timepoints are never opened, and the points of pathlines that are not
+ * selected are skipped without being converted. Volume studies may be masked, after which only the voxels inside
+ * the mask and above the speed threshold get a row.
+ */
+struct LoadSelection
+{
+    std::vector<int>    groups;                 /** Indices of the groups to load, all groups when empty */
+    int                 firstTimepoint = 0;     /** First timepoint to load, it starts the pathlines */
+    int                 lastTimepoint = -1;     /** Last timepoint to load, negative loads through the last timepoint */
+    std::size_t         lineStride = 1;         /** Load every lineStride-th pathline of each group */
+    std::size_t         sampleSize = 0;         /** Load a random sample of this many of those pathlines per group, zero loads all of them */
+    std::uint32_t       seed = 1;               /** Seed of the random sample */
+    float               minimumSpeed = 0.0f;    /** Load only the voxels of volume studies with at least this velocity magnitude, zero loads all voxels */
+    std::string         maskFilePath;           /** UTF-8 encoded path of a volume file whose first scalar array is nonzero for the voxels to load, empty loads all voxels */
+
+    /** Whether only part of the voxels of volume studies is loaded */
+    bool masksVolumes() const { return minimumSpeed > 0.0f || !maskFilePath.empty(); }
+
+    /** Text that identifies the selection, empty when everything is selected */
+    std::string key() const;
+};
+
+/** Thrown by VTKStudyLoader::load when loading was cancelled */
+class LoadCancelled : public std::runtime_error
+{
+public:
+    LoadCancelled() : std::runtime_error("Loading was cancelled") { }
+};
+
+/**
+ * Loads a study, a series of VTK files made up of groups (flow components) that each hold the same number of
+ * timepoints, 30 in the studies the loader was written for.
+ *
+ * Before any values are read, the headers of all files are scanned into a StudyManifest, which checks the files
+ * against each other, tells the groups and timepoints from the file names and locates the sections of every file.
+ *
+ * Pathline files are stitched into one row per pathline: the segments of all timepoints of a group are appended
+ * in time order, after which the per point difference vectors are computed.
+ * Volume files produce one row per voxel per timepoint.
+ *
+ * The size of the data matrix is known before any point is stitched: the row width follows from the segment
+ * lengths of the first group and the row count from the LINES headers of the first timepoint of every group.
+ * The matrix is allocated once and the stitched points and difference vectors are written into it in place, so
+ * no intermediate copy of the study is ever held. The matrix is handed to the caller without copying.
+ *
+ * Pathline files are read in blocks through VTKPathlineStream: the files of a group are located in parallel, then
+ * their points are streamed block by block straight into the matrix, so apart from the matrix the memory use is
+ * bounded by the memory limit instead of growing with the files. When every line cell of every file of a group
+ * has the same size, the position of each timepoint within the rows is known up front and the files of the group
+ * are streamed in parallel; otherwise they are streamed one after the other in time order.
+ *
+ * When the files carry a point data array named ID, segments are matched to their pathline by the ID of their first
+ * point through a flat hash index built from the first timepoint of the group, so the files may list their pathlines
+ * in any order. Segments of unknown pathlines are skipped, and pathlines missing from a timepoint repeat their last
+ * point in its place. Files without IDs, or with duplicate IDs in the first timepoint, are matched by position.
+ * Volume files are parsed in full, the files of a group in parallel on the shared thread pool, and their voxels are
+ * written to the matrix in parallel over z slices. Masked volume studies only get rows for the voxels that pass the
+ * mask, counted per slice first, and record the grid index of the voxel of every row.
+ * Errors are reported by throwing std::runtime_error, problems that do not stop loading through a warning callback.
+ *
+ * Loading may run on any thread. Progress is reported per file and phase through a callback and cancel() may be
+ * called from another thread, after which load() stops at the next file or block of rows and throws LoadCancelled.
+ */
+class VTKStudyLoader
+{
+public:
+
+    /**
+     * Constructor
+     * @param filePaths UTF-8 encoded paths of all files of the study, grouped by flow component
+     */
+    explicit VTKStudyLoader(const std::vector<std::string>& filePaths);
+
+    /** Load the study */
+    LoadedStudy load();
+
+    /**
+     * Extend a loaded study with timepoints that arrived after it was loaded, reading only the new files. Pathlines
+     * grow by the points of the new timepoints (existing rows move to make room for them, the difference vectors of
+     * the last loaded point are updated), volume studies get rows for the voxels of the new files. The new timepoints
+     * continue after the last loaded or appended one. The spatial index of a pathline study is extended by the new
+     * points, or built when the study has none. The loader must have the selection the study was loaded with;
+     * a study that came from the cache is matched to the headers of the study files first. Appended studies are
+     * not written to the cache. When an error is thrown the study is left incomplete and has to be discarded.
+     *
+     * Only the last point of every pathline is read again, so the study may have been cut to the last points of its
+     * pathlines (see keepLastPoints()) or to none of the rows of a volume study, as long as a pathline study keeps
+     * its spatial index. The new points and rows then follow the ones it holds.
+     * @param study Study returned by load() and possibly extended or cut before
+     * @param filePaths UTF-8 encoded paths of the new files, the same number for every selected group, grouped like the study files and in time order
+     */
+    void append(LoadedStudy& study, const std::vector<std::string>& filePaths);
+
+    /** Callback receiving the progress, calls are serialized but may come from any of the loading threads */
+    using ProgressCallback = std::function<void(const LoadProgress& progress)>;
+
+    /**
+     * Set the function that receives the progress of load().
+     * @param progressCallback Callback, must be set before loading starts
+     */
+    void setProgressCallback(ProgressCallback progressCallback);
+
+    /** Callback receiving the warnings of a load or append, such as a cache that could not be written; calls are serialized but may come from any of the loading threads */
+    using WarningCallback = std::function<void(const std::string& message)>;
+
+    /**
+     * Set the function that receives the warnings of load() and append(), without one they are dropped.
+     * @param warningCallback Callback, must be set before loading starts
+     */
+    void setWarningCallback(WarningCallback warningCallback);
+
+    /** Request load() to stop as soon as possible, may be called from any thread */
+    void cancel();
+
+    /** Whether cancellation has been requested */
+    bool isCancelled() const;
+
+    /**
+     * Enable the study cache: load() then reuses a cached copy of an unchanged study and stores new loads. After a
+     * store, entries of changed studies and the least recently used entries beyond the size limit are removed;
+     * studies larger than the limit are not stored.
+     * @param cacheDirectory UTF-8 encoded path of the cache directory, empty disables the cache
+     * @param cacheSizeLimit Number of bytes the cache may take, zero for no limit
+     */
+    void setCacheDirectory(const std::string& cacheDirectory, std::uint64_t cacheSizeLimit = defaultCacheSizeLimit);
+
+    /**
+     * Load only part of the study.
+     * @param selection Groups, timepoints and pathlines to load
+     */
+    void setSelection(const LoadSelection& selection);
+
+    /**
+     * Set the memory available for the blocks read from pathline files, the data matrix is not included.
+     * @param memoryLimit Number of bytes
+     */
+    void setMemoryLimit(std::size_t memoryLimit);
+
+    /**
+     * Bound the resident memory of an import. The blocks read from pathline files count against the budget (see
+     * setMemoryLimit()); a data matrix that does not fit in the rest moves to a memory mapped scratch file, which is
+     * written group by group and block by block, so its pages are written back to disk rather than held in memory.
+     * @param memoryBudget Number of bytes, zero keeps the matrix in memory whatever its size
+     * @param scratchDirectory UTF-8 encoded path of the directory for scratch files, the temporary directory when empty
+     */
+    void setMemoryBudget(std::size_t memoryBudget, const std::string& scratchDirectory = std::string());
+
+    /**
+     * Replace the speed read from pathline files by the length of the difference vectors, the distance a pathline
+     * travels per point.
+     * @param derivedSpeed Whether the speed is derived
+     */
+    void setDerivedSpeed(bool derivedSpeed);
+
+    /**
+     * Resample every stitched pathline to a fixed number of points, evenly spaced by the length along the pathline,
+     * before the difference vectors are derived. The speed, index and time are interpolated linearly.
+     * @param resampledLineSize Number of points per pathline, zero keeps the points as stitched
+     */
+    void setResampledLineSize(std::size_t resampledLineSize);
+
+    /**
+     * Measure the stages of load() (cache, manifest, scan, open, parse, decode, stitch, resample, derive, spatial index) with a profiler.
+     * @param profiler Profiler receiving the measurements, must outlive loading; nullptr disables profiling
+     */
+    void setProfiler(LoadProfiler* profiler);
+
+    /** Default size limit of the study cache */
+    static constexpr std::uint64_t defaultCacheSizeLimit = std::uint64_t(4) << 30;
+
+    /** Default memory limit for the blocks read from pathline files */
+    static constexpr std::size_t defaultMemoryLimit = std::size_t(256) << 20;
+
+    /** Number of points a segment of a later timepoint contributes before its overlap is dropped */
+    static constexpr std::size_t segmentPoints = 8;
+
+    /** Number of leading points of a later segment that repeat the end of the previous timepoint */
+    static constexpr std::size_t segmentOverlap = 3;
+
+    /**
+     * Read a single file, legacy (.vtk) or XML (.vtp, .vtu) depending on its extension.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Parsed file contents
+     */
+    static VTKData readFile(const std::string& filePath);
+
+    /**
+     * Read only the number of line cells of a file, without parsing its points where the format allows.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Number of line cells
+     */
+    static std::size_t readNumberOfLines(const std::string& filePath);
+
+    /**
+     * Read the first points of a file, without parsing the rest of it where the format allows.
+     * @param filePath UTF-8 encoded path of the file
+     * @param count Maximum number of points
+     * @return Up to count points
+     */
+    static std::vector<std::array<float, 3>> readLeadingPoints(const std::string& filePath, std::size_t count);
+
+private:
+
+    /** Column buffers of the blocks read from a pathline file, reused from file to file by the stitching threads */
+    struct BlockBuffers
+    {
+        std::vector<std::uint32_t>  segmentSizes;   /** Number of points of every segment of the block */
+        std::vector<std::size_t>    segmentRows;    /** Row of every segment, npos for segments that are not loaded */
+        std::vector<float>          positions;      /** Three values per loaded point */
+        std::vector<float>          lineIndex;      /** Line index of every loaded point */
+        std::vector<float>          speed;          /** Speed of every loaded point */
+        std::vector<int>            ids;            /** ID of every point of the block, when segments are matched by ID */
+    };
+
+    /** Reads, orders and stitches the files of the study */
+    LoadedStudy loadFiles();
+
+    /** Recovers the selection, reset point and group rows of a study that was not loaded by this loader */
+    void restoreLayout(const LoadedStudy& study);
+
+    /**
+     * Stitch new timepoints onto the pathline rows.
+     * @param groupFilePaths New files of every selected group, in time order
+     * @param firstNewTimepoint Timepoint of the first new file
+     */
+    void appendPathlines(const std::vector<std::vector<std::string>>& groupFilePaths, int firstNewTimepoint);
+
+    /** Builds the spatial index of the rows of a pathline study */
+    void indexPathlines(LoadedStudy& study) const;
+
+    /** Replaces the stitched pathline rows by rows of _resampledLineSize points evenly spaced by arc length */
+    void resamplePathlines();
+
+    /** Moves the pathline rows apart to make room for lineSize points per row, keeping their points */
+    void widenPathlines(std::size_t lineSize);
+
+    /**
+     * Add the voxels of new timepoints to the volume matrix.
+     * @param groupFilePaths New files of every selected group, in time order
+     * @param firstNewTimepoint Timepoint of the first new file
+     */
+    void appendVolumes(const std::vector<std::vector<std::string>>& groupFilePaths, int firstNewTimepoint);
+
+    /** Checks the selection against the study and resolves its defaults */
+    void resolveSelection(int numberOfGroups);
+
+    /** Returns the rows of the first timepoint lines of a group, npos for lines that are not selected */
+    std::vector<std::size_t> selectLines(std::size_t numberOfLines, int group) const;
+
+    /** Returns the number of lines selectLines() selects */
+    std::size_t countSelectedLines(std::size_t numberOfLines) const;
+
+    /** Returns the index of the file of a timepoint of a group in the file paths */
+    std::size_t timepointFileIndex(int group, int timepoint) const;
+
+    /** Returns the path of the file of a timepoint of a group */
+    const std::string& timepointFilePath(int group, int timepoint) const;
+
+    /** Streams the selected pathline files into the matrix */
+    void loadPathlines();
+
+    /** Parses the selected volume files into the matrix */
+    void loadVolumes();
+
+    /** Opens the files of the selected timepoints of a group in parallel, in time order */
+    std::vector<std::unique_ptr<VTKPathlineStream>> openTimepoints(int group, std::atomic<std::size_t>& numberOfOpenedFiles);
+
+    /** Opens every file of a group and detects its first timepoint from their leading points */
+    int readResetPoint(int group);
+
+    /**
+     * Reads the leading points of one pathline from every file of a group and detects its first timepoint from them.
+     * Files that identify their pathlines are compared on the pathline of the first point of the first file, the
+     * others on their first pathline.
+     * @param files Every file of the group in selection order, rewound afterwards
+     * @return Index of the first timepoint in selection order
+     */
+    int readResetPoint(const std::vector<std::unique_ptr<VTKPathlineStream>>& files);
+
+    /**
+     * Reads the leading points of the pathline with the given ID from a file.
+     * @param file File whose ID array identifies its pathlines, rewound afterwards
+     * @param id ID of the first point of the segment of the pathline
+     * @param count Maximum number of points
+     * @param points Receives up to count points
+     * @return Whether the file identifies its pathlines and holds the pathline
+     */
+    bool readLeadingLinePoints(VTKPathlineStream& file, int id, std::size_t count, std::vector<std::array<float, 3>>& points);
+
+    /**
+     * Because files were not fully ordered from start to finish, the file at which the pathline points no longer
+     * line up with the previous file marks the first timepoint. The files after it are put in front of the rest.
+     * @param leadingPoints First six points of the same pathline in every file of a group, in selection order
+     * @return Index of the first timepoint in selection order
+     */
+    static int detectResetPoint(const std::vector<std::vector<std::array<float, 3>>>& leadingPoints);
+
+    /**
+     * Sizes and allocates the pathline matrix.
+     * @param firstGroup Files of the selected timepoints of the first selected group, in time order
+     * @param numberOfGroups Number of groups in the study
+     */
+    void allocatePathlines(const std::vector<std::unique_ptr<VTKPathlineStream>>& firstGroup, int numberOfGroups);
+
+    /** Streams the files of one group into its rows, in parallel when their segment sizes allow it */
+    void stitchGroup(const std::vector<std::unique_ptr<VTKPathlineStream>>& files, int group, std::atomic<std::size_t>& numberOfStitchedFiles);
+
+    /**
+     * Indexes the pathlines of a group by the ID of the first point of their segment in the first timepoint.
+     * @param firstTimepoint File of the first timepoint, rewound afterwards
+     * @param filePath Path used in messages
+     * @return Whether segments are matched to rows by ID, false if the file has no ID array or its IDs are not unique
+     */
+    bool buildPathlineIndex(VTKPathlineStream& firstTimepoint, const std::string& filePath);
+
+    /**
+     * Returns the number of bytes a new data matrix may keep in memory, given the matrices that are already there.
+     * @param residentBytes Bytes of the data matrices in memory
+     */
+    std::size_t matrixMemoryBudget(std::size_t residentBytes = 0) const;
+
+    /** Returns the index of the point data array named ID, or npos */
+    static std::size_t findIdArray(const VTKPathlineStream& file);
+
+    /** Returns the number of line cells read in the next block of a file */
+    static std::size_t numberOfBlockSegments(const VTKPathlineStream& file, std::size_t segmentIndex, std::size_t blockSize);
+
+    /**
+     * Writes the pathline segments of one timepoint file into the rows of its group.
+     * @param file File, positioned at the start of its sections
+     * @param filePath Path used in error messages
+     * @param timepoint Timepoint of the file
+     * @param startsLines Whether the file holds the first selected timepoint, whose segments start the pathlines
+     * @param group Group of the file
+     * @param rowOffset Position of the timepoint within the rows when known up front, otherwise npos to append
+     * @param blockSize Number of points read per block
+     * @param stitchedLines Marks the rows of the group that received a segment when matching by ID, otherwise nullptr to match by position
+     */
+    void stitchPathlines(VTKPathlineStream& file, const std::string& filePath, int timepoint, bool startsLines, int group, std::size_t rowOffset, std::size_t blockSize, std::vector<std::uint8_t>* stitchedLines);
+
+    /** Takes idle block buffers, or new ones if none are idle */
+    std::unique_ptr<BlockBuffers> acquireBlockBuffers();
+
+    /** Keeps block buffers for the next file that is stitched */
+    void releaseBlockBuffers(std::unique_ptr<BlockBuffers> blockBuffers);
+
+    /** Fills points [begin, end) of a row with copies of the point before them */
+    void repeatPoint(std::size_t row, std::size_t begin, std::size_t end);
+
+    /** Reads the mask file of the selection, if any, for a grid */
+    void loadVoxelMask(const std::array<int, 3>& dimensions);
+
+    /** Writes the voxels of one volume file that pass the mask into the data matrix */
+    void appendVolume(const VTKData& file, const std::string& filePath, int timepoint);
+
+    /**
+     * Checks that every pathline is complete and fills in the difference vectors, in parallel over blocks of rows.
+     * @param firstPoint First new point of the pathlines, the vectors of the points before its predecessor are kept
+     */
+    void computeDifferences(std::size_t firstPoint = 0);
+
+    /** Passes the progress of a phase on to the callback */
+    void reportProgress(LoadPhase phase, std::size_t completed, std::size_t total, const std::string& filePath = std::string());
+
+    /** Passes a warning on to the callback */
+    void reportWarning(const std::string& message);
+
+    /** Throws LoadCancelled if cancellation has been requested */
+    void throwIfCancelled() const;
+
+private:
+    std::vector<std::string>    _filePaths;
+    std::string                 _cacheDirectory;
+    std::uint64_t               _cacheSizeLimit;        /** Bytes the study cache may take, zero if unbounded */
+    LoadSelection               _selection;
+    StudyManifest               _manifest;      /** Headers of the study files, empty when restoring the layout of a loaded study */
+    int                         _timepointsPerGroup;    /** Number of files per group */
+    std::vector<int>            _groups;        /** Indices of the selected groups, in ascending order */
+    int                         _firstTimepoint;
+    int                         _lastTimepoint;
+    int                         _resetPoint;    /** Index of the first timepoint in selection order */
+    LoadedStudy                 _study;         /** Study that is being loaded, its matrix is allocated up front */
+    std::vector<std::size_t>    _groupOffsets;  /** Index of the first row of every group, groups that are not selected have no rows */
+    std::vector<std::size_t>    _lineLengths;   /** Number of points written to every pathline row so far */
+    std::vector<std::size_t>    _lineRows;      /** Rows of the first timepoint lines of the group being stitched, npos if not selected */
+    PathlineIndex               _pathlineIndex; /** First timepoint lines of the group being stitched, by ID */
+    std::vector<std::unique_ptr<BlockBuffers>>  _idleBlockBuffers;     /** Block buffers between two files, freed once the files are stitched */
+    std::mutex                  _blockBuffersMutex;
+    std::size_t                 _volumeOffset;  /** Number of values written to the volume matrix so far */
+    std::vector<std::uint8_t>   _voxelMask;     /** Nonzero for the voxels inside the mask file, empty without a mask file */
+    int                         _numberOfAppendedTimepoints;    /** Number of timepoints appended after the selected ones */
+    std::size_t                 _memoryLimit;   /** Bytes available for the blocks read from pathline files */
+    std::size_t                 _memoryBudget;  /** Bytes available for the whole import, zero if unbounded */
+    std::string                 _scratchDirectory;      /** Directory of the scratch files of matrices beyond the budget */
+    bool                        _derivedSpeed;  /** Whether the speed column is computed from the difference vectors */
+    std::size_t                 _resampledLineSize;     /** Number of points of resampled pathlines, zero if not resampled */
+    LoadProfiler*               _profiler;      /** Receives the measurements of the load stages, may be nullptr */
+    ProgressCallback            _progressCallback;
+    std::mutex                  _progressMutex; /** Serializes the progress callbacks of the parsing threads */
+    WarningCallback             _warningCallback;
+    std::mutex                  _warningMutex;  /** Serializes the warning callbacks of the stitching threads */
+    std::atomic<bool>           _cancelled;
+};
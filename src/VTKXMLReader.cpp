@@ -0,0 +1,856 @@
+#include "VTKXMLReader.h"
+
+#include "CompressedFile.h"
+#include "MappedFile.h"
+#include "StudyManifest.h"
+#include "ThreadPool.h"
+#include "VTKScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef VTKLOADER_HAS_ZLIB
+    #include <zlib.h>
+#endif
+
+namespace
+{
+    /** VTK cell types that describe lines */
+    constexpr int vtkLine       = 3;
+    constexpr int vtkPolyLine   = 4;
+
+    bool isNameCharacter(char character)
+    {
+        return !VTKScanner::isWhitespace(character) && character != '=' && character != '>' && character != '/';
+    }
+
+    /** Returns the position of the needle in [begin, end), or end */
+    const char* find(const char* begin, const char* end, std::string_view needle)
+    {
+        return std::search(begin, end, needle.begin(), needle.end());
+    }
+
+    /** Value of a single base64 character, or -1 for characters outside of the alphabet */
+    int base64Value(char character)
+    {
+        if (character >= 'A' && character <= 'Z')
+            return character - 'A';
+
+        if (character >= 'a' && character <= 'z')
+            return character - 'a' + 26;
+
+        if (character >= '0' && character <= '9')
+            return character - '0' + 52;
+
+        if (character == '+')
+            return 62;
+
+        if (character == '/')
+            return 63;
+
+        return -1;
+    }
+
+    /** Number of base64 characters that encode the given number of bytes */
+    std::size_t base64Length(std::size_t numberOfBytes)
+    {
+        return 4 * ((numberOfBytes + 2) / 3);
+    }
+
+    /**
+     * Decode base64 text, padding characters end the decoding.
+     * @return Decoded bytes
+     */
+    std::vector<char> decodeBase64(const char* text, std::size_t length)
+    {
+        std::vector<char> bytes;
+        bytes.reserve(length / 4 * 3);
+
+        unsigned int accumulator = 0;
+        int numberOfBits = 0;
+
+        for (std::size_t index = 0; index < length; index++) {
+            const auto value = base64Value(text[index]);
+
+            if (value < 0)
+                break;
+
+            accumulator = (accumulator << 6) | static_cast<unsigned int>(value);
+            numberOfBits += 6;
+
+            if (numberOfBits >= 8) {
+                numberOfBits -= 8;
+                bytes.push_back(static_cast<char>((accumulator >> numberOfBits) & 0xFF));
+            }
+        }
+
+        return bytes;
+    }
+
+    struct Attribute
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    std::string_view attributeValue(const std::vector<Attribute>& attributes, std::string_view name)
+    {
+        for (const auto& attribute : attributes)
+            if (attribute.name == name)
+                return attribute.value;
+
+        return {};
+    }
+
+    std::size_t attributeSize(const std::vector<Attribute>& attributes, std::string_view name, std::size_t defaultValue)
+    {
+        const auto value = attributeValue(attributes, name);
+
+        if (value.empty())
+            return defaultValue;
+
+        std::size_t result = defaultValue;
+        std::from_chars(value.data(), value.data() + value.size(), result);
+
+        return result;
+    }
+}
+
+VTKData VTKXMLReader::read(const std::string& filePath)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    return parse(file.data(), file.end(), filePath);
+}
+
+VTKData VTKXMLReader::parse(const char* begin, const char* end, const std::string& fileName)
+{
+    parseHeaderOnly(begin, end, fileName);
+
+    VTKData data;
+
+    buildData(data);
+
+    return data;
+}
+
+std::size_t VTKXMLReader::readNumberOfLines(const std::string& filePath)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    if (parseHeaderOnly(file.data(), file.end(), filePath) != "PolyData")
+        return parse(file.data(), file.end(), filePath).numberOfLines();
+
+    std::size_t numberOfLines = 0;
+
+    for (const auto& piece : _pieces)
+        numberOfLines += piece.numberOfLines;
+
+    return numberOfLines;
+}
+
+VTKFileManifest VTKXMLReader::readManifest(const std::string& filePath)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    VTKFileManifest manifest;
+
+    manifest.datasetType    = parseHeaderOnly(file.data(), file.end(), filePath);
+    manifest.contentSize    = file.size();
+
+    for (const auto& piece : _pieces) {
+        manifest.numberOfPoints += piece.numberOfPoints;
+        manifest.numberOfLines  += piece.numberOfLines;
+    }
+
+    if (manifest.datasetType != "PolyData")
+        manifest.numberOfLines = parse(file.data(), file.end(), filePath).numberOfLines();
+
+    if (_pieces.empty())
+        return manifest;
+
+    // Only the first piece is described, the values of later pieces follow those of the first when parsed.
+    const auto& piece = _pieces.front();
+
+    for (const auto& array : piece.arrays) {
+        std::size_t offset = std::string::npos;
+
+        // Raw appended values and inline content can be sought to, base64 appended data has no byte offsets.
+        if (array.format == ArrayDescription::Format::Appended && !_appendedBase64 && _appendedData != nullptr)
+            offset = static_cast<std::size_t>(_appendedData - file.data()) + array.offset;
+        else if (array.format != ArrayDescription::Format::Appended && array.contentBegin != nullptr)
+            offset = static_cast<std::size_t>(array.contentBegin - file.data());
+
+        if (array.format != ArrayDescription::Format::Ascii)
+            manifest.binary = true;
+
+        if (array.section == "Points" && manifest.pointsOffset == std::string::npos)
+            manifest.pointsOffset = offset;
+        else if (array.section == "PointData")
+            manifest.pointArrays.push_back({ array.name, array.typeName, array.numComponents * piece.numberOfPoints, offset });
+    }
+
+    return manifest;
+}
+
+std::vector<std::array<float, 3>> VTKXMLReader::readLeadingPoints(const std::string& filePath, std::size_t count)
+{
+    MappedFile file(filePath);
+
+    if (!file.isOpen())
+        throw std::runtime_error("Could not open " + filePath);
+
+    parseHeaderOnly(file.data(), file.end(), filePath);
+
+    std::vector<std::array<float, 3>> points;
+
+    for (const auto& piece : _pieces) {
+        if (points.size() >= count)
+            break;
+
+        const auto it = std::find_if(piece.arrays.begin(), piece.arrays.end(), [](const ArrayDescription& array) {
+            return array.section == "Points";
+        });
+
+        if (it == piece.arrays.end())
+            continue;
+
+        const auto& array = *it;
+        const auto numberOfPoints = std::min(count - points.size(), piece.numberOfPoints);
+        const auto numberOfValues = 3 * numberOfPoints;
+
+        std::vector<float> coordinates;
+
+        // Compressed raw appended values are inflated up to the block holding the last wanted point, ASCII and
+        // uncompressed values are decoded up to that point by readArray() itself.
+        if (array.format == ArrayDescription::Format::Appended && !_appendedBase64 && _compressed && array.type != ValueType::Unknown) {
+            if (_appendedData == nullptr || _appendedData + array.offset + 3 * _headerSize > _end)
+                fail("compression header of array " + array.name + " is out of range");
+
+            const char* position = _appendedData + array.offset;
+            const auto numberOfBlocks = readHeaderValue(position);
+            const auto blockSize = readHeaderValue(position + _headerSize);
+            const auto numberOfBytes = numberOfValues * valueTypeSize(array.type);
+
+            if (position + (3 + numberOfBlocks) * _headerSize > _end)
+                fail("compression header of array " + array.name + " is out of range");
+
+            if (blockSize == 0)
+                fail("invalid block size of array " + array.name);
+
+            const auto neededBlocks = std::min(numberOfBlocks, (numberOfBytes + blockSize - 1) / blockSize);
+
+            // A header describing only the leading blocks, all of which are full unless the last block is among them.
+            std::vector<std::size_t> header(3 + neededBlocks);
+
+            header[0] = neededBlocks;
+            header[1] = blockSize;
+            header[2] = neededBlocks == numberOfBlocks ? readHeaderValue(position + 2 * _headerSize) : 0;
+
+            std::size_t compressedSize = 0;
+
+            for (std::size_t blockIndex = 0; blockIndex < neededBlocks; blockIndex++) {
+                header[3 + blockIndex] = readHeaderValue(position + (3 + blockIndex) * _headerSize);
+                compressedSize += header[3 + blockIndex];
+            }
+
+            const char* compressed = position + (3 + numberOfBlocks) * _headerSize;
+
+            if (compressed + compressedSize > _end)
+                fail("compressed data of array " + array.name + " is out of range");
+
+            const auto bytes = inflateBlocks(header, compressed, compressedSize);
+
+            if (bytes.size() < numberOfBytes)
+                fail("array " + array.name + " holds fewer values than expected");
+
+            coordinates.resize(numberOfValues);
+            decodeValues(array.type, bytes.data(), numberOfValues, _bigEndian, coordinates.data());
+        }
+        else {
+            coordinates = readArray<float>(array, numberOfValues);
+        }
+
+        for (std::size_t pointIndex = 0; pointIndex < numberOfPoints; pointIndex++)
+            points.push_back({ coordinates[3 * pointIndex], coordinates[3 * pointIndex + 1], coordinates[3 * pointIndex + 2] });
+    }
+
+    return points;
+}
+
+bool VTKXMLReader::isXMLFile(const std::string& compressedFilePath)
+{
+    // Compressed files are told apart by the extension in front of the compression extension.
+    const auto filePath = withoutCompressionExtension(compressedFilePath);
+
+    const auto hasExtension = [&filePath](const std::string& extension) {
+        if (filePath.size() < extension.size())
+            return false;
+
+        return std::equal(extension.begin(), extension.end(), filePath.end() - extension.size(), [](char expected, char character) {
+            return expected == std::tolower(static_cast<unsigned char>(character));
+        });
+    };
+
+    return hasExtension(".vtp") || hasExtension(".vtu");
+}
+
+std::string VTKXMLReader::parseHeaderOnly(const char* begin, const char* end, const std::string& fileName)
+{
+    _fileName       = fileName;
+    _datasetType.clear();
+    _bigEndian      = false;
+    _headerSize     = 4;
+    _compressed     = false;
+    _appendedBase64 = false;
+    _appendedData   = nullptr;
+    _end            = end;
+    _pieces.clear();
+
+    readHeader(begin, end);
+
+    return _datasetType;
+}
+
+void VTKXMLReader::readHeader(const char* begin, const char* end)
+{
+    // Names of the currently open elements.
+    std::vector<std::string_view> elements;
+
+    const char* position = begin;
+
+    while (true) {
+        position = static_cast<const char*>(std::memchr(position, '<', static_cast<std::size_t>(end - position)));
+
+        if (position == nullptr || position + 1 >= end)
+            break;
+
+        // Comments, declarations and processing instructions.
+        if (position[1] == '!' || position[1] == '?') {
+            const auto* tagEnd = position[1] == '!' && end - position > 3 && position[2] == '-' ? find(position, end, "-->") : find(position, end, ">");
+
+            if (tagEnd == end)
+                fail("unterminated XML tag");
+
+            position = tagEnd + 1;
+            continue;
+        }
+
+        // Closing tags.
+        if (position[1] == '/') {
+            const auto* tagEnd = find(position, end, ">");
+
+            if (tagEnd == end)
+                fail("unterminated XML tag");
+
+            if (!elements.empty())
+                elements.pop_back();
+
+            position = tagEnd + 1;
+            continue;
+        }
+
+        // Element name and attributes.
+        const char* current = position + 1;
+
+        while (current < end && isNameCharacter(*current))
+            ++current;
+
+        const std::string_view element(position + 1, static_cast<std::size_t>(current - position - 1));
+
+        std::vector<Attribute> attributes;
+        bool selfClosing = false;
+
+        while (true) {
+            while (current < end && VTKScanner::isWhitespace(*current))
+                ++current;
+
+            if (current >= end)
+                fail("unterminated XML tag");
+
+            if (*current == '>') {
+                ++current;
+                break;
+            }
+
+            if (*current == '/') {
+                selfClosing = true;
+                current += 2;
+                break;
+            }
+
+            const char* nameBegin = current;
+
+            while (current < end && isNameCharacter(*current))
+                ++current;
+
+            const std::string_view name(nameBegin, static_cast<std::size_t>(current - nameBegin));
+
+            while (current < end && (VTKScanner::isWhitespace(*current) || *current == '='))
+                ++current;
+
+            if (current >= end || (*current != '"' && *current != '\''))
+                fail("malformed attribute " + std::string(name));
+
+            const char quote = *current++;
+            const char* valueBegin = current;
+
+            while (current < end && *current != quote)
+                ++current;
+
+            attributes.push_back({ name, std::string_view(valueBegin, static_cast<std::size_t>(current - valueBegin)) });
+
+            ++current;
+        }
+
+        position = current;
+
+        if (element == "VTKFile") {
+            _datasetType    = std::string(attributeValue(attributes, "type"));
+            _bigEndian      = attributeValue(attributes, "byte_order") == "BigEndian";
+            _headerSize     = attributeValue(attributes, "header_type") == "UInt64" ? 8 : 4;
+
+            const auto compressor = attributeValue(attributes, "compressor");
+
+            if (!compressor.empty() && compressor != "vtkZLibDataCompressor")
+                fail("unsupported compressor " + std::string(compressor));
+
+            _compressed = !compressor.empty();
+        }
+        else if (element == "Piece") {
+            Piece piece;
+
+            piece.numberOfPoints    = attributeSize(attributes, "NumberOfPoints", 0);
+            piece.numberOfLines     = attributeSize(attributes, "NumberOfLines", 0);
+            piece.numberOfCells     = attributeSize(attributes, "NumberOfCells", 0);
+
+            _pieces.push_back(std::move(piece));
+        }
+        else if (element == "DataArray") {
+            if (_pieces.empty())
+                fail("DataArray outside of a Piece");
+
+            ArrayDescription array;
+
+            array.name          = std::string(attributeValue(attributes, "Name"));
+            array.typeName      = std::string(attributeValue(attributes, "type"));
+            array.type          = valueTypeFromXMLName(array.typeName);
+            array.numComponents = attributeSize(attributes, "NumberOfComponents", 1);
+            array.offset        = attributeSize(attributes, "offset", 0);
+            array.section       = elements.empty() ? std::string() : std::string(elements.back());
+            array.piece         = _pieces.size() - 1;
+
+            const auto format = attributeValue(attributes, "format");
+
+            if (format == "appended")
+                array.format = ArrayDescription::Format::Appended;
+            else if (format == "binary")
+                array.format = ArrayDescription::Format::Binary;
+            else
+                array.format = ArrayDescription::Format::Ascii;
+
+            // Inline content ends at the closing tag, nested information elements come before it.
+            if (!selfClosing && array.format != ArrayDescription::Format::Appended) {
+                const auto* closingTag = find(position, end, "</DataArray>");
+
+                if (closingTag == end)
+                    fail("unterminated DataArray " + array.name);
+
+                const auto* contentBegin = position;
+
+                for (const auto* character = position; character < closingTag; character++)
+                    if (*character == '>')
+                        contentBegin = character + 1;
+
+                array.contentBegin  = contentBegin;
+                array.contentEnd    = closingTag;
+
+                position = closingTag + std::strlen("</DataArray>");
+                selfClosing = true;
+            }
+
+            _pieces.back().arrays.push_back(std::move(array));
+        }
+        else if (element == "AppendedData") {
+            _appendedBase64 = attributeValue(attributes, "encoding") == "base64";
+
+            // The appended data starts after an underscore, everything from there on is payload.
+            const auto* marker = static_cast<const char*>(std::memchr(position, '_', static_cast<std::size_t>(end - position)));
+
+            if (marker == nullptr)
+                fail("missing appended data marker");
+
+            _appendedData = marker + 1;
+            return;
+        }
+
+        if (!selfClosing)
+            elements.push_back(element);
+    }
+}
+
+void VTKXMLReader::buildData(VTKData& data) const
+{
+    if (_datasetType != "PolyData" && _datasetType != "UnstructuredGrid")
+        fail("unsupported dataset type " + _datasetType);
+
+    data.datasetType    = _datasetType == "PolyData" ? "POLYDATA" : "UNSTRUCTURED_GRID";
+    data.binary         = _appendedData != nullptr;
+
+    const auto findArray = [](const Piece& piece, std::string_view section, std::string_view name) -> const ArrayDescription* {
+        for (const auto& array : piece.arrays)
+            if (array.section == section && (name.empty() || array.name == name))
+                return &array;
+
+        return nullptr;
+    };
+
+    for (std::size_t pieceIndex = 0; pieceIndex < _pieces.size(); pieceIndex++) {
+        const auto& piece = _pieces[pieceIndex];
+        const auto pointOffset = static_cast<int>(data.points.size());
+
+        // Points.
+        if (const auto* pointsArray = findArray(piece, "Points", "")) {
+            const auto coordinates = readArray<float>(*pointsArray, 3 * piece.numberOfPoints);
+
+            data.points.reserve(data.points.size() + piece.numberOfPoints);
+
+            for (std::size_t pointIndex = 0; pointIndex < piece.numberOfPoints; pointIndex++)
+                data.points.push_back({ coordinates[3 * pointIndex], coordinates[3 * pointIndex + 1], coordinates[3 * pointIndex + 2] });
+        }
+
+        // Line cells.
+        const bool isPolyData = _datasetType == "PolyData";
+        const auto* cellSection = isPolyData ? "Lines" : "Cells";
+        const auto numberOfCells = isPolyData ? piece.numberOfLines : piece.numberOfCells;
+
+        const auto* connectivityArray   = findArray(piece, cellSection, "connectivity");
+        const auto* offsetsArray        = findArray(piece, cellSection, "offsets");
+        const auto* typesArray          = findArray(piece, cellSection, "types");
+
+        if (numberOfCells > 0 && connectivityArray != nullptr && offsetsArray != nullptr) {
+            const auto offsets = readArray<std::int64_t>(*offsetsArray, numberOfCells);
+            const auto connectivitySize = offsets.empty() ? 0 : static_cast<std::size_t>(std::max<std::int64_t>(offsets.back(), 0));
+            const auto connectivity = readArray<int>(*connectivityArray, connectivitySize);
+
+            std::vector<int> types;
+
+            if (!isPolyData && typesArray != nullptr)
+                types = readArray<int>(*typesArray, numberOfCells);
+
+            data.lineOffsets.reserve(data.lineOffsets.size() + numberOfCells + 1);
+            data.lineConnectivity.reserve(data.lineConnectivity.size() + connectivity.size());
+
+            std::int64_t cellBegin = 0;
+
+            for (std::size_t cellIndex = 0; cellIndex < numberOfCells; cellIndex++) {
+                const auto cellEnd = offsets[cellIndex];
+
+                if (cellEnd < cellBegin || static_cast<std::size_t>(cellEnd) > connectivity.size())
+                    fail("invalid cell offsets");
+
+                const bool isLine = isPolyData || types.empty() || types[cellIndex] == vtkLine || types[cellIndex] == vtkPolyLine;
+
+                if (isLine)
+                    data.appendLine(connectivity.data() + cellBegin, static_cast<std::size_t>(cellEnd - cellBegin), pointOffset);
+
+                cellBegin = cellEnd;
+            }
+        }
+
+        // Point and cell attributes, arrays of later pieces are appended to those of the first piece.
+        const auto readAttributes = [this, &piece](std::string_view section, std::size_t numberOfTuples, std::vector<VTKDataArray>& target, bool firstPiece) {
+            std::size_t attributeIndex = 0;
+
+            for (const auto& description : piece.arrays) {
+                if (description.section != section)
+                    continue;
+
+                VTKDataArray array;
+
+                array.name          = description.name;
+                array.type          = description.typeName;
+                array.numComponents = static_cast<int>(description.numComponents);
+                array.isInteger     = description.type != ValueType::Float32 && description.type != ValueType::Float64;
+
+                const auto count = numberOfTuples * description.numComponents;
+
+                if (array.isInteger)
+                    array.integers = readArray<int>(description, count);
+                else
+                    array.values = readArray<float>(description, count);
+
+                if (firstPiece) {
+                    target.push_back(std::move(array));
+                }
+                else if (attributeIndex < target.size()) {
+                    auto& existing = target[attributeIndex];
+                    existing.values.insert(existing.values.end(), array.values.begin(), array.values.end());
+                    existing.integers.insert(existing.integers.end(), array.integers.begin(), array.integers.end());
+                }
+
+                attributeIndex++;
+            }
+        };
+
+        readAttributes("PointData", piece.numberOfPoints, data.pointData, pieceIndex == 0);
+        readAttributes("CellData", isPolyData ? piece.numberOfLines : piece.numberOfCells, data.cellData, pieceIndex == 0);
+    }
+}
+
+template <typename Value>
+std::vector<Value> VTKXMLReader::readArray(const ArrayDescription& array, std::size_t expectedCount) const
+{
+    if (array.type == ValueType::Unknown)
+        fail("unsupported data type " + array.typeName + " of array " + array.name);
+
+    std::vector<Value> values(expectedCount);
+
+    if (array.format == ArrayDescription::Format::Ascii) {
+        VTKScanner scanner(array.contentBegin, array.contentEnd);
+
+        for (auto& value : values) {
+            bool valid;
+
+            if constexpr (std::is_floating_point<Value>::value)
+                valid = scanner.readFloat(value);
+            else
+                valid = scanner.readInteger(value);
+
+            if (!valid)
+                fail("invalid value in array " + array.name);
+        }
+
+        return values;
+    }
+
+    const auto valueSize = valueTypeSize(array.type);
+
+    // Uncompressed raw appended data is decoded straight from the mapped file.
+    if (array.format == ArrayDescription::Format::Appended && !_appendedBase64 && !_compressed) {
+        const char* block = _appendedData + array.offset;
+
+        if (block + _headerSize > _end)
+            fail("appended data of array " + array.name + " is out of range");
+
+        const auto numberOfBytes = readHeaderValue(block);
+
+        if (numberOfBytes < expectedCount * valueSize || block + _headerSize + numberOfBytes > _end)
+            fail("array " + array.name + " holds fewer values than expected");
+
+        decodeValues(array.type, block + _headerSize, expectedCount, _bigEndian, values.data());
+
+        return values;
+    }
+
+    const auto bytes = readBytes(array);
+
+    if (bytes.size() < expectedCount * valueSize)
+        fail("array " + array.name + " holds fewer values than expected");
+
+    decodeValues(array.type, bytes.data(), expectedCount, _bigEndian, values.data());
+
+    return values;
+}
+
+std::vector<char> VTKXMLReader::readBytes(const ArrayDescription& array) const
+{
+    if (array.format == ArrayDescription::Format::Binary) {
+        const char* text = array.contentBegin;
+
+        while (text < array.contentEnd && VTKScanner::isWhitespace(*text))
+            ++text;
+
+        return readBase64Block(text, array.contentEnd);
+    }
+
+    if (_appendedData == nullptr || _appendedData + array.offset > _end)
+        fail("appended data of array " + array.name + " is out of range");
+
+    if (_appendedBase64)
+        return readBase64Block(_appendedData + array.offset, _end);
+
+    return readRawBlock(_appendedData + array.offset, _end);
+}
+
+std::vector<char> VTKXMLReader::readRawBlock(const char* position, const char* end) const
+{
+    if (position + _headerSize > end)
+        fail("binary block header is out of range");
+
+    if (!_compressed) {
+        const auto numberOfBytes = readHeaderValue(position);
+
+        if (position + _headerSize + numberOfBytes > end)
+            fail("binary block is out of range");
+
+        return std::vector<char>(position + _headerSize, position + _headerSize + numberOfBytes);
+    }
+
+    // Compressed header: number of blocks, block size, last block size and the compressed size of every block.
+    const auto numberOfBlocks = readHeaderValue(position);
+    const auto headerBytes = (3 + numberOfBlocks) * _headerSize;
+
+    if (position + headerBytes > end)
+        fail("compression header is out of range");
+
+    std::vector<std::size_t> header(3 + numberOfBlocks);
+
+    for (std::size_t index = 0; index < header.size(); index++)
+        header[index] = readHeaderValue(position + index * _headerSize);
+
+    std::size_t compressedSize = 0;
+
+    for (std::size_t blockIndex = 0; blockIndex < numberOfBlocks; blockIndex++)
+        compressedSize += header[3 + blockIndex];
+
+    if (position + headerBytes + compressedSize > end)
+        fail("compressed data is out of range");
+
+    return inflateBlocks(header, position + headerBytes, compressedSize);
+}
+
+std::vector<char> VTKXMLReader::readBase64Block(const char* position, const char* end) const
+{
+    const auto available = static_cast<std::size_t>(end - position);
+
+    if (!_compressed) {
+        // The size header is usually encoded on its own, in which case its encoding ends with padding.
+        const auto headerLength = base64Length(_headerSize);
+
+        if (available < headerLength)
+            fail("binary block header is out of range");
+
+        const auto header = decodeBase64(position, headerLength);
+
+        if (header.size() < _headerSize)
+            fail("invalid binary block header");
+
+        const auto numberOfBytes = readHeaderValue(header.data());
+
+        if (position[headerLength - 1] == '=') {
+            const auto dataLength = base64Length(numberOfBytes);
+
+            if (available < headerLength + dataLength)
+                fail("binary block is out of range");
+
+            auto bytes = decodeBase64(position + headerLength, dataLength);
+            bytes.resize(std::min(bytes.size(), numberOfBytes));
+
+            return bytes;
+        }
+
+        const auto totalLength = base64Length(_headerSize + numberOfBytes);
+
+        if (available < totalLength)
+            fail("binary block is out of range");
+
+        auto bytes = decodeBase64(position, totalLength);
+
+        return std::vector<char>(bytes.begin() + _headerSize, bytes.begin() + std::min(bytes.size(), _headerSize + numberOfBytes));
+    }
+
+    // The first three header values are a multiple of three bytes and decode without padding.
+    if (available < base64Length(3 * _headerSize))
+        fail("compression header is out of range");
+
+    const auto prefix = decodeBase64(position, base64Length(3 * _headerSize));
+    const auto numberOfBlocks = readHeaderValue(prefix.data());
+    const auto headerBytes = (3 + numberOfBlocks) * _headerSize;
+    const auto headerLength = base64Length(headerBytes);
+
+    if (available < headerLength)
+        fail("compression header is out of range");
+
+    const auto headerData = decodeBase64(position, headerLength);
+
+    std::vector<std::size_t> header(3 + numberOfBlocks);
+
+    for (std::size_t index = 0; index < header.size(); index++)
+        header[index] = readHeaderValue(headerData.data() + index * _headerSize);
+
+    std::size_t compressedSize = 0;
+
+    for (std::size_t blockIndex = 0; blockIndex < numberOfBlocks; blockIndex++)
+        compressedSize += header[3 + blockIndex];
+
+    if (available < headerLength + base64Length(compressedSize))
+        fail("compressed data is out of range");
+
+    const auto compressed = decodeBase64(position + headerLength, base64Length(compressedSize));
+
+    return inflateBlocks(header, compressed.data(), std::min(compressed.size(), compressedSize));
+}
+
+std::vector<char> VTKXMLReader::inflateBlocks(const std::vector<std::size_t>& header, const char* compressed, std::size_t compressedSize) const
+{
+#ifdef VTKLOADER_HAS_ZLIB
+    const auto numberOfBlocks   = header[0];
+    const auto blockSize        = header[1];
+    const auto lastBlockSize    = header[2] != 0 ? header[2] : blockSize;
+
+    if (numberOfBlocks == 0)
+        return {};
+
+    std::vector<char> bytes((numberOfBlocks - 1) * blockSize + lastBlockSize);
+
+    // Blocks are independent zlib streams, so they are inflated in parallel.
+    std::vector<std::size_t> blockOffsets(numberOfBlocks + 1, 0);
+
+    for (std::size_t blockIndex = 0; blockIndex < numberOfBlocks; blockIndex++)
+        blockOffsets[blockIndex + 1] = blockOffsets[blockIndex] + header[3 + blockIndex];
+
+    if (blockOffsets.back() > compressedSize)
+        fail("compressed data is truncated");
+
+    ThreadPool::global().parallelFor(numberOfBlocks, [&](std::size_t blockIndex) {
+        const auto expectedSize = blockIndex + 1 == numberOfBlocks ? lastBlockSize : blockSize;
+
+        uLongf inflatedSize = static_cast<uLongf>(expectedSize);
+
+        const auto result = uncompress(reinterpret_cast<Bytef*>(bytes.data() + blockIndex * blockSize), &inflatedSize,
+                                       reinterpret_cast<const Bytef*>(compressed + blockOffsets[blockIndex]), static_cast<uLong>(header[3 + blockIndex]));
+
+        if (result != Z_OK || inflatedSize != expectedSize)
+            fail("unable to decompress block " + std::to_string(blockIndex));
+    });
+
+    return bytes;
+#else
+    (void)header;
+    (void)compressed;
+    (void)compressedSize;
+
+    fail("compressed data requires zlib, which was not available when the plugin was built");
+#endif
+}
+
+std::size_t VTKXMLReader::readHeaderValue(const char* bytes) const
+{
+    if (_headerSize == 8) {
+        std::uint64_t value;
+        decodeValues(ValueType::UInt64, bytes, 1, _bigEndian, &value);
+        return static_cast<std::size_t>(value);
+    }
+
+    std::uint32_t value;
+    decodeValues(ValueType::UInt32, bytes, 1, _bigEndian, &value);
+    return value;
+}
+
+void VTKXMLReader::fail(const std::string& message) const
+{
+    throw std::runtime_error(_fileName + ": " + message);
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "VTKData.h"
+#include "ValueDecoding.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct VTKFileManifest;
+
+// =============================================================================
+// XML VTK reader
+// =============================================================================
+
+/**
+ * Reader for VTK XML PolyData (.vtp) and UnstructuredGrid (.vtu) files.
+ *
+ * The XML header is streamed from the memory mapped file up to the appended data section; the binary payload
+ * is never parsed as XML. Arrays may be stored as ascii, inline base64 or appended (raw or base64) data and may
+ * be zlib compressed, in which case the compressed blocks of an array are inflated in parallel.
+ * Line cells (PolyData lines, or line and poly line cells of an unstructured grid) and the point and cell data
+ * arrays are converted to the same representation as legacy files, so both feed the same pathline assembly.
+ * Errors are reported by throwing std::runtime_error with a message naming the file.
+ */
+class VTKXMLReader
+{
+public:
+
+    /**
+     * Read the file at the given path.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Parsed file contents
+     */
+    VTKData read(const std::string& filePath);
+
+    /**
+     * Parse a VTK XML file that is already in memory.
+     * @param begin Start of the file contents
+     * @param end End of the file contents
+     * @param fileName Name used in error messages
+     * @return Parsed file contents
+     */
+    VTKData parse(const char* begin, const char* end, const std::string& fileName);
+
+    /**
+     * Returns the number of line cells of a file. PolyData files declare it in their header, so only the header
+     * is read; unstructured grids have to be read in full to tell line cells from other cells.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Number of line cells
+     */
+    std::size_t readNumberOfLines(const std::string& filePath);
+
+    /**
+     * Returns the header of a file: its dataset type, counts and the point data arrays with the offsets of their
+     * raw values. Like readNumberOfLines(), unstructured grids are read in full to count their line cells.
+     * @param filePath UTF-8 encoded path of the file
+     * @return Manifest of the file, without a legacy layout
+     */
+    VTKFileManifest readManifest(const std::string& filePath);
+
+    /**
+     * Returns the first points of a file. Only the header and the leading values of the points array are decoded,
+     * except for base64 compressed arrays, which can only be decoded as a whole.
+     * @param filePath UTF-8 encoded path of the file
+     * @param count Maximum number of points
+     * @return Up to count points, fewer if the file holds fewer
+     */
+    std::vector<std::array<float, 3>> readLeadingPoints(const std::string& filePath, std::size_t count);
+
+    /** Whether the path has an XML VTK extension (.vtp or .vtu, any case), also in front of a compression extension */
+    static bool isXMLFile(const std::string& filePath);
+
+private:
+
+    /** Data array declared in the XML header */
+    struct ArrayDescription
+    {
+        enum class Format
+        {
+            Ascii,
+            Binary,
+            Appended
+        };
+
+        std::string     name;
+        std::string     typeName;
+        ValueType       type = ValueType::Unknown;
+        std::size_t     numComponents = 1;
+        Format          format = Format::Ascii;
+        std::size_t     offset = 0;                 /** Offset into the appended data */
+        const char*     contentBegin = nullptr;     /** Inline content of ascii and binary arrays */
+        const char*     contentEnd = nullptr;
+        std::string     section;                    /** Enclosing element, e.g. Points, PointData or Lines */
+        std::size_t     piece = 0;
+    };
+
+    /** Piece of the dataset with its arrays */
+    struct Piece
+    {
+        std::size_t                     numberOfPoints = 0;
+        std::size_t                     numberOfLines = 0;
+        std::size_t                     numberOfCells = 0;
+        std::vector<ArrayDescription>   arrays;
+    };
+
+    /** Resets the reader and reads the XML header, returns the dataset type */
+    std::string parseHeaderOnly(const char* begin, const char* end, const std::string& fileName);
+
+    void readHeader(const char* begin, const char* end);
+    void buildData(VTKData& data) const;
+
+    /** Returns the raw (decoded and decompressed) bytes of a binary array */
+    std::vector<char> readBytes(const ArrayDescription& array) const;
+
+    /** Reads a whole array, converting its values to the destination type */
+    template <typename Value>
+    std::vector<Value> readArray(const ArrayDescription& array, std::size_t expectedCount) const;
+
+    std::vector<char> readRawBlock(const char* position, const char* end) const;
+    std::vector<char> readBase64Block(const char* position, const char* end) const;
+    std::vector<char> inflateBlocks(const std::vector<std::size_t>& header, const char* compressed, std::size_t compressedSize) const;
+
+    std::size_t readHeaderValue(const char* bytes) const;
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+private:
+    std::string         _fileName;
+    std::string         _datasetType;
+    bool                _bigEndian = false;
+    std::size_t         _headerSize = 4;            /** Size of the block headers: 4 (UInt32) or 8 (UInt64) bytes */
+    bool                _compressed = false;
+    bool                _appendedBase64 = false;
+    const char*         _appendedData = nullptr;    /** First byte after the '_' marker of the appended data */
+    const char*         _end = nullptr;
+    std::vector<Piece>  _pieces;
+};
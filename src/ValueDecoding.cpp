@@ -0,0 +1,232 @@
+#include "ValueDecoding.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define VTKLOADER_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define VTKLOADER_NEON
+#endif
+
+namespace
+{
+    inline std::uint16_t byteSwap(std::uint16_t value)
+    {
+        return static_cast<std::uint16_t>((value >> 8) | (value << 8));
+    }
+
+    inline std::uint32_t byteSwap(std::uint32_t value)
+    {
+        return (value >> 24) | ((value >> 8) & 0x0000FF00u) | ((value << 8) & 0x00FF0000u) | (value << 24);
+    }
+
+    inline std::uint64_t byteSwap(std::uint64_t value)
+    {
+        return (static_cast<std::uint64_t>(byteSwap(static_cast<std::uint32_t>(value))) << 32) | byteSwap(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    /** Scalar kernel, also handles the tails of the vectorized kernels */
+    template <typename Word>
+    void swapTail(const char* source, char* destination, std::size_t begin, std::size_t count)
+    {
+        for (std::size_t index = begin; index < count; index++) {
+            Word value;
+            std::memcpy(&value, source + index * sizeof(Word), sizeof(Word));
+            value = byteSwap(value);
+            std::memcpy(destination + index * sizeof(Word), &value, sizeof(Word));
+        }
+    }
+
+#if defined(__AVX2__)
+    /** Swaps 32 bytes worth of words with a byte shuffle, the pattern holds the byte order within one 16 byte lane */
+    std::size_t swapVectorized(const char* source, char* destination, std::size_t numberOfBytes, __m256i pattern)
+    {
+        std::size_t offset = 0;
+
+        for (; offset + 32 <= numberOfBytes; offset += 32) {
+            const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + offset));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + offset), _mm256_shuffle_epi8(block, pattern));
+        }
+
+        return offset;
+    }
+#endif
+}
+
+ValueType valueTypeFromLegacyName(std::string_view name)
+{
+    if (name == "float")
+        return ValueType::Float32;
+
+    if (name == "double")
+        return ValueType::Float64;
+
+    if (name == "int" || name == "long" || name == "vtkIdType" || name == "vtktypeint32")
+        return ValueType::Int32;
+
+    if (name == "unsigned_int" || name == "unsigned_long" || name == "vtktypeuint32")
+        return ValueType::UInt32;
+
+    if (name == "vtktypeint64")
+        return ValueType::Int64;
+
+    if (name == "vtktypeuint64")
+        return ValueType::UInt64;
+
+    if (name == "short")
+        return ValueType::Int16;
+
+    if (name == "unsigned_short")
+        return ValueType::UInt16;
+
+    if (name == "char" || name == "signed_char")
+        return ValueType::Int8;
+
+    if (name == "unsigned_char" || name == "bit")
+        return ValueType::UInt8;
+
+    return ValueType::Unknown;
+}
+
+ValueType valueTypeFromXMLName(std::string_view name)
+{
+    if (name == "Float32")
+        return ValueType::Float32;
+
+    if (name == "Float64")
+        return ValueType::Float64;
+
+    if (name == "Int8")
+        return ValueType::Int8;
+
+    if (name == "UInt8")
+        return ValueType::UInt8;
+
+    if (name == "Int16")
+        return ValueType::Int16;
+
+    if (name == "UInt16")
+        return ValueType::UInt16;
+
+    if (name == "Int32")
+        return ValueType::Int32;
+
+    if (name == "UInt32")
+        return ValueType::UInt32;
+
+    if (name == "Int64")
+        return ValueType::Int64;
+
+    if (name == "UInt64")
+        return ValueType::UInt64;
+
+    return ValueType::Unknown;
+}
+
+std::size_t valueTypeSize(ValueType type)
+{
+    switch (type)
+    {
+        case ValueType::Int8:
+        case ValueType::UInt8:
+            return 1;
+
+        case ValueType::Int16:
+        case ValueType::UInt16:
+            return 2;
+
+        case ValueType::Int32:
+        case ValueType::UInt32:
+        case ValueType::Float32:
+            return 4;
+
+        case ValueType::Int64:
+        case ValueType::UInt64:
+        case ValueType::Float64:
+            return 8;
+
+        default:
+            return 0;
+    }
+}
+
+void swapBytes16(const void* source, void* destination, std::size_t count)
+{
+    const auto* input   = static_cast<const char*>(source);
+    auto* output        = static_cast<char*>(destination);
+
+    std::size_t index = 0;
+
+#if defined(__AVX2__)
+    const auto pattern = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    index = swapVectorized(input, output, count * 2, pattern) / 2;
+#elif defined(VTKLOADER_SSE2)
+    for (; index + 8 <= count; index += 8) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index * 2), _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8)));
+    }
+#elif defined(VTKLOADER_NEON)
+    for (; index + 8 <= count; index += 8)
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(output + index * 2), vrev16q_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(input + index * 2))));
+#endif
+
+    swapTail<std::uint16_t>(input, output, index, count);
+}
+
+void swapBytes32(const void* source, void* destination, std::size_t count)
+{
+    const auto* input   = static_cast<const char*>(source);
+    auto* output        = static_cast<char*>(destination);
+
+    std::size_t index = 0;
+
+#if defined(__AVX2__)
+    const auto pattern = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    index = swapVectorized(input, output, count * 4, pattern) / 4;
+#elif defined(VTKLOADER_SSE2)
+    for (; index + 4 <= count; index += 4) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index * 4));
+
+        // Swap the bytes within each 16 bit half, then swap the halves.
+        block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+        block = _mm_shufflehi_epi16(_mm_shufflelo_epi16(block, 0xB1), 0xB1);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index * 4), block);
+    }
+#elif defined(VTKLOADER_NEON)
+    for (; index + 4 <= count; index += 4)
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(output + index * 4), vrev32q_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(input + index * 4))));
+#endif
+
+    swapTail<std::uint32_t>(input, output, index, count);
+}
+
+void swapBytes64(const void* source, void* destination, std::size_t count)
+{
+    const auto* input   = static_cast<const char*>(source);
+    auto* output        = static_cast<char*>(destination);
+
+    std::size_t index = 0;
+
+#if defined(__AVX2__)
+    const auto pattern = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    index = swapVectorized(input, output, count * 8, pattern) / 8;
+#elif defined(VTKLOADER_SSE2)
+    for (; index + 2 <= count; index += 2) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + index * 8));
+
+        // Swap the bytes within each 16 bit word, then reverse the words of each 64 bit value.
+        block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+        block = _mm_shufflehi_epi16(_mm_shufflelo_epi16(block, 0x1B), 0x1B);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + index * 8), block);
+    }
+#elif defined(VTKLOADER_NEON)
+    for (; index + 2 <= count; index += 2)
+        vst1q_u8(reinterpret_cast<std::uint8_t*>(output + index * 8), vrev64q_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(input + index * 8))));
+#endif
+
+    swapTail<std::uint64_t>(input, output, index, count);
+}
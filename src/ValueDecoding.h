@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// =============================================================================
+// Binary value decoding
+// =============================================================================
+
+/** Element types of binary VTK arrays */
+enum class ValueType
+{
+    Unknown,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float32,
+    Float64
+};
+
+/**
+ * Returns the value type for a legacy VTK type name (e.g. "float", "unsigned_char", "vtktypeint64").
+ * Legacy files store "long" and "vtkIdType" with four bytes.
+ */
+ValueType valueTypeFromLegacyName(std::string_view name);
+
+/** Returns the value type for an XML VTK type name (e.g. "Float32", "Int64") */
+ValueType valueTypeFromXMLName(std::string_view name);
+
+/** Returns the size in bytes of one value */
+std::size_t valueTypeSize(ValueType type);
+
+/** Returns whether the host stores values big endian */
+inline bool hostIsBigEndian()
+{
+    const std::uint16_t probe = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &probe, 1);
+    return firstByte == 0;
+}
+
+/**
+ * Reverse the bytes of every 2, 4 or 8 byte value in the source and write the results to the destination.
+ * Uses SSE2/AVX2 or NEON shuffles where available with a portable scalar tail. Source and destination may alias.
+ */
+void swapBytes16(const void* source, void* destination, std::size_t count);
+void swapBytes32(const void* source, void* destination, std::size_t count);
+void swapBytes64(const void* source, void* destination, std::size_t count);
+
+/**
+ * Decode a packed array of binary values into the destination buffer, converting the element type if needed.
+ * Arrays whose element type matches the destination are byte swapped in bulk directly into the destination.
+ * @param type Element type of the source values
+ * @param source Raw bytes, valueTypeSize(type) * count of them
+ * @param count Number of values
+ * @param bigEndian Whether the source values are stored big endian (legacy VTK always is)
+ * @param destination Output buffer of count values
+ */
+template <typename Destination>
+void decodeValues(ValueType type, const char* source, std::size_t count, bool bigEndian, Destination* destination)
+{
+    static_assert(std::is_arithmetic<Destination>::value, "Values can only be decoded into arithmetic types");
+
+    const bool swap = bigEndian != hostIsBigEndian();
+
+    // Same representation: bulk copy or swap straight into the destination.
+    const bool sameRepresentation =
+        (std::is_same<Destination, float>::value && type == ValueType::Float32) ||
+        (std::is_same<Destination, double>::value && type == ValueType::Float64) ||
+        (std::is_integral<Destination>::value && sizeof(Destination) == 4 && (type == ValueType::Int32 || type == ValueType::UInt32)) ||
+        (std::is_integral<Destination>::value && sizeof(Destination) == 8 && (type == ValueType::Int64 || type == ValueType::UInt64));
+
+    if (sameRepresentation) {
+        if (!swap)
+            std::memcpy(destination, source, count * sizeof(Destination));
+        else if (sizeof(Destination) == 4)
+            swapBytes32(source, destination, count);
+        else
+            swapBytes64(source, destination, count);
+
+        return;
+    }
+
+    const auto convert = [&](auto sourceValue) {
+        using Source = decltype(sourceValue);
+
+        for (std::size_t index = 0; index < count; index++) {
+            Source value;
+            std::memcpy(&value, source + index * sizeof(Source), sizeof(Source));
+
+            if (swap && sizeof(Source) > 1) {
+                unsigned char bytes[sizeof(Source)];
+                std::memcpy(bytes, &value, sizeof(Source));
+
+                for (std::size_t byteIndex = 0; byteIndex < sizeof(Source) / 2; byteIndex++)
+                    std::swap(bytes[byteIndex], bytes[sizeof(Source) - 1 - byteIndex]);
+
+                std::memcpy(&value, bytes, sizeof(Source));
+            }
+
+            destination[index] = static_cast<Destination>(value);
+        }
+    };
+
+    switch (type)
+    {
+        case ValueType::Int8:       convert(std::int8_t());     break;
+        case ValueType::UInt8:      convert(std::uint8_t());    break;
+        case ValueType::Int16:      convert(std::int16_t());    break;
+        case ValueType::UInt16:     convert(std::uint16_t());   break;
+        case ValueType::Int32:      convert(std::int32_t());    break;
+        case ValueType::UInt32:     convert(std::uint32_t());   break;
+        case ValueType::Int64:      convert(std::int64_t());    break;
+        case ValueType::UInt64:     convert(std::uint64_t());   break;
+        case ValueType::Float32:    convert(float());           break;
+        case ValueType::Float64:    convert(double());          break;
+
+        default:
+            break;
+    }
+}